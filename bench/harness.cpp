@@ -0,0 +1,273 @@
+#include "harness.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+Xvfb::~Xvfb()
+{
+	stop();
+}
+
+bool Xvfb::start(const char *geometry)
+{
+	int fds[2];
+	if (pipe(fds) == -1) {
+		perror("pipe");
+		return false;
+	}
+
+	m_pid = fork();
+	if (m_pid == -1) {
+		perror("fork");
+		return false;
+	}
+
+	if (m_pid == 0) {
+		close(fds[0]);
+		std::string fd = std::to_string(fds[1]);
+		/* Keep the benchmark output clean */
+		int devnull = open("/dev/null", O_WRONLY);
+		dup2(devnull, STDERR_FILENO);
+		execlp("Xvfb", "Xvfb", "-displayfd", fd.c_str(), "-screen", "0", geometry,
+				"-nolisten", "tcp", "-noreset", (char *)nullptr);
+		_exit(127);
+	}
+
+	close(fds[1]);
+
+	/* Xvfb writes the display number it picked once it's ready to accept clients */
+	char buf[32] = {0};
+	size_t len = 0;
+	struct pollfd pfd = {fds[0], POLLIN, 0};
+	while (len < sizeof(buf) - 1 && poll(&pfd, 1, 10000) > 0) {
+		ssize_t n = read(fds[0], buf + len, sizeof(buf) - 1 - len);
+		if (n <= 0)
+			break;
+		len += n;
+		if (memchr(buf, '\n', len))
+			break;
+	}
+	close(fds[0]);
+
+	if (len == 0) {
+		fprintf(stderr, "Cannot start Xvfb\n");
+		stop();
+		return false;
+	}
+
+	m_display = ":" + std::to_string(atoi(buf));
+	return true;
+}
+
+void Xvfb::stop()
+{
+	if (m_pid > 0) {
+		kill(m_pid, SIGTERM);
+		waitpid(m_pid, nullptr, 0);
+		m_pid = -1;
+	}
+}
+
+Harness::Harness()
+{
+	char tmpl[] = "/tmp/sakura-bench-XXXXXX";
+	if (mkdtemp(tmpl)) {
+		m_tmpdir = tmpl;
+	}
+}
+
+Harness::~Harness()
+{
+	m_xvfb.stop();
+
+	if (!m_tmpdir.empty()) {
+		std::error_code error;
+		fs::remove_all(m_tmpdir, error);
+	}
+}
+
+void Harness::parse_options(int &argc, char **argv)
+{
+	int out = 1;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--sakura") && i + 1 < argc) {
+			m_sakura = argv[++i];
+		} else if (!strcmp(argv[i], "--no-xvfb")) {
+			m_use_xvfb = false;
+		} else {
+			argv[out++] = argv[i];
+		}
+	}
+	argc = out;
+	argv[argc] = nullptr;
+}
+
+bool Harness::setup()
+{
+	if (m_tmpdir.empty()) {
+		fprintf(stderr, "Cannot create a temporary directory\n");
+		return false;
+	}
+
+	if (m_use_xvfb) {
+		if (!m_xvfb.start())
+			return false;
+		setenv("DISPLAY", m_xvfb.display().c_str(), 1);
+	} else if (!getenv("DISPLAY")) {
+		fprintf(stderr, "--no-xvfb needs a DISPLAY\n");
+		return false;
+	}
+
+	/* Every run starts from the default configuration and never touches the user's one */
+	std::string config_dir = m_tmpdir + "/config";
+	fs::create_directories(config_dir);
+	setenv("XDG_CONFIG_HOME", config_dir.c_str(), 1);
+	setenv("GDK_BACKEND", "x11", 1);
+	setenv("NO_AT_BRIDGE", "1", 1);
+	setenv("SHELL", "/bin/sh", 1);
+
+	return true;
+}
+
+static void read_report(const std::string &path, std::map<std::string, double> &report)
+{
+	std::ifstream file(path);
+	std::string name;
+	double value;
+
+	/* A mark can be reached more than once (a window is mapped again after being minimized),
+	 * only the first time counts */
+	while (file >> name >> value)
+		report.emplace(name, value);
+}
+
+SakuraRun Harness::run(const std::vector<std::string> &args, double timeout_seconds)
+{
+	static int run_count = 0;
+	SakuraRun result;
+
+	std::string report = m_tmpdir + "/report-" + std::to_string(run_count++);
+	std::string report_arg = "--bench-report=" + report;
+
+	std::vector<char *> argv;
+	argv.push_back(const_cast<char *>(m_sakura.c_str()));
+	for (const auto &arg : args)
+		argv.push_back(const_cast<char *>(arg.c_str()));
+	argv.push_back(const_cast<char *>(report_arg.c_str()));
+	argv.push_back(nullptr);
+
+	auto start = std::chrono::steady_clock::now();
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	result.start_us = now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+	pid_t pid = fork();
+	if (pid == -1) {
+		perror("fork");
+		return result;
+	}
+
+	if (pid == 0) {
+		int devnull = open("/dev/null", O_WRONLY);
+		dup2(devnull, STDOUT_FILENO);
+		execv(argv[0], argv.data());
+		perror(argv[0]);
+		_exit(127);
+	}
+
+	/* Sleep until sakura exits or the timeout expires. Without pidfd (Linux < 5.3) there is no
+	 * timeout, the wait below just blocks */
+	int pidfd = syscall(SYS_pidfd_open, pid, 0);
+	if (pidfd != -1) {
+		struct pollfd pfd = {pidfd, POLLIN, 0};
+		int ready;
+		do {
+			std::chrono::duration<double> elapsed =
+					std::chrono::steady_clock::now() - start;
+			int left = (int)std::max(0.0, (timeout_seconds - elapsed.count()) * 1000);
+			ready = poll(&pfd, 1, left);
+		} while (ready == -1 && errno == EINTR);
+		close(pidfd);
+
+		if (ready != 1) {
+			fprintf(stderr, "sakura did not exit after %.0f seconds, killing it\n",
+					timeout_seconds);
+			kill(pid, SIGKILL);
+			waitpid(pid, nullptr, 0);
+			return result;
+		}
+	}
+
+	int status;
+	struct rusage usage;
+	if (wait4(pid, &status, 0, &usage) != pid) {
+		perror("wait4");
+		return result;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	result.wall_seconds = elapsed.count();
+	result.status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	result.cpu_user_seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+	result.cpu_system_seconds = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+	read_report(report, result.report);
+
+	return result;
+}
+
+double SakuraRun::mark_ms(const std::string &name) const
+{
+	auto it = report.find("mark_" + name);
+	if (it == report.end())
+		return -1;
+
+	return (it->second - start_us) / 1000;
+}
+
+double median(std::vector<double> values)
+{
+	return percentile(std::move(values), 50);
+}
+
+double percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0;
+
+	std::sort(values.begin(), values.end());
+	size_t index = (size_t)std::ceil(p / 100.0 * values.size());
+	return values[index > 0 ? index - 1 : 0];
+}
+
+std::string json_escape(const std::string &text)
+{
+	std::string escaped;
+	for (char c : text) {
+		if (c == '"' || c == '\\') {
+			escaped.push_back('\\');
+			escaped.push_back(c);
+		} else if ((unsigned char)c < 0x20) {
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			escaped.append(buf);
+		} else {
+			escaped.push_back(c);
+		}
+	}
+	return escaped;
+}
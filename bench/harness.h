@@ -0,0 +1,63 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/* Helpers shared by the benchmark drivers that run sakura itself: a private X server, sakura
+ * runs with a clean configuration, and the --bench-report output sakura writes on exit. */
+
+class Xvfb
+{
+public:
+	Xvfb() = default;
+	~Xvfb();
+
+	/* Start Xvfb on the first free display. Returns false if it cannot be started */
+	bool start(const char *geometry = "1920x1080x24");
+	void stop();
+	const std::string &display() const { return m_display; }
+
+private:
+	pid_t m_pid = -1;
+	std::string m_display;
+};
+
+struct SakuraRun {
+	int status = -1;
+	double wall_seconds = 0;
+	double cpu_user_seconds = 0; /* sakura and every child it reaped */
+	double cpu_system_seconds = 0;
+	double start_us = 0; /* CLOCK_MONOTONIC time of the fork, the clock sakura marks use */
+	std::map<std::string, double> report; /* Values from --bench-report */
+
+	/* Milliseconds from the fork to a startup mark, negative if it was not reached */
+	double mark_ms(const std::string &name) const;
+};
+
+class Harness
+{
+public:
+	Harness();
+	~Harness();
+
+	/* Parses and removes the common options (--sakura PATH, --no-xvfb) from argv */
+	void parse_options(int &argc, char **argv);
+	bool setup();
+
+	/* Runs sakura with the given arguments until it exits */
+	SakuraRun run(const std::vector<std::string> &args, double timeout_seconds = 600);
+
+	const std::string &tmpdir() const { return m_tmpdir; }
+
+private:
+	std::string m_sakura = SAKURA_BINARY;
+	std::string m_tmpdir;
+	bool m_use_xvfb = true;
+	Xvfb m_xvfb;
+};
+
+double median(std::vector<double> values);
+double percentile(std::vector<double> values, double p);
+std::string json_escape(const std::string &text);
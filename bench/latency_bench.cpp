@@ -0,0 +1,205 @@
+/* Keystroke to photon latency of sakura. sakura runs with --measure-latency under a private Xvfb,
+ * with this same program as its child in --echo mode: the terminal is put in raw mode and every
+ * byte read is written back, like a shell or an editor echoes what is typed. Keys are typed into
+ * the window with XTest, one at a time.
+ *
+ * Usage: sakura-latency-bench [--sakura PATH] [--no-xvfb] [--keys N] [--interval-ms N]
+ *                             [--runs N] [--setting KEY=VALUE]...
+ *
+ * --setting lines are written to the sakura.yml of the runs (e.g. --setting scroll_lines=100000
+ * or --setting background_image=/path/to/image.png), so settings and builds can be compared.
+ * Prints one JSON line with the median over the runs of the p50, p99 and max latency. Exits with
+ * status 1 when a sakura run fails or no key is measured. */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <termios.h>
+#include <unistd.h>
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+#include "harness.h"
+
+namespace fs = std::filesystem;
+
+/* Ends the echo loop, and with it the sakura run */
+#define ECHO_EXIT_BYTE 0x04
+
+static void usage()
+{
+	fprintf(stderr, "Usage: sakura-latency-bench [--sakura PATH] [--no-xvfb] [--keys N] "
+			"[--interval-ms N] [--runs N] [--setting KEY=VALUE]...\n");
+	exit(2);
+}
+
+/* The child of sakura: writes the window id sakura exports to the ready file, then echoes */
+static int echo(const char *ready_file)
+{
+	struct termios tio;
+	if (tcgetattr(STDIN_FILENO, &tio) == 0) {
+		cfmakeraw(&tio);
+		tcsetattr(STDIN_FILENO, TCSANOW, &tio);
+	}
+
+	const char *window = getenv("WINDOWID");
+	std::ofstream(ready_file) << (window ? window : "0") << std::endl;
+
+	char buffer[256];
+	ssize_t n;
+	while ((n = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) {
+		if (memchr(buffer, ECHO_EXIT_BYTE, n))
+			return 0;
+		if (write(STDOUT_FILENO, buffer, n) != n)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void type_key(Display *display, KeySym keysym, bool control = false)
+{
+	KeyCode control_code = XKeysymToKeycode(display, XK_Control_L);
+	KeyCode code = XKeysymToKeycode(display, keysym);
+
+	if (control)
+		XTestFakeKeyEvent(display, control_code, True, CurrentTime);
+	XTestFakeKeyEvent(display, code, True, CurrentTime);
+	XTestFakeKeyEvent(display, code, False, CurrentTime);
+	if (control)
+		XTestFakeKeyEvent(display, control_code, False, CurrentTime);
+	XFlush(display);
+}
+
+/* Waits for the echo child to start, focuses the sakura window and types into it */
+static void typist(const std::string &ready_file, int keys, int interval_ms)
+{
+	Window window = 0;
+	for (int i = 0; i < 3000 && !window; i++) {
+		std::ifstream ready(ready_file);
+		if (!(ready >> window))
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	Display *display = XOpenDisplay(nullptr);
+	if (!display || !window) {
+		fprintf(stderr, "Cannot find the sakura window\n");
+		if (display)
+			XCloseDisplay(display);
+		return;
+	}
+
+	/* Let the first frames settle before the window takes the focus */
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	XSetInputFocus(display, window, RevertToParent, CurrentTime);
+	XSync(display, False);
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	for (int i = 0; i < keys; i++) {
+		type_key(display, XK_a + i % 26);
+		std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+	}
+	type_key(display, XK_d, true);
+
+	XCloseDisplay(display);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 3 && !strcmp(argv[1], "--echo"))
+		return echo(argv[2]);
+
+	Harness harness;
+	harness.parse_options(argc, argv);
+
+	int keys = 200;
+	int interval_ms = 50;
+	int runs = 3;
+	std::vector<std::string> settings;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--keys") && i + 1 < argc) {
+			keys = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--interval-ms") && i + 1 < argc) {
+			interval_ms = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+			runs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--setting") && i + 1 < argc) {
+			std::string setting = argv[++i];
+			size_t equal = setting.find('=');
+			if (equal == std::string::npos)
+				usage();
+			setting.replace(equal, 1, ": ");
+			settings.push_back(setting);
+		} else {
+			usage();
+		}
+	}
+
+	if (keys <= 0 || interval_ms <= 0 || runs <= 0)
+		usage();
+
+	if (!harness.setup())
+		return 2;
+
+	std::string config_dir = harness.tmpdir() + "/config/sakura";
+	std::error_code error;
+	fs::create_directories(config_dir, error);
+	std::ofstream config(config_dir + "/sakura.yml");
+	for (const auto &setting : settings)
+		config << setting << std::endl;
+	config.close();
+
+	char self[4096];
+	ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+	if (length <= 0)
+		return 2;
+	self[length] = '\0';
+
+	std::vector<double> p50, p99, max;
+	double measured = 0, skipped = 0, lost = 0;
+	int status = 0;
+	for (int i = 0; i < runs; i++) {
+		std::string ready_file = harness.tmpdir() + "/ready-" + std::to_string(i);
+		std::string command = std::string(self) + " --echo " + ready_file;
+
+		std::thread thread(typist, ready_file, keys, interval_ms);
+		SakuraRun run = harness.run({"--measure-latency", "-x", command},
+				30 + keys * interval_ms / 1000.0 * 2);
+		thread.join();
+
+		if (run.status != 0 || run.report.count("latency_p50_us") == 0) {
+			fprintf(stderr, "run %d: no latency measured (status %d)\n", i + 1,
+					run.status);
+			status = 1;
+			continue;
+		}
+
+		p50.push_back(run.report["latency_p50_us"] / 1000);
+		p99.push_back(run.report["latency_p99_us"] / 1000);
+		max.push_back(run.report["latency_max_us"] / 1000);
+		measured += run.report["latency_keys"];
+		skipped += run.report["latency_skipped"];
+		lost += run.report["latency_lost"];
+	}
+
+	if (p50.empty())
+		return 1;
+
+	std::string joined;
+	for (const auto &setting : settings)
+		joined += (joined.empty() ? "" : ", ") + setting;
+
+	printf("{\"settings\":\"%s\",\"runs\":%zu,\"keys\":%.0f,\"skipped\":%.0f,\"lost\":%.0f,"
+	       "\"p50_ms\":%.2f,\"p99_ms\":%.2f,\"max_ms\":%.2f}\n",
+			json_escape(joined).c_str(), p50.size(), measured, skipped, lost,
+			median(p50), median(p99), median(max));
+
+	return status;
+}
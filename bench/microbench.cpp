@@ -0,0 +1,354 @@
+/* Micro benchmarks of the GTK-free code in libsakura-core: key dispatch, config loading, tab
+ * title formatting, tracing, shell mark scanning and quick switcher matching. Runs headless, no
+ * display or sakura binary needed.
+ *
+ * Usage: sakura-microbench [--filter NAME] [--repeat N] [--json]
+ *
+ * Every case is run --repeat times and the best time per operation is reported. */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "src/core/configdata.h"
+#include "src/core/keybindings.h"
+#include "src/core/palette.h"
+#include "src/core/shellmarks.h"
+#include "src/core/tabindex.h"
+#include "src/core/tablabel.h"
+#include "src/core/trace.h"
+
+/* Same values as in sakuraold.cpp */
+#define TAB_MAX_SIZE 40
+#define TAB_MIN_SIZE 6
+
+struct Case {
+	const char *name;
+	long ops; /* Operations per run */
+	std::function<void(long)> run;
+};
+
+/* Results are summed here so the compiler can't drop the measured calls */
+static volatile unsigned long sink;
+
+static void usage()
+{
+	fprintf(stderr, "Usage: sakura-microbench [--filter NAME] [--repeat N] [--json]\n");
+	exit(2);
+}
+
+/* Keycodes of a US layout, where X keycodes are the evdev ones plus 8, for KeyBindings::build.
+ * A default key missing here stops the bench instead of dropping out of the table */
+static unsigned int keycode_for(unsigned int keyval)
+{
+	switch (keyval) {
+	case XK_1: case XK_2: case XK_3: case XK_4: case XK_5:
+	case XK_6: case XK_7: case XK_8: case XK_9:
+		return 10 + keyval - XK_1;
+	case XK_0: return 19;
+	case XK_T: return 28;
+	case XK_W: return 25;
+	case XK_C: return 54;
+	case XK_V: return 55;
+	case XK_S: return 39;
+	case XK_N: return 57;
+	case XK_F: return 41;
+	case XK_E: return 26;
+	case XK_B: return 56;
+	case XK_P: return 33;
+	case XK_plus: return 21;
+	case XK_minus: return 20;
+	case XK_Left: return 113;
+	case XK_Right: return 114;
+	case XK_F1: case XK_F2: case XK_F3: case XK_F4: case XK_F5:
+	case XK_F6: case XK_F7: case XK_F8: case XK_F9: case XK_F10:
+		return 67 + keyval - XK_F1;
+	case XK_F11: return 95;
+	default:
+		fprintf(stderr, "No keycode for keyval 0x%x\n", keyval);
+		exit(2);
+	}
+}
+
+/* Mostly plain typing, which must fall through to the terminal, with some shortcuts */
+static std::vector<std::pair<unsigned int, unsigned int>> key_events()
+{
+	std::vector<std::pair<unsigned int, unsigned int>> events;
+	const unsigned int ctrl_shift = SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK;
+
+	for (unsigned int keycode = 24; keycode < 62; keycode++)
+		events.push_back({keycode, 0});
+	for (unsigned int keycode = 24; keycode < 34; keycode++)
+		events.push_back({keycode, SAKURA_SHIFT_MASK});
+	events.push_back({54, SAKURA_CONTROL_MASK}); /* ctrl+c goes to the shell */
+	events.push_back({54, ctrl_shift});           /* copy */
+	events.push_back({55, ctrl_shift});           /* paste */
+	events.push_back({114, SAKURA_CONTROL_MASK}); /* next tab */
+	events.push_back({113, ctrl_shift});          /* move tab */
+	events.push_back({12, SAKURA_CONTROL_MASK});  /* tab 3 */
+	events.push_back({95, 0});                    /* fullscreen */
+
+	return events;
+}
+
+static std::string small_config()
+{
+	return "font: Monospace 11\n"
+	       "palette: tango\n"
+	       "scroll_lines: 10000\n"
+	       "scrollbar: true\n"
+	       "cursor_type: 1\n"
+	       "keymap:\n"
+	       "  add_tab: T\n"
+	       "  copy: C\n"
+	       "  fullscreen: F11\n"
+	       "colorset1:\n"
+	       "  fore: rgb(255,255,255)\n"
+	       "  back: rgba(0,0,0,0.9)\n"
+	       "  key: F1\n";
+}
+
+/* A config file grown over the years: every setting, all colorsets and a lot of entries sakura
+ * does not know about (old ini keys, other tools sharing the file) */
+static std::string huge_config()
+{
+	std::string yaml = small_config();
+
+	yaml += "word_chars: \"" + std::string(4096, '-') + "\"\n";
+	yaml += "keymap_extra:\n";
+	for (int i = 0; i < 2000; i++)
+		yaml += "  binding_" + std::to_string(i) + ": Control+F" + std::to_string(i % 12) +
+			"\n";
+	for (int i = 2; i <= NUM_COLORSETS; i++) {
+		yaml += "colorset" + std::to_string(i) + ":\n";
+		yaml += "  fore: rgb(" + std::to_string(i * 20) + ",192,192)\n";
+		yaml += "  back: rgba(0,0,0,1)\n";
+		yaml += "  curs: rgb(255,255,255)\n";
+		yaml += "  key: F" + std::to_string(i) + "\n";
+	}
+	yaml += "history:\n";
+	for (int i = 0; i < 5000; i++)
+		yaml += "  - /home/user/projects/sakura/src/file" + std::to_string(i) + ".cpp\n";
+
+	return yaml;
+}
+
+/* 64 KiB of shell output with OSC 133 marks: short commands with colored output, each of them
+ * a prompt, a command line and the output */
+static std::string marked_output()
+{
+	std::string output;
+
+	for (int i = 0; output.size() < 65536; i++) {
+		output += "\033]133;A\007\033[1;32muser@host\033[0m:~/src$ \033]133;B\007make\r\n"
+			  "\033]133;C\007";
+		for (int line = 0; line < 8; line++)
+			output += "src/file" + std::to_string(i) + ".cpp:" + std::to_string(line) +
+				  ": \033[1;35mwarning:\033[0m unused variable 'x'\r\n";
+		output += "\033]133;D;" + std::to_string(i % 3) + "\007";
+	}
+
+	return output;
+}
+
+/* 500 tabs of ssh sessions, editors and builds, as the quick switcher sees them */
+static void fill_tab_index(TabIndex &index, std::vector<int> &tabs)
+{
+	static const char *hosts[] = {"prod-db", "prod-web", "staging-api", "build", "cache"};
+	static const char *commands[] = {"", "ssh", "vim", "make", "tail", "htop"};
+
+	tabs.resize(500);
+	for (size_t i = 0; i < tabs.size(); i++) {
+		std::string n = std::to_string(i);
+		const void *tab = &tabs[i];
+		index.set(tab, TabField::LABEL, "Terminal " + n);
+		index.set(tab, TabField::TITLE,
+				std::string("user@") + hosts[i % 5] + "-" + n + ": ~");
+		index.set(tab, TabField::CWD, "/home/user/projects/service" + n + "/src");
+		index.set(tab, TabField::COMMAND, commands[i % 6]);
+	}
+}
+
+static std::vector<Case> cases()
+{
+	std::vector<Case> list;
+
+	list.push_back({"key-dispatch", 1000000, [](long ops) {
+		static KeyBindings bindings;
+		static auto events = key_events();
+		static bool built = false;
+		if (!built) {
+			bindings.build(ConfigData(), keycode_for);
+			built = true;
+		}
+
+		unsigned long sum = 0;
+		int arg;
+		for (long i = 0; i < ops; i++) {
+			const auto &event = events[i % events.size()];
+			sum += (unsigned long)bindings.resolve(event.first, event.second, arg);
+		}
+		sink += sum;
+	}});
+
+	list.push_back({"keyval-from-name", 100000, [](long ops) {
+		static const char *names[] = {"T", "F11", "Left", "plus", "65", "bogus"};
+		unsigned long sum = 0;
+		for (long i = 0; i < ops; i++)
+			sum += keyval_from_name(names[i % 6]);
+		sink += sum;
+	}});
+
+	list.push_back({"config-load-small", 2000, [](long ops) {
+		static const std::string yaml = small_config();
+		for (long i = 0; i < ops; i++) {
+			ConfigData config;
+			if (!config.load_string(yaml).empty())
+				abort();
+			sink += config.scroll_lines;
+		}
+	}});
+
+	list.push_back({"config-load-huge", 20, [](long ops) {
+		static const std::string yaml = huge_config();
+		for (long i = 0; i < ops; i++) {
+			ConfigData config;
+			if (!config.load_string(yaml).empty())
+				abort();
+			sink += config.scroll_lines;
+		}
+	}});
+
+	list.push_back({"palette-from-name", 1000000, [](long ops) {
+		static const char *names[] = {"tango", "solarized_dark", "unknown"};
+		unsigned long sum = 0;
+		for (long i = 0; i < ops; i++)
+			sum += (unsigned long)palette_from_name(names[i % 3]);
+		sink += sum;
+	}});
+
+	list.push_back({"title-ascii", 1000000, [](long ops) {
+		unsigned long sum = 0;
+		for (long i = 0; i < ops; i++)
+			sum += tab_label_text("user@host: ~/src/sakura", TAB_MAX_SIZE, TAB_MIN_SIZE)
+					       .size();
+		sink += sum;
+	}});
+
+	list.push_back({"title-long-utf8", 1000000, [](long ops) {
+		static const std::string title =
+				"vim — /home/usuario/proyectos/código/ñandú/archivo_muy_largo.cpp";
+		unsigned long sum = 0;
+		for (long i = 0; i < ops; i++)
+			sum += tab_label_text(title.c_str(), TAB_MAX_SIZE, TAB_MIN_SIZE).size();
+		sink += sum;
+	}});
+
+	list.push_back({"title-short", 1000000, [](long ops) {
+		unsigned long sum = 0;
+		for (long i = 0; i < ops; i++)
+			sum += tab_label_text("sh", TAB_MAX_SIZE, TAB_MIN_SIZE).size();
+		sink += sum;
+	}});
+
+	/* The cost left in every traced function of a release build */
+	list.push_back({"trace-span", 1000000, [](long ops) {
+		for (long i = 0; i < ops; i++) {
+			TRACE_SPAN(TRACE_TABS, "microbench");
+			sink += i;
+		}
+	}});
+
+	/* Every read of a tab with shell_integration, 64 KiB each */
+	list.push_back({"shell-mark-scan", 10000, [](long ops) {
+		static const std::string output = marked_output();
+		unsigned long sum = 0;
+		for (long i = 0; i < ops; i++) {
+			ShellMarkScanner scanner;
+			const char *data = output.data();
+			size_t size = output.size();
+			while (size > 0) {
+				ShellMark mark;
+				size_t scanned = scanner.scan(data, size, mark);
+				sum += (unsigned long)mark.type;
+				data += scanned;
+				size -= scanned;
+			}
+		}
+		sink += sum;
+	}});
+
+	/* Every keystroke in the quick switcher, typing "prod web 42" over 500 tabs */
+	list.push_back({"tab-index-match", 1000, [](long ops) {
+		static const std::string typed = "prod web 42";
+		static TabIndex index;
+		static std::vector<int> tabs;
+		if (tabs.empty())
+			fill_tab_index(index, tabs);
+
+		std::vector<TabMatch> results;
+		unsigned long sum = 0;
+		for (long i = 0; i < ops; i++) {
+			index.match(typed.substr(0, i % typed.size() + 1), 20, results);
+			sum += results.size();
+		}
+		sink += sum;
+	}});
+
+	return list;
+}
+
+int main(int argc, char **argv)
+{
+	const char *filter = nullptr;
+	int repeat = 5;
+	bool json = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+			filter = argv[++i];
+		} else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) {
+			repeat = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--json")) {
+			json = true;
+		} else {
+			usage();
+		}
+	}
+
+	if (repeat <= 0)
+		usage();
+
+	if (!json)
+		printf("%-20s %10s %14s %14s\n", "case", "ops", "best (ns/op)", "ops/s");
+
+	for (const auto &c : cases()) {
+		if (filter && !strstr(c.name, filter))
+			continue;
+
+		double best = 1e18;
+		for (int r = 0; r < repeat; r++) {
+			auto start = std::chrono::steady_clock::now();
+			c.run(c.ops);
+			std::chrono::duration<double> elapsed =
+					std::chrono::steady_clock::now() - start;
+			if (elapsed.count() < best)
+				best = elapsed.count();
+		}
+
+		double ns_per_op = best * 1e9 / c.ops;
+		if (json) {
+			printf("{\"case\":\"%s\",\"ops\":%ld,\"ns_per_op\":%.2f,"
+			       "\"ops_per_s\":%.0f}\n",
+					c.name, c.ops, ns_per_op, 1e9 / ns_per_op);
+		} else {
+			printf("%-20s %10ld %14.2f %14.0f\n", c.name, c.ops, ns_per_op,
+					1e9 / ns_per_op);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,263 @@
+/* Throughput and worst case match time of the link, hint and search regexes over realistic
+ * terminal output, with and without JIT.
+ *
+ * Usage: sakura-regex-bench [--corpus FILE] [--iterations N] [--max-line-us N] [--json]
+ *
+ * Exits with status 1 when a pattern hits the PCRE2 match limit (catastrophic backtracking)
+ * or when a single line takes longer than --max-line-us to scan. */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+#include "src/regexes.h"
+
+/* Compile flags VTE adds to every regex it is given */
+#define VTE_REGEX_FLAGS (PCRE2_UTF | PCRE2_NO_UTF_CHECK | PCRE2_NEVER_BACKSLASH_C)
+/* Flags used by search() in sakuraold.cpp */
+#define SEARCH_FLAGS (VTE_REGEX_FLAGS | PCRE2_MULTILINE | PCRE2_CASELESS)
+
+struct Pattern {
+	const char *name;
+	const char *regex;
+	uint32_t flags;
+};
+
+static const Pattern patterns[] = {
+		{"http", HTTP_REGEXP, VTE_REGEX_FLAGS},
+		{"mail", MAIL_REGEXP, VTE_REGEX_FLAGS},
+		{"hints", HINTS_REGEXP, PCRE2_UTF},
+		{"search-literal", "error", SEARCH_FLAGS},
+		{"search-alternation", "fatal|error|warning", SEARCH_FLAGS},
+		{"search-wildcard", "warning: .*unused", SEARCH_FLAGS},
+		{"search-location", "[\\w/.-]+\\.(c|cpp|h):\\d+", SEARCH_FLAGS},
+};
+
+struct Result {
+	double total_seconds = 0;
+	double worst_seconds = 0;
+	size_t worst_line = 0;
+	size_t matches = 0;
+	size_t limit_errors = 0;
+};
+
+static void usage()
+{
+	fprintf(stderr, "Usage: sakura-regex-bench [--corpus FILE] [--iterations N] "
+			"[--max-line-us N] [--json]\n");
+	exit(2);
+}
+
+/* Deterministic generator, so every run scans exactly the same lines */
+static uint32_t next_random(uint32_t &state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+/* Lines known to be hard on the link regexes: huge tokens without spaces, and long runs of the
+ * characters the patterns anchor on */
+static void add_generated_lines(std::vector<std::string> &lines)
+{
+	static const char base64[] =
+			"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	uint32_t state = 0x5a4b3c2d;
+
+	std::string blob;
+	for (int i = 0; i < 64 * 1024; i++)
+		blob.push_back(base64[next_random(state) % 64]);
+	lines.push_back(blob + "==");
+
+	std::string at;
+	for (int i = 0; i < 2000; i++)
+		at.append("user@");
+	lines.push_back(at);
+
+	std::string scheme;
+	for (int i = 0; i < 2000; i++)
+		scheme.append("http://");
+	lines.push_back(scheme);
+
+	std::string dotted("a@");
+	for (int i = 0; i < 32; i++)
+		dotted.append("b.");
+	lines.push_back(dotted + "1");
+
+	std::string separators;
+	for (int i = 0; i < 4096; i++)
+		separators.append(i % 2 ? "=" : "-");
+	lines.push_back(separators);
+
+	lines.push_back(std::string(8192, ' ') + "$ ");
+}
+
+static bool load_corpus(const char *path, std::vector<std::string> &lines)
+{
+	std::ifstream file(path);
+	if (!file)
+		return false;
+
+	std::string line;
+	while (std::getline(file, line))
+		lines.push_back(line);
+
+	return true;
+}
+
+static void run(const Pattern &pattern, bool jit, const std::vector<std::string> &lines,
+		int iterations, Result &result)
+{
+	int errcode;
+	PCRE2_SIZE erroffset;
+	pcre2_code *code = pcre2_compile((PCRE2_SPTR)pattern.regex, PCRE2_ZERO_TERMINATED,
+			pattern.flags, &errcode, &erroffset, nullptr);
+	if (!code) {
+		PCRE2_UCHAR msg[256];
+		pcre2_get_error_message(errcode, msg, sizeof(msg));
+		fprintf(stderr, "%s: %s at offset %zu\n", pattern.name, (const char *)msg,
+				(size_t)erroffset);
+		exit(2);
+	}
+
+	if (jit && pcre2_jit_compile(code, PCRE2_JIT_COMPLETE) != 0) {
+		fprintf(stderr, "%s: JIT is not available\n", pattern.name);
+		pcre2_code_free(code);
+		return;
+	}
+
+	pcre2_match_data *match_data = pcre2_match_data_create_from_pattern(code, nullptr);
+	/* Per line best time over all the iterations, so the worst case is not just noise */
+	std::vector<double> best(lines.size(), 1e9);
+
+	for (int i = 0; i < iterations; i++) {
+		for (size_t l = 0; l < lines.size(); l++) {
+			const auto &line = lines[l];
+			auto start = std::chrono::steady_clock::now();
+
+			/* Find every match on the line, like a search or a hint scan would */
+			PCRE2_SIZE offset = 0;
+			while (offset <= line.size()) {
+				int rc = pcre2_match(code, (PCRE2_SPTR)line.data(), line.size(), offset,
+						0, match_data, nullptr);
+				if (rc == PCRE2_ERROR_MATCHLIMIT || rc == PCRE2_ERROR_DEPTHLIMIT ||
+						rc == PCRE2_ERROR_JIT_STACKLIMIT) {
+					if (i == 0)
+						result.limit_errors++;
+					break;
+				}
+				if (rc < 0)
+					break;
+
+				if (i == 0)
+					result.matches++;
+				PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(match_data);
+				offset = ovector[1] > ovector[0] ? ovector[1] : ovector[0] + 1;
+			}
+
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			result.total_seconds += elapsed.count();
+			if (elapsed.count() < best[l])
+				best[l] = elapsed.count();
+		}
+	}
+
+	for (size_t l = 0; l < lines.size(); l++) {
+		if (best[l] > result.worst_seconds) {
+			result.worst_seconds = best[l];
+			result.worst_line = l;
+		}
+	}
+
+	pcre2_match_data_free(match_data);
+	pcre2_code_free(code);
+}
+
+int main(int argc, char **argv)
+{
+	const char *corpus = SAKURA_BENCH_CORPUS_DIR "/terminal-output.txt";
+	int iterations = 20;
+	double max_line_us = 0;
+	bool json = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--corpus") && i + 1 < argc) {
+			corpus = argv[++i];
+		} else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+			iterations = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--max-line-us") && i + 1 < argc) {
+			max_line_us = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--json")) {
+			json = true;
+		} else {
+			usage();
+		}
+	}
+
+	if (iterations <= 0)
+		usage();
+
+	std::vector<std::string> lines;
+	if (!load_corpus(corpus, lines)) {
+		fprintf(stderr, "Cannot read corpus %s\n", corpus);
+		return 2;
+	}
+	add_generated_lines(lines);
+
+	size_t bytes = 0;
+	for (const auto &line : lines)
+		bytes += line.size();
+
+	if (!json) {
+		printf("%zu lines, %zu bytes, %d iterations\n\n", lines.size(), bytes, iterations);
+		printf("%-20s %-4s %10s %12s %6s %8s %6s\n", "pattern", "jit", "MB/s", "worst (us)",
+				"line", "matches", "limit");
+	}
+
+	int status = 0;
+	for (const auto &pattern : patterns) {
+		for (bool jit : {false, true}) {
+			Result result;
+			run(pattern, jit, lines, iterations, result);
+
+			double mb_per_s = result.total_seconds > 0
+						  ? bytes * iterations / result.total_seconds / 1e6
+						  : 0;
+			double worst_us = result.worst_seconds * 1e6;
+
+			if (json) {
+				printf("{\"pattern\":\"%s\",\"jit\":%s,\"mb_per_s\":%.2f,"
+				       "\"worst_line_us\":%.2f,\"worst_line\":%zu,\"matches\":%zu,"
+				       "\"limit_errors\":%zu}\n",
+						pattern.name, jit ? "true" : "false", mb_per_s, worst_us,
+						result.worst_line + 1, result.matches, result.limit_errors);
+			} else {
+				printf("%-20s %-4s %10.2f %12.2f %6zu %8zu %6zu\n", pattern.name,
+						jit ? "yes" : "no", mb_per_s, worst_us,
+						result.worst_line + 1, result.matches, result.limit_errors);
+			}
+
+			if (result.limit_errors > 0) {
+				fprintf(stderr, "%s%s: match limit hit on %zu lines\n", pattern.name,
+						jit ? " (jit)" : "", result.limit_errors);
+				status = 1;
+			}
+
+			if (max_line_us > 0 && worst_us > max_line_us) {
+				fprintf(stderr, "%s%s: line %zu took %.2f us, budget is %.2f us\n",
+						pattern.name, jit ? " (jit)" : "", result.worst_line + 1,
+						worst_us, max_line_us);
+				status = 1;
+			}
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,90 @@
+/* What a window resize costs with big scrollbacks. sakura runs the "resize" scenario under a
+ * private Xvfb: it fills every tab with lines of scrollback, then times single resizes to the
+ * frame showing the new width, the frames of a continuous drag and the time it takes to settle,
+ * and the switches to the other tabs, which only get the new width then.
+ *
+ * Usage: sakura-resize-bench [--sakura PATH] [--no-xvfb] [--tabs N] [--lines N] [--runs N]
+ *
+ * Prints a CSV line per measure on stdout, with the median, minimum and maximum over the runs in
+ * microseconds. Exits with status 1 when a sakura run fails. */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "harness.h"
+
+static const char *measures[] = {"resize_us", "resize_drag_frame_us", "resize_drag_settle_us",
+		"resize_switch_us"};
+
+static void usage()
+{
+	fprintf(stderr, "Usage: sakura-resize-bench [--sakura PATH] [--no-xvfb] [--tabs N] "
+			"[--lines N] [--runs N]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	Harness harness;
+	harness.parse_options(argc, argv);
+
+	int tabs = 10;
+	int lines = 100000;
+	int runs = 3;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--tabs") && i + 1 < argc) {
+			tabs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--lines") && i + 1 < argc) {
+			lines = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+			runs = atoi(argv[++i]);
+		} else {
+			usage();
+		}
+	}
+	if (tabs <= 0 || lines <= 0 || runs <= 0)
+		usage();
+
+	if (!harness.setup())
+		return 2;
+
+	std::string scenario = "--bench-scenario=resize:" + std::to_string(tabs) + "," +
+			       std::to_string(lines);
+	std::map<std::string, std::vector<double>> values;
+	int status = 0;
+	for (int i = 0; i < runs; i++) {
+		SakuraRun run = harness.run({scenario});
+		if (run.status != 0 || run.report.empty()) {
+			fprintf(stderr, "run %d: sakura failed (status %d)\n", i + 1, run.status);
+			status = 1;
+			continue;
+		}
+
+		for (const char *measure : measures) {
+			auto it = run.report.find(measure);
+			if (it != run.report.end())
+				values[measure].push_back(it->second);
+		}
+	}
+
+	if (values.empty())
+		return 1;
+
+	printf("# %d tabs, %d lines of scrollback each\n", tabs, lines);
+	printf("measure,median_us,min_us,max_us\n");
+	for (const char *measure : measures) {
+		auto &v = values[measure];
+		if (v.empty())
+			continue;
+		printf("%s,%.0f,%.0f,%.0f\n", measure, median(v),
+				*std::min_element(v.begin(), v.end()),
+				*std::max_element(v.begin(), v.end()));
+	}
+
+	return status;
+}
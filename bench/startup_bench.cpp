@@ -0,0 +1,193 @@
+/* Time from process start to the first prompt. sakura runs a command that prints a prompt and
+ * waits a bit, many times under a private Xvfb, and the startup marks it writes with
+ * --bench-report are compared with the time of the fork.
+ *
+ * Usage: sakura-startup-bench [--sakura PATH] [--no-xvfb] [--runs N] [--cache warm|cold|both]
+ *                             [--budget FILE] [--command CMD]
+ *
+ * Cold runs drop the page cache before starting sakura, which needs root. The budget file has
+ * "cache mark milliseconds" lines, checked against the median time from the fork to the mark.
+ * Prints one JSON object per mark and cache state on stdout, and exits with status 1 when a run
+ * fails or a budget is exceeded. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "harness.h"
+
+/* Startup marks, in the order sakura reaches them */
+static const char *marks[] = {"main_start", "options_parsed", "gtk_init", "config_read", "regex",
+		"popup", "tabs", "main_loop", "window_mapped", "first_frame", "first_output"};
+
+static void usage()
+{
+	fprintf(stderr, "Usage: sakura-startup-bench [--sakura PATH] [--no-xvfb] [--runs N] "
+			"[--cache warm|cold|both] [--budget FILE] [--command CMD]\n");
+	exit(2);
+}
+
+static bool drop_caches()
+{
+	sync();
+
+	FILE *file = fopen("/proc/sys/vm/drop_caches", "w");
+	if (!file)
+		return false;
+
+	bool done = fputs("3\n", file) >= 0;
+	return fclose(file) == 0 && done;
+}
+
+/* Budgets by cache state and mark */
+static bool load_budget(const char *path, std::map<std::string, double> &budget)
+{
+	std::ifstream file(path);
+	if (!file)
+		return false;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		char cache[16], mark[64];
+		double ms;
+		if (sscanf(line.c_str(), "%15s %63s %lf", cache, mark, &ms) == 3)
+			budget[std::string(cache) + " " + mark] = ms;
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	Harness harness;
+	harness.parse_options(argc, argv);
+
+	int runs = 20;
+	std::string cache = "both";
+	const char *budget_file = SAKURA_BENCH_BUDGET;
+	/* Prints a prompt right away, and gives sakura time to draw it before the tab closes */
+	std::string command = "sh -c 'printf \"$ \"; sleep 0.5'";
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+			runs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--cache") && i + 1 < argc) {
+			cache = argv[++i];
+		} else if (!strcmp(argv[i], "--budget") && i + 1 < argc) {
+			budget_file = argv[++i];
+		} else if (!strcmp(argv[i], "--command") && i + 1 < argc) {
+			command = argv[++i];
+		} else {
+			usage();
+		}
+	}
+
+	if (runs <= 0 || (cache != "warm" && cache != "cold" && cache != "both"))
+		usage();
+
+	std::map<std::string, double> budget;
+	if (!load_budget(budget_file, budget)) {
+		fprintf(stderr, "Cannot read budget %s\n", budget_file);
+		return 2;
+	}
+
+	if (!harness.setup())
+		return 2;
+
+	std::vector<std::string> states;
+	if (cache != "cold")
+		states.push_back("warm");
+	if (cache != "warm") {
+		if (drop_caches()) {
+			states.push_back("cold");
+		} else {
+			fprintf(stderr, "Cannot drop the page cache (not root?), skipping cold runs\n");
+			if (cache == "cold")
+				return 2;
+		}
+	}
+
+	int status = 0;
+	for (const auto &state : states) {
+		bool cold = state == "cold";
+
+		/* Load everything once, so the first warm run is not a cold one */
+		if (!cold)
+			harness.run({"-x", command});
+
+		std::map<std::string, std::vector<double>> times;
+		std::map<std::string, std::vector<double>> phases;
+		std::map<std::string, int> missing;
+
+		for (int i = 0; i < runs; i++) {
+			if (cold)
+				drop_caches();
+
+			SakuraRun run = harness.run({"-x", command});
+			if (run.status != 0 || run.report.empty()) {
+				fprintf(stderr, "%s run %d: sakura failed (status %d)\n", state.c_str(),
+						i + 1, run.status);
+				status = 1;
+				continue;
+			}
+
+			double previous = 0;
+			for (const char *mark : marks) {
+				double ms = run.mark_ms(mark);
+				if (ms < 0) {
+					missing[mark]++;
+					continue;
+				}
+				times[mark].push_back(ms);
+				phases[mark].push_back(ms - previous);
+				previous = ms;
+			}
+		}
+
+		for (const char *mark : marks) {
+			std::string key = state + " " + mark;
+			auto limit = budget.find(key);
+
+			if (times[mark].empty()) {
+				if (limit != budget.end()) {
+					fprintf(stderr, "%s: never reached\n", key.c_str());
+					status = 1;
+				}
+				continue;
+			}
+
+			double median_ms = median(times[mark]);
+			printf("{\"cache\":\"%s\",\"mark\":\"%s\",\"runs\":%zu,\"missing\":%d,"
+			       "\"median_ms\":%.2f,\"p90_ms\":%.2f,\"max_ms\":%.2f,\"phase_ms\":%.2f",
+					state.c_str(), mark, times[mark].size(), missing[mark], median_ms,
+					percentile(times[mark], 90), percentile(times[mark], 100),
+					median(phases[mark]));
+			if (limit != budget.end())
+				printf(",\"budget_ms\":%.2f", limit->second);
+			printf("}\n");
+			fflush(stdout);
+
+			if (limit != budget.end()) {
+				if (median_ms > limit->second) {
+					fprintf(stderr, "%s: %.2f ms, budget is %.2f ms\n", key.c_str(),
+							median_ms, limit->second);
+					status = 1;
+				}
+				if (missing[mark] > 0) {
+					fprintf(stderr, "%s: not reached in %d runs\n", key.c_str(),
+							missing[mark]);
+					status = 1;
+				}
+			}
+		}
+	}
+
+	return status;
+}
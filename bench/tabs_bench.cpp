@@ -0,0 +1,156 @@
+/* How sakura scales with the number of tabs. sakura runs the "tabs" scenario under a private
+ * Xvfb: it opens tabs up to every size, and records memory, add-tab, page switch to frame and
+ * close-tab times at each one.
+ *
+ * Usage: sakura-tabs-bench [--sakura PATH] [--no-xvfb] [--sizes 1,10,50,100,500] [--runs N]
+ *                          [--output PREFIX]
+ *
+ * Prints a CSV table on stdout and writes it to PREFIX.csv, along with PREFIX.gp, a gnuplot
+ * script drawing the curves to PREFIX.png. Exits with status 1 when a sakura run fails. */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "harness.h"
+
+static const char *columns[] = {"rss_kb", "pss_kb", "add_us", "switch_us", "close_us"};
+
+static void usage()
+{
+	fprintf(stderr, "Usage: sakura-tabs-bench [--sakura PATH] [--no-xvfb] [--sizes LIST] "
+			"[--runs N] [--output PREFIX]\n");
+	exit(2);
+}
+
+static void write_plot(const std::string &prefix)
+{
+	std::string path = prefix + ".gp";
+	FILE *file = fopen(path.c_str(), "w");
+	if (!file) {
+		perror(path.c_str());
+		return;
+	}
+
+	/* Log scales: a linear cost is a straight line of slope 1, a quadratic one of slope 2 */
+	fprintf(file,
+			"set datafile separator ','\n"
+			"set terminal pngcairo size 1200,900\n"
+			"set output '%s.png'\n"
+			"set multiplot layout 2,2 title 'sakura tabs scaling'\n"
+			"set logscale xy\n"
+			"set key top left\n"
+			"set xlabel 'tabs'\n"
+			"set ylabel 'kB per tab'\n"
+			"plot '%s.csv' using 1:4 with linespoints title 'RSS', "
+			"'' using 1:5 with linespoints title 'PSS'\n"
+			"set ylabel 'us'\n"
+			"plot '%s.csv' using 1:6 with linespoints title 'add tab'\n"
+			"plot '%s.csv' using 1:7 with linespoints title 'switch to frame'\n"
+			"plot '%s.csv' using 1:8 with linespoints title 'close tab'\n"
+			"unset multiplot\n",
+			prefix.c_str(), prefix.c_str(), prefix.c_str(), prefix.c_str(),
+			prefix.c_str());
+	fclose(file);
+}
+
+int main(int argc, char **argv)
+{
+	Harness harness;
+	harness.parse_options(argc, argv);
+
+	std::string sizes = "1,10,50,100,500";
+	std::string prefix = "sakura-tabs";
+	int runs = 3;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--sizes") && i + 1 < argc) {
+			sizes = argv[++i];
+		} else if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+			runs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+			prefix = argv[++i];
+		} else {
+			usage();
+		}
+	}
+
+	if (runs <= 0)
+		usage();
+
+	std::vector<int> tabs;
+	std::stringstream list(sizes);
+	std::string size;
+	while (std::getline(list, size, ','))
+		tabs.push_back(atoi(size.c_str()));
+
+	if (!harness.setup())
+		return 2;
+
+	/* Median of every run, by size and column */
+	std::map<int, std::map<std::string, std::vector<double>>> values;
+	int status = 0;
+	for (int i = 0; i < runs; i++) {
+		SakuraRun run = harness.run({"--bench-scenario=tabs:" + sizes});
+		if (run.status != 0 || run.report.empty()) {
+			fprintf(stderr, "run %d: sakura failed (status %d)\n", i + 1, run.status);
+			status = 1;
+			continue;
+		}
+
+		for (int n : tabs) {
+			for (const char *column : columns) {
+				auto it = run.report.find("tabs_" + std::to_string(n) + "_" + column);
+				if (it != run.report.end())
+					values[n][column].push_back(it->second);
+			}
+		}
+	}
+
+	if (values.empty())
+		return 1;
+
+	std::string path = prefix + ".csv";
+	FILE *csv = fopen(path.c_str(), "w");
+	if (!csv) {
+		perror(path.c_str());
+		return 2;
+	}
+
+	const char *header = "tabs,rss_kb,pss_kb,rss_kb_per_tab,pss_kb_per_tab,add_us,switch_us,"
+			     "close_us\n";
+	fputs(header, stdout);
+	fputs(header, csv);
+
+	/* Memory per tab is the growth since the smallest size, so the memory sakura needs
+	 * without any tab does not hide the per tab cost */
+	int first = tabs.front();
+	double first_rss = median(values[first]["rss_kb"]);
+	double first_pss = median(values[first]["pss_kb"]);
+
+	for (int n : tabs) {
+		auto &v = values[n];
+		double rss = median(v["rss_kb"]);
+		double pss = median(v["pss_kb"]);
+		double added = n > first ? n - first : 1;
+		double rss_per_tab = n > first ? (rss - first_rss) / added : rss / n;
+		double pss_per_tab = n > first ? (pss - first_pss) / added : pss / n;
+
+		char line[256];
+		snprintf(line, sizeof(line), "%d,%.0f,%.0f,%.1f,%.1f,%.0f,%.0f,%.0f\n", n, rss, pss,
+				rss_per_tab, pss_per_tab, median(v["add_us"]),
+				median(v["switch_us"]), median(v["close_us"]));
+		fputs(line, stdout);
+		fputs(line, csv);
+	}
+	fclose(csv);
+
+	write_plot(prefix);
+	fprintf(stderr, "Wrote %s.csv and %s.gp, run \"gnuplot %s.gp\" to draw %s.png\n",
+			prefix.c_str(), prefix.c_str(), prefix.c_str(), prefix.c_str());
+
+	return status;
+}
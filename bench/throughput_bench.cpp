@@ -0,0 +1,250 @@
+/* How fast sakura drains output: every workload is generated once into a file, and sakura runs
+ * "cat FILE" with -x under a private Xvfb until the tab closes. The time of a run that only
+ * starts and exits sakura ("-x true") is subtracted, so MB/s only covers reading, parsing and
+ * drawing the output.
+ *
+ * Usage: sakura-throughput-bench [--sakura PATH] [--no-xvfb] [--size MB] [--runs N]
+ *                                [--workload NAME]...
+ *
+ * Prints one JSON object per workload on stdout. Exits with status 1 when a sakura run fails. */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "harness.h"
+
+struct Workload {
+	const char *name;
+	void (*generate)(std::string &out, size_t size);
+};
+
+/* Deterministic generator, so every run cats exactly the same bytes */
+static uint32_t next_random(uint32_t &state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static const char words[][12] = {"sakura", "terminal", "render", "buffer", "scroll", "cursor",
+		"glyph", "line", "output", "0x7ffd", "1024", "/usr/lib", "main.cpp", "--verbose"};
+
+static void append_word(std::string &out, uint32_t &state)
+{
+	out.append(words[next_random(state) % (sizeof(words) / sizeof(words[0]))]);
+}
+
+/* Plain text lines of varying length, like a build log or cat of a source file */
+static void generate_ascii(std::string &out, size_t size)
+{
+	uint32_t state = 0x1234567;
+	while (out.size() < size) {
+		size_t n = next_random(state) % 16;
+		for (size_t i = 0; i < n; i++) {
+			append_word(out, state);
+			out.push_back(' ');
+		}
+		out.push_back('\n');
+	}
+}
+
+/* Every word in its own 256 or true color, like colored ls or a syntax highlighter */
+static void generate_sgr(std::string &out, size_t size)
+{
+	uint32_t state = 0x2345678;
+	char buf[32];
+	while (out.size() < size) {
+		for (int i = 0; i < 10; i++) {
+			uint32_t r = next_random(state);
+			if (r & 1)
+				snprintf(buf, sizeof(buf), "\033[1;38;5;%um", r % 256);
+			else
+				snprintf(buf, sizeof(buf), "\033[38;2;%u;%u;%u;48;5;%um", r % 256,
+						(r >> 8) % 256, (r >> 16) % 256, (r >> 24) % 16);
+			out.append(buf);
+			append_word(out, state);
+			out.append("\033[0m ");
+		}
+		out.push_back('\n');
+	}
+}
+
+/* Wide CJK characters, emoji and combining marks */
+static void generate_unicode(std::string &out, size_t size)
+{
+	static const char *chars[] = {"日", "本", "語", "桜", "한", "글", "中", "文", "😀", "🌸",
+			"é", "ä", "ñ", "ß", "Ω", "→", "│", "─", "█", " "};
+	uint32_t state = 0x3456789;
+	while (out.size() < size) {
+		for (int i = 0; i < 40; i++)
+			out.append(chars[next_random(state) % (sizeof(chars) / sizeof(chars[0]))]);
+		out.push_back('\n');
+	}
+}
+
+/* A scroll region with lines inserted, deleted and scrolled inside it, like a pager or a TUI
+ * log pane */
+static void generate_scroll_region(std::string &out, size_t size)
+{
+	uint32_t state = 0x456789a;
+	char buf[32];
+	while (out.size() < size) {
+		uint32_t top = 2 + next_random(state) % 8;
+		snprintf(buf, sizeof(buf), "\033[%u;%ur\033[%u;1H", top, top + 12, top + 12);
+		out.append(buf);
+		for (int i = 0; i < 20; i++) {
+			switch (next_random(state) % 4) {
+			case 0: out.append("\033[2S"); break;
+			case 1: out.append("\033[T"); break;
+			case 2: out.append("\033[L"); break;
+			case 3: out.append("\033[M"); break;
+			}
+			append_word(out, state);
+			out.push_back(' ');
+			append_word(out, state);
+			out.push_back('\n');
+		}
+	}
+	out.append("\033[r");
+}
+
+/* Carriage return progress bars, like curl, pip or a compiler counting files */
+static void generate_progress(std::string &out, size_t size)
+{
+	char buf[128];
+	unsigned file = 0;
+	while (out.size() < size) {
+		for (int percent = 0; percent <= 100; percent++) {
+			std::string bar(percent / 2, '#');
+			bar.resize(50, ' ');
+			snprintf(buf, sizeof(buf), "\r\033[Kfile%u [%s] %3d%%", file, bar.c_str(),
+					percent);
+			out.append(buf);
+		}
+		out.push_back('\n');
+		file++;
+	}
+}
+
+static const Workload workloads[] = {
+		{"ascii", generate_ascii},
+		{"sgr", generate_sgr},
+		{"unicode", generate_unicode},
+		{"scroll-region", generate_scroll_region},
+		{"progress", generate_progress},
+};
+
+static void usage()
+{
+	fprintf(stderr, "Usage: sakura-throughput-bench [--sakura PATH] [--no-xvfb] [--size MB] "
+			"[--runs N] [--workload NAME]...\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	Harness harness;
+	harness.parse_options(argc, argv);
+
+	double size_mb = 64;
+	int runs = 5;
+	std::vector<std::string> selected;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--size") && i + 1 < argc) {
+			size_mb = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+			runs = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--workload") && i + 1 < argc) {
+			selected.push_back(argv[++i]);
+		} else {
+			usage();
+		}
+	}
+
+	if (size_mb <= 0 || runs <= 0)
+		usage();
+
+	for (const auto &name : selected) {
+		bool found = false;
+		for (const auto &workload : workloads)
+			found |= name == workload.name;
+		if (!found) {
+			fprintf(stderr, "Unknown workload %s\n", name.c_str());
+			return 2;
+		}
+	}
+
+	if (!harness.setup())
+		return 2;
+
+	/* Startup and shutdown cost, subtracted from every workload */
+	std::vector<double> baseline_wall, baseline_cpu;
+	for (int i = 0; i < runs; i++) {
+		SakuraRun run = harness.run({"-x", "true"});
+		if (run.status != 0 || run.report.empty()) {
+			fprintf(stderr, "sakura -x true failed (status %d)\n", run.status);
+			return 1;
+		}
+		baseline_wall.push_back(run.wall_seconds);
+		baseline_cpu.push_back(
+				(run.report["cpu_user_us"] + run.report["cpu_system_us"]) / 1e6);
+	}
+	double baseline = median(baseline_wall);
+	double baseline_cpu_seconds = median(baseline_cpu);
+
+	int status = 0;
+	for (const auto &workload : workloads) {
+		if (!selected.empty()) {
+			bool found = false;
+			for (const auto &name : selected)
+				found |= name == workload.name;
+			if (!found)
+				continue;
+		}
+
+		std::string data;
+		workload.generate(data, (size_t)(size_mb * 1024 * 1024));
+		std::string path = harness.tmpdir() + "/" + workload.name;
+		std::ofstream(path, std::ios::binary).write(data.data(), data.size());
+
+		std::vector<double> wall, frames, cpu_user, cpu_system, rss;
+		for (int i = 0; i < runs; i++) {
+			SakuraRun run = harness.run({"-x", "cat " + path});
+			if (run.status != 0 || run.report.empty()) {
+				fprintf(stderr, "%s: sakura failed (status %d)\n", workload.name,
+						run.status);
+				status = 1;
+				continue;
+			}
+			wall.push_back(run.wall_seconds);
+			frames.push_back(run.report["frames"]);
+			cpu_user.push_back(run.report["cpu_user_us"] / 1e6);
+			cpu_system.push_back(run.report["cpu_system_us"] / 1e6);
+			rss.push_back(run.report["max_rss_kb"]);
+		}
+
+		if (wall.empty())
+			continue;
+
+		double seconds = median(wall) - baseline;
+		double mb_per_s = seconds > 0 ? data.size() / seconds / 1e6 : 0;
+
+		printf("{\"workload\":\"%s\",\"bytes\":%zu,\"runs\":%zu,\"wall_s\":%.3f,"
+		       "\"baseline_s\":%.3f,\"mb_per_s\":%.2f,\"frames\":%.0f,\"cpu_user_s\":%.3f,"
+		       "\"cpu_system_s\":%.3f,\"baseline_cpu_s\":%.3f,\"max_rss_kb\":%.0f}\n",
+				json_escape(workload.name).c_str(), data.size(), wall.size(),
+				median(wall), baseline, mb_per_s, median(frames), median(cpu_user),
+				median(cpu_system), baseline_cpu_seconds, median(rss));
+		fflush(stdout);
+
+		remove(path.c_str());
+	}
+
+	return status;
+}
@@ -0,0 +1,283 @@
+#include "asciicast.h"
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#define FLUSH_INTERVAL_US G_USEC_PER_SEC
+#define REPLACEMENT_CHARACTER "\xef\xbf\xbd"
+
+static void append_escaped(std::string &out, const char *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = data[i];
+		switch (c) {
+		case '"': out.append("\\\""); break;
+		case '\\': out.append("\\\\"); break;
+		case '\n': out.append("\\n"); break;
+		case '\r': out.append("\\r"); break;
+		case '\t': out.append("\\t"); break;
+		case '\b': out.append("\\b"); break;
+		default:
+			if (c < 0x20 || c == 0x7f) {
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04x", c);
+				out.append(buf);
+			} else {
+				out.push_back(c);
+			}
+		}
+	}
+}
+
+/* Length of the UTF-8 sequence started by lead, 0 if it cannot start one */
+static size_t utf8_sequence_length(unsigned char lead)
+{
+	if (lead >= 0xc2 && lead <= 0xdf)
+		return 2;
+	if (lead >= 0xe0 && lead <= 0xef)
+		return 3;
+	if (lead >= 0xf0 && lead <= 0xf4)
+		return 4;
+	return 0;
+}
+
+AsciicastWriter::~AsciicastWriter()
+{
+	close();
+}
+
+bool AsciicastWriter::open(const char *path, glong columns, glong rows)
+{
+	m_file = fopen(path, "w");
+	if (!m_file)
+		return false;
+
+	const char *shell = g_getenv("SHELL");
+	std::string escaped_shell;
+	append_escaped(escaped_shell, shell ? shell : "", shell ? strlen(shell) : 0);
+
+	fprintf(m_file,
+			"{\"version\": 2, \"width\": %ld, \"height\": %ld, \"timestamp\": %ld, "
+			"\"env\": {\"TERM\": \"xterm-256color\", \"SHELL\": \"%s\"}}\n",
+			columns, rows, (long)time(nullptr), escaped_shell.c_str());
+
+	m_start = m_last_flush = g_get_monotonic_time();
+	return true;
+}
+
+void AsciicastWriter::close()
+{
+	if (m_file) {
+		fclose(m_file);
+		m_file = nullptr;
+	}
+}
+
+double AsciicastWriter::elapsed() const
+{
+	return (g_get_monotonic_time() - m_start) / (double)G_USEC_PER_SEC;
+}
+
+void AsciicastWriter::event(const char *type, const char *data, size_t len)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), "[%.6f, \"%s\", \"", elapsed(), type);
+
+	m_line.assign(buf);
+	append_escaped(m_line, data, len);
+	m_line.append("\"]\n");
+	fwrite(m_line.data(), 1, m_line.size(), m_file);
+
+	/* Keep the recording useful if sakura crashes, which is often why it is recorded */
+	gint64 now = g_get_monotonic_time();
+	if (now - m_last_flush > FLUSH_INTERVAL_US) {
+		fflush(m_file);
+		m_last_flush = now;
+	}
+}
+
+void AsciicastWriter::output(const char *data, size_t len)
+{
+	if (!m_file || len == 0)
+		return;
+
+	/* asciicast data must be valid UTF-8: a sequence split between two reads is completed by
+	 * the next one, and bytes that can never be valid become U+FFFD */
+	std::string chunk;
+	if (!m_pending.empty()) {
+		chunk = m_pending;
+		chunk.append(data, len);
+		data = chunk.data();
+		len = chunk.size();
+		m_pending.clear();
+	}
+
+	std::string valid;
+	const char *p = data;
+	const char *stop = data + len;
+	while (p < stop) {
+		const gchar *end;
+		if (g_utf8_validate(p, stop - p, &end)) {
+			valid.append(p, stop - p);
+			break;
+		}
+		valid.append(p, end - p);
+		p = end;
+
+		if (*p == '\0') {
+			valid.push_back('\0');
+			p++;
+			continue;
+		}
+
+		size_t needed = utf8_sequence_length(*p);
+		bool truncated = needed > (size_t)(stop - p);
+		for (const char *c = p + 1; truncated && c < stop; c++)
+			truncated = ((unsigned char)*c & 0xc0) == 0x80;
+
+		if (truncated) {
+			m_pending.assign(p, stop - p);
+			break;
+		}
+
+		valid.append(REPLACEMENT_CHARACTER);
+		p++;
+	}
+
+	if (!valid.empty())
+		event("o", valid.data(), valid.size());
+}
+
+void AsciicastWriter::resize(glong columns, glong rows)
+{
+	if (!m_file)
+		return;
+
+	char buf[32];
+	int len = snprintf(buf, sizeof(buf), "%ldx%ld", columns, rows);
+	event("r", buf, len);
+}
+
+AsciicastReader::~AsciicastReader()
+{
+	if (m_mapped)
+		g_mapped_file_unref(m_mapped);
+}
+
+bool AsciicastReader::open(const char *path, GError **error)
+{
+	m_mapped = g_mapped_file_new(path, FALSE, error);
+	if (!m_mapped)
+		return false;
+
+	m_pos = g_mapped_file_get_contents(m_mapped);
+	m_end = m_pos + g_mapped_file_get_length(m_mapped);
+
+	const char *eol = m_pos ? (const char *)memchr(m_pos, '\n', m_end - m_pos) : nullptr;
+	std::string header(m_pos ? m_pos : "", eol ? eol - m_pos : 0);
+	if (!eol || (header.find("\"version\": 2") == std::string::npos &&
+				    header.find("\"version\":2") == std::string::npos)) {
+		g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				"%s is not an asciicast v2 recording", path);
+		return false;
+	}
+
+	size_t width = header.find("\"width\":");
+	if (width != std::string::npos)
+		m_columns = strtol(header.c_str() + width + 8, nullptr, 10);
+	size_t height = header.find("\"height\":");
+	if (height != std::string::npos)
+		m_rows = strtol(header.c_str() + height + 9, nullptr, 10);
+
+	m_pos = eol + 1;
+	return true;
+}
+
+static void skip_separators(const char *&p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == ',' || *p == '\t'))
+		p++;
+}
+
+bool AsciicastReader::parse_string(const char *&p, std::string &out)
+{
+	out.clear();
+	if (p >= m_end || *p != '"')
+		return false;
+
+	for (p++; p < m_end && *p != '"'; p++) {
+		/* Copy unescaped runs in one go */
+		const char *run = p;
+		while (p < m_end && *p != '"' && *p != '\\')
+			p++;
+		out.append(run, p - run);
+		if (p >= m_end || *p == '"')
+			break;
+
+		if (++p >= m_end)
+			return false;
+
+		switch (*p) {
+		case 'n': out.push_back('\n'); break;
+		case 'r': out.push_back('\r'); break;
+		case 't': out.push_back('\t'); break;
+		case 'b': out.push_back('\b'); break;
+		case 'f': out.push_back('\f'); break;
+		case 'u': {
+			if (m_end - p < 5)
+				return false;
+			gunichar c = g_ascii_strtoull(std::string(p + 1, 4).c_str(), nullptr, 16);
+			p += 4;
+			/* Characters outside the BMP come as a surrogate pair */
+			if (c >= 0xd800 && c <= 0xdbff && m_end - p > 6 && p[1] == '\\' &&
+					p[2] == 'u') {
+				gunichar low = g_ascii_strtoull(
+						std::string(p + 3, 4).c_str(), nullptr, 16);
+				c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+				p += 6;
+			}
+			char buf[6];
+			out.append(buf, g_unichar_to_utf8(c, buf));
+			break;
+		}
+		default: out.push_back(*p); break;
+		}
+	}
+
+	if (p >= m_end)
+		return false;
+	p++;
+	return true;
+}
+
+bool AsciicastReader::next(double &time, const std::string *&data)
+{
+	while (m_pos < m_end) {
+		const char *eol = (const char *)memchr(m_pos, '\n', m_end - m_pos);
+		if (!eol)
+			eol = m_end;
+
+		const char *p = m_pos;
+		m_pos = eol + 1;
+
+		while (p < eol && (*p == ' ' || *p == '['))
+			p++;
+		if (p >= eol)
+			continue;
+
+		char *after;
+		time = g_ascii_strtod(p, &after);
+		p = after;
+		skip_separators(p, eol);
+		if (!parse_string(p, m_type) || m_type != "o")
+			continue;
+		skip_separators(p, eol);
+		if (!parse_string(p, m_data))
+			continue;
+
+		data = &m_data;
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <glib.h>
+
+/* Reading and writing of asciicast v2 recordings (https://docs.asciinema.org/manual/asciicast/v2/):
+ * a JSON header line followed by one [time, type, data] JSON array per line. */
+
+class AsciicastWriter
+{
+public:
+	AsciicastWriter() = default;
+	~AsciicastWriter();
+
+	bool open(const char *path, glong columns, glong rows);
+	void close();
+	bool is_open() const { return m_file != nullptr; }
+
+	/* Output read from the child, split anywhere, even inside a UTF-8 sequence */
+	void output(const char *data, size_t len);
+	void resize(glong columns, glong rows);
+
+private:
+	void event(const char *type, const char *data, size_t len);
+	double elapsed() const;
+
+	FILE *m_file = nullptr;
+	gint64 m_start = 0;
+	gint64 m_last_flush = 0;
+	std::string m_pending; /* Incomplete UTF-8 sequence left over by the last output() */
+	std::string m_line;
+};
+
+class AsciicastReader
+{
+public:
+	AsciicastReader() = default;
+	~AsciicastReader();
+
+	/* Maps the file and parses the header */
+	bool open(const char *path, GError **error);
+
+	/* Next output event. Input and resize events are skipped. The returned data is valid
+	 * until the next call */
+	bool next(double &time, const std::string *&data);
+
+	glong columns() const { return m_columns; }
+	glong rows() const { return m_rows; }
+
+private:
+	bool parse_string(const char *&p, std::string &out);
+
+	GMappedFile *m_mapped = nullptr;
+	const char *m_pos = nullptr;
+	const char *m_end = nullptr;
+	glong m_columns = 0;
+	glong m_rows = 0;
+	std::string m_type;
+	std::string m_data;
+};
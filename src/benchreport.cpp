@@ -0,0 +1,93 @@
+#include "benchreport.h"
+#include <cstdio>
+#include <sys/resource.h>
+
+BenchReport &BenchReport::get()
+{
+	static BenchReport report;
+	return report;
+}
+
+void BenchReport::open(const char *path)
+{
+	m_path = path;
+}
+
+void BenchReport::set(const char *name, gint64 value)
+{
+	if (!is_enabled())
+		return;
+
+	m_values.emplace_back(name, value);
+}
+
+void BenchReport::mark(const char *name)
+{
+	m_marks.emplace_back(name, g_get_monotonic_time());
+}
+
+void BenchReport::after_paint_cb(GdkFrameClock *clock, void *data)
+{
+	auto obj = (BenchReport *)data;
+	if (obj->m_frames++ == 0)
+		obj->mark("first_frame");
+}
+
+void BenchReport::count_frames(GtkWidget *window)
+{
+	if (!is_enabled())
+		return;
+
+	GdkFrameClock *clock = gtk_widget_get_frame_clock(window);
+	if (clock) {
+		g_signal_connect(clock, "after-paint", G_CALLBACK(BenchReport::after_paint_cb), this);
+	}
+}
+
+/* Marks the first time the child output changes the terminal contents, usually its prompt */
+void BenchReport::watch_output(GtkWidget *vte)
+{
+	if (!is_enabled())
+		return;
+
+	g_signal_connect(vte, "contents-changed", G_CALLBACK(BenchReport::contents_changed_cb), this);
+}
+
+void BenchReport::contents_changed_cb(GtkWidget *vte, void *data)
+{
+	auto obj = (BenchReport *)data;
+
+	obj->mark("first_output");
+	g_signal_handlers_disconnect_by_func(
+			vte, (gpointer)BenchReport::contents_changed_cb, data);
+}
+
+void BenchReport::write()
+{
+	if (!is_enabled())
+		return;
+
+	FILE *file = fopen(m_path.c_str(), "w");
+	if (!file) {
+		perror(m_path.c_str());
+		return;
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	fprintf(file, "frames %" G_GINT64_FORMAT "\n", m_frames);
+	fprintf(file, "cpu_user_us %ld\n",
+			usage.ru_utime.tv_sec * 1000000L + (long)usage.ru_utime.tv_usec);
+	fprintf(file, "cpu_system_us %ld\n",
+			usage.ru_stime.tv_sec * 1000000L + (long)usage.ru_stime.tv_usec);
+	fprintf(file, "max_rss_kb %ld\n", usage.ru_maxrss);
+	for (const auto &value : m_values) {
+		fprintf(file, "%s %" G_GINT64_FORMAT "\n", value.first.c_str(), value.second);
+	}
+	for (const auto &mark : m_marks) {
+		fprintf(file, "mark_%s %" G_GINT64_FORMAT "\n", mark.first.c_str(), mark.second);
+	}
+
+	fclose(file);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <gtk/gtk.h>
+
+/**
+ * Numbers collected for the benchmark drivers in bench/. Disabled unless sakura is started
+ * with the hidden --bench-report=FILE option, in which case they are written to FILE as
+ * "name value" lines when sakura exits.
+ *
+ * Marks are the monotonic time, in microseconds, at which startup reached a given point. They
+ * are kept even before the report is opened, so the earliest ones are not lost.
+ */
+class BenchReport
+{
+public:
+	static BenchReport &get();
+
+	void open(const char *path);
+	bool is_enabled() const { return !m_path.empty(); }
+
+	void set(const char *name, gint64 value);
+	void mark(const char *name);
+	void count_frames(GtkWidget *window);
+	void watch_output(GtkWidget *vte);
+	void write();
+
+private:
+	BenchReport() = default;
+	static void after_paint_cb(GdkFrameClock *clock, void *data);
+	static void contents_changed_cb(GtkWidget *vte, void *data);
+
+	std::string m_path;
+	std::vector<std::pair<std::string, gint64>> m_values;
+	std::vector<std::pair<std::string, gint64>> m_marks;
+	gint64 m_frames = 0;
+};
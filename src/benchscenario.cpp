@@ -0,0 +1,440 @@
+#include "benchscenario.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vte/vte.h>
+#include "benchreport.h"
+#include "core/trace.h"
+#include "notebook.h"
+#include "sakuraold.h"
+#include "terminal.h"
+#include "window.h"
+
+/* Page switches timed at every size of the tabs scenario */
+#define TABS_SWITCHES 20
+/* Resize scenario: lines fed per step, single resizes and their spacing, which must be longer
+ * than the time a terminal waits for a drag to settle, and steps of the drag */
+#define RESIZE_FILL_LINES 5000
+#define RESIZE_COUNT 10
+#define RESIZE_PAUSE_MS 300
+#define RESIZE_DRAG_STEPS 30
+#define RESIZE_MAX_WAITS 120
+
+static std::unique_ptr<BenchScenario> scenario;
+
+void BenchScenario::wait_frame()
+{
+	if (!m_clock) {
+		m_clock = gtk_widget_get_frame_clock(GTK_WIDGET(sakura->main_window->gobj()));
+		g_signal_connect(m_clock, "after-paint", G_CALLBACK(BenchScenario::after_paint_cb),
+				this);
+	}
+
+	/* Paint even if the step did not change anything, so the scenario never stalls */
+	m_waiting = true;
+	gdk_frame_clock_request_phase(m_clock, GDK_FRAME_CLOCK_PHASE_PAINT);
+}
+
+void BenchScenario::after_paint_cb(GdkFrameClock *clock, void *data)
+{
+	auto obj = (BenchScenario *)data;
+
+	if (!obj->m_waiting)
+		return;
+
+	obj->m_waiting = false;
+	obj->m_frame_time = g_get_monotonic_time();
+	/* Not from the paint itself, steps add and remove widgets */
+	g_idle_add(BenchScenario::step_cb, obj);
+}
+
+gboolean BenchScenario::step_cb(void *data)
+{
+	auto obj = (BenchScenario *)data;
+
+	obj->step();
+	return G_SOURCE_REMOVE;
+}
+
+void bench_memory_usage(gint64 &rss_kb, gint64 &pss_kb)
+{
+	rss_kb = pss_kb = 0;
+
+	/* smaps_rollup is cheap even with thousands of mappings, but needs linux 4.14 */
+	FILE *file = fopen("/proc/self/smaps_rollup", "r");
+	if (file) {
+		char line[256];
+		while (fgets(line, sizeof(line), file)) {
+			sscanf(line, "Rss: %" G_GINT64_FORMAT, &rss_kb);
+			sscanf(line, "Pss: %" G_GINT64_FORMAT, &pss_kb);
+		}
+		fclose(file);
+		return;
+	}
+
+	file = fopen("/proc/self/statm", "r");
+	if (file) {
+		long pages, resident;
+		if (fscanf(file, "%ld %ld", &pages, &resident) == 2)
+			rss_kb = resident * (sysconf(_SC_PAGESIZE) / 1024);
+		fclose(file);
+	}
+}
+
+gint64 bench_median(std::vector<gint64> values)
+{
+	if (values.empty())
+		return 0;
+
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+/**
+ * Opens tabs up to every given size, and at each one records the memory used, the add-tab
+ * time since the previous size and the page switch to frame time. Then closes every tab,
+ * recording the close-tab time by size, which exits sakura.
+ */
+class TabsScenario : public BenchScenario
+{
+public:
+	TabsScenario(std::vector<int> sizes) : m_sizes(std::move(sizes)) {}
+
+	void step() override;
+
+private:
+	enum State { ADD, SWITCH, CLOSE };
+
+	void set(int size, const char *name, gint64 value);
+	void report_size();
+
+	std::vector<int> m_sizes;
+	size_t m_size = 0; /* Index of the size we are growing to */
+	State m_state = ADD;
+	gint64 m_start = 0;
+	int m_switches = 0;
+	std::vector<gint64> m_add_times;
+	std::vector<gint64> m_switch_times;
+	std::map<int, std::vector<gint64>> m_close_times;
+};
+
+void TabsScenario::set(int size, const char *name, gint64 value)
+{
+	gchar *key = g_strdup_printf("tabs_%d_%s", size, name);
+	BenchReport::get().set(key, value);
+	g_free(key);
+}
+
+void TabsScenario::report_size()
+{
+	int size = m_sizes[m_size];
+	gint64 rss_kb, pss_kb;
+
+	bench_memory_usage(rss_kb, pss_kb);
+	set(size, "rss_kb", rss_kb);
+	set(size, "pss_kb", pss_kb);
+	set(size, "add_us", bench_median(m_add_times));
+	set(size, "switch_us", bench_median(m_switch_times));
+	TRACE_MSG("%d tabs: rss %" G_GINT64_FORMAT " kB", size, rss_kb);
+
+	m_add_times.clear();
+	m_switch_times.clear();
+}
+
+void TabsScenario::step()
+{
+	auto &notebook = sakura->main_window->notebook;
+	int npages = notebook.get_n_pages();
+
+	/* The frame of the previous step */
+	if (m_state == SWITCH && m_switches > 0) {
+		m_switch_times.push_back(m_frame_time - m_start);
+	} else if (m_state == CLOSE && m_start) {
+		/* Closes are accounted to the smallest size that had as many tabs */
+		auto size = std::lower_bound(m_sizes.begin(), m_sizes.end(), npages + 1);
+		if (size != m_sizes.end())
+			m_close_times[*size].push_back(m_frame_time - m_start);
+	}
+
+	if (m_state == ADD) {
+		if (npages < m_sizes[m_size]) {
+			gint64 start = g_get_monotonic_time();
+			notebook.add_tab();
+			m_add_times.push_back(g_get_monotonic_time() - start);
+			wait_frame();
+			return;
+		}
+		m_state = SWITCH;
+		m_switches = 0;
+	}
+
+	if (m_state == SWITCH) {
+		if (npages > 1 && m_switches < TABS_SWITCHES) {
+			/* Always another page, so there is something to draw */
+			int offset = 1 + g_random_int_range(0, npages - 1);
+			int page = (notebook.get_current_page() + offset) % npages;
+			m_switches++;
+			m_start = g_get_monotonic_time();
+			notebook.set_current_page(page);
+			wait_frame();
+			return;
+		}
+
+		report_size();
+		if (++m_size < m_sizes.size()) {
+			m_state = ADD;
+		} else {
+			m_state = CLOSE;
+			m_start = 0;
+		}
+		step();
+		return;
+	}
+
+	if (npages > 1) {
+		m_start = g_get_monotonic_time();
+		notebook.del_tab(npages - 1);
+		wait_frame();
+		return;
+	}
+
+	for (const auto &times : m_close_times)
+		set(times.first, "close_us", bench_median(times.second));
+
+	/* Closing the last tab exits sakura, which writes the report */
+	notebook.del_tab(0, true);
+}
+
+/**
+ * Opens tabs holding lines of scrollback each, then times what a window resize costs: single
+ * resizes to the frame where the current terminal has its new width, the frames of a drag and
+ * the time until the drag settles, and switches to the other tabs after all that, when they
+ * get their new width. Lines are longer than the terminal, so every resize rewraps them.
+ */
+class ResizeScenario : public BenchScenario
+{
+public:
+	ResizeScenario(int tabs, int lines);
+
+	void step() override;
+
+private:
+	enum State { FILL, RESIZE, DRAG, SETTLE, SWITCH, CLOSE };
+
+	/* Resizes the window by the given columns of the current terminal, from the last target */
+	void resize(int columns);
+	void pause();
+	static gboolean pause_cb(void *data);
+
+	int m_tabs;
+	int m_lines;
+	State m_state = FILL;
+	int m_filled = 0; /* Lines fed to the last tab */
+	std::string m_chunk;
+	int m_count = 0;
+	int m_waits = 0;
+	bool m_paused = false;
+	int m_base_width = 0;  /* Of the window when the resizes start */
+	long m_base_columns = 0;
+	long m_target = 0;     /* Columns of the current terminal once the last resize is done */
+	gint64 m_start = 0;
+	std::vector<gint64> m_resize_times;
+	std::vector<gint64> m_drag_times;
+	std::vector<gint64> m_switch_times;
+};
+
+ResizeScenario::ResizeScenario(int tabs, int lines) : m_tabs(tabs), m_lines(lines)
+{
+	for (int i = 0; i < RESIZE_FILL_LINES; i++)
+		m_chunk += "line " + std::to_string(i) + ": " + std::string(100 + i % 60, 'x') +
+			   "\r\n";
+}
+
+void ResizeScenario::resize(int columns)
+{
+	auto term = sakura->main_window->notebook.get_current_tab_term();
+	int width, height;
+
+	/* The terminal is behind during a drag, the sizes come from the targets */
+	sakura->main_window->get_size(width, height);
+	if (!m_base_width) {
+		m_base_width = width;
+		m_base_columns = vte_terminal_get_column_count(VTE_TERMINAL(term->vte));
+		m_target = m_base_columns;
+	}
+	m_target += columns;
+	m_start = g_get_monotonic_time();
+	sakura->main_window->resize(m_base_width + (m_target - m_base_columns) *
+			vte_terminal_get_char_width(VTE_TERMINAL(term->vte)), height);
+}
+
+void ResizeScenario::pause()
+{
+	g_timeout_add(RESIZE_PAUSE_MS, ResizeScenario::pause_cb, this);
+}
+
+gboolean ResizeScenario::pause_cb(void *data)
+{
+	auto obj = (ResizeScenario *)data;
+
+	obj->wait_frame();
+	return G_SOURCE_REMOVE;
+}
+
+void ResizeScenario::step()
+{
+	auto &notebook = sakura->main_window->notebook;
+	int npages = notebook.get_n_pages();
+	auto term = notebook.get_current_tab_term();
+	long columns = vte_terminal_get_column_count(VTE_TERMINAL(term->vte));
+
+	switch (m_state) {
+	case FILL:
+		if (m_filled >= m_lines) {
+			if (npages >= m_tabs) {
+				m_state = RESIZE;
+				step();
+				return;
+			}
+			notebook.add_tab();
+			term = notebook.get_tab_term(npages);
+			m_filled = 0;
+		}
+		if (m_filled == 0)
+			vte_terminal_set_scrollback_lines(VTE_TERMINAL(term->vte), m_lines);
+		vte_terminal_feed(VTE_TERMINAL(term->vte), m_chunk.data(), m_chunk.size());
+		m_filled += RESIZE_FILL_LINES;
+		wait_frame();
+		return;
+
+	case RESIZE:
+		/* Wait for the frame where the terminal has its new width */
+		if (m_count > 0 && !m_paused && columns != m_target &&
+				++m_waits < RESIZE_MAX_WAITS) {
+			wait_frame();
+			return;
+		}
+		if (m_count > 0 && !m_paused)
+			m_resize_times.push_back(m_frame_time - m_start);
+		m_waits = 0;
+
+		if (m_count < RESIZE_COUNT) {
+			/* Spaced out, so every resize is applied right away. They grow the window
+			 * overall, so the other tabs need a new width when they are shown */
+			if (!m_paused) {
+				m_paused = true;
+				pause();
+				return;
+			}
+			m_paused = false;
+			resize(m_count % 2 ? -4 : 8);
+			m_count++;
+			wait_frame();
+			return;
+		}
+		m_state = DRAG;
+		m_count = 0;
+		step();
+		return;
+
+	case DRAG:
+		/* Away from the last resize, so the drag starts with an applied resize like a real
+		 * one, and ends away from that size, so the settle rewraps */
+		if (m_count == 0 && !m_paused) {
+			m_paused = true;
+			pause();
+			return;
+		}
+		if (m_count > 0)
+			m_drag_times.push_back(m_frame_time - m_start);
+		if (m_count < RESIZE_DRAG_STEPS) {
+			resize(m_count < RESIZE_DRAG_STEPS * 2 / 3 ? 1 : -1);
+			m_count++;
+			wait_frame();
+			return;
+		}
+		m_paused = false;
+		m_state = SETTLE;
+		wait_frame();
+		return;
+
+	case SETTLE:
+		if (columns != m_target && ++m_waits < RESIZE_MAX_WAITS) {
+			wait_frame();
+			return;
+		}
+		BenchReport::get().set("resize_drag_settle_us", m_frame_time - m_start);
+		m_state = SWITCH;
+		m_count = 0;
+		pause();
+		return;
+
+	case SWITCH:
+		if (m_count > 0)
+			m_switch_times.push_back(m_frame_time - m_start);
+		if (m_count < npages - 1) {
+			m_count++;
+			m_start = g_get_monotonic_time();
+			notebook.set_current_page((notebook.get_current_page() + 1) % npages);
+			wait_frame();
+			return;
+		}
+		m_state = CLOSE;
+		step();
+		return;
+
+	case CLOSE:
+		BenchReport::get().set("resize_tabs", npages);
+		BenchReport::get().set("resize_lines", m_lines);
+		BenchReport::get().set("resize_us", bench_median(m_resize_times));
+		BenchReport::get().set("resize_drag_frame_us", bench_median(m_drag_times));
+		BenchReport::get().set("resize_switch_us", bench_median(m_switch_times));
+
+		while (notebook.get_n_pages() > 1)
+			notebook.del_tab(notebook.get_n_pages() - 1);
+		/* Closing the last tab exits sakura, which writes the report */
+		notebook.del_tab(0, true);
+		return;
+	}
+}
+
+bool BenchScenario::start(const char *spec)
+{
+	const char *args = strchr(spec, ':');
+	std::string name(spec, args ? args - spec : strlen(spec));
+
+	if (name == "tabs") {
+		std::vector<int> sizes;
+		gchar **values = g_strsplit(args ? args + 1 : "1,10,50,100,500", ",", 0);
+		for (int i = 0; values[i]; i++) {
+			int size = atoi(values[i]);
+			if (size <= 0 || (!sizes.empty() && size <= sizes.back())) {
+				g_strfreev(values);
+				return false;
+			}
+			sizes.push_back(size);
+		}
+		g_strfreev(values);
+
+		if (sizes.empty())
+			return false;
+		scenario = std::make_unique<TabsScenario>(sizes);
+	} else if (name == "resize") {
+		int tabs = 10, lines = 100000;
+		if (args && sscanf(args + 1, "%d,%d", &tabs, &lines) != 2)
+			return false;
+		if (tabs <= 0 || lines <= 0)
+			return false;
+		scenario = std::make_unique<ResizeScenario>(tabs, lines);
+	} else {
+		return false;
+	}
+
+	scenario->wait_frame();
+	return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <gtk/gtk.h>
+
+/**
+ * Scripted sessions run by sakura itself for the benchmark drivers in bench/, started with the
+ * hidden --bench-scenario=NAME[:ARGS] option. Every step waits for the frame it caused, so
+ * latencies include drawing. Results go to the bench report.
+ */
+class BenchScenario
+{
+public:
+	/* Returns false if the scenario does not exist or its arguments are wrong */
+	static bool start(const char *spec);
+	virtual ~BenchScenario() = default;
+
+protected:
+	BenchScenario() = default;
+
+	/* Runs the next step once a frame has been painted */
+	void wait_frame();
+	virtual void step() = 0;
+
+	gint64 m_frame_time = 0; /* When the frame we waited for was painted */
+
+private:
+	static void after_paint_cb(GdkFrameClock *clock, void *data);
+	static gboolean step_cb(void *data);
+
+	GdkFrameClock *m_clock = nullptr;
+	bool m_waiting = false;
+};
+
+/* Reads the resident and proportional set sizes of sakura, in kB */
+void bench_memory_usage(gint64 &rss_kb, gint64 &pss_kb);
+gint64 bench_median(std::vector<gint64> values);
@@ -0,0 +1,72 @@
+#include "broadcast.h"
+#include <algorithm>
+#include <vte/vte.h>
+#include "core/trace.h"
+#include "sakura.h"
+#include "sakuraold.h"
+#include "terminal.h"
+#include "window.h"
+
+Broadcaster &Broadcaster::get()
+{
+	static Broadcaster broadcaster;
+	return broadcaster;
+}
+
+void Broadcaster::toggle(Terminal *term)
+{
+	if (term->broadcast) {
+		remove(term);
+	} else {
+		term->broadcast = true;
+		m_group.push_back({term, std::string()});
+		term->broadcast_icon.show();
+	}
+	sakura->main_window->tab_bar.update(term);
+	TRACE_MSG("Broadcast group of %zu tabs", m_group.size());
+}
+
+void Broadcaster::remove(Terminal *term)
+{
+	if (!term->broadcast)
+		return;
+
+	term->broadcast = false;
+	term->broadcast_icon.hide();
+	m_group.erase(std::remove_if(m_group.begin(), m_group.end(),
+				      [term](const Target &target) { return target.term == term; }),
+			m_group.end());
+}
+
+void Broadcaster::input(Terminal *term, const char *text, size_t size)
+{
+	if (m_flushing || !term->broadcast)
+		return;
+
+	for (auto &target : m_group) {
+		if (target.term != term)
+			target.pending.append(text, size);
+	}
+
+	if (!m_flush_source)
+		m_flush_source = g_idle_add_full(
+				G_PRIORITY_DEFAULT, Broadcaster::flush_cb, this, NULL);
+}
+
+gboolean Broadcaster::flush_cb(gpointer data)
+{
+	auto obj = (Broadcaster *)data;
+
+	obj->m_flush_source = 0;
+	obj->m_flushing = true;
+	for (auto &target : obj->m_group) {
+		if (target.pending.empty())
+			continue;
+		vte_terminal_feed_child(VTE_TERMINAL(target.term->vte), target.pending.data(),
+				target.pending.size());
+		target.pending.clear();
+	}
+	obj->m_flushing = false;
+
+	return G_SOURCE_REMOVE;
+}
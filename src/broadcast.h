@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <glib.h>
+
+class Terminal;
+
+/**
+ * Broadcast group: what is typed or pasted into one of its tabs is sent to all the others,
+ * toggled per tab with Ctrl+Shift+B. The input is taken from the "commit" signal, so the other
+ * tabs get the exact bytes the first one got, whatever produced them (keys, input methods,
+ * pastes).
+ *
+ * The input of each target is coalesced and handed to VTE with vte_terminal_feed_child once per
+ * main loop iteration. VTE writes it to the pty without blocking, so a target that does not
+ * read its input does not hold back the others.
+ */
+class Broadcaster
+{
+public:
+	static Broadcaster &get();
+
+	void toggle(Terminal *term);
+	void remove(Terminal *term);
+	/* Input committed by a tab, fanned out when the tab is in the group */
+	void input(Terminal *term, const char *text, size_t size);
+
+private:
+	struct Target {
+		Terminal *term;
+		std::string pending;
+	};
+
+	Broadcaster() = default;
+	static gboolean flush_cb(gpointer data);
+
+	std::vector<Target> m_group;
+	guint m_flush_source = 0;
+	bool m_flushing = false; /* Our own feeds are committed too, they are not fanned out */
+};
@@ -0,0 +1,287 @@
+#include "configdata.h"
+#include "keybindings.h"
+#include <iostream>
+#include <yaml-cpp/yaml.h>
+
+std::string ConfigData::load_file(const std::string &path)
+{
+	try {
+		ConfigData data = *this;
+		data.parse(YAML::LoadFile(path));
+		*this = data;
+	} catch (const YAML::Exception &e) {
+		return e.what();
+	}
+
+	return std::string();
+}
+
+std::string ConfigData::load_string(const std::string &yaml)
+{
+	try {
+		ConfigData data = *this;
+		data.parse(YAML::Load(yaml));
+		*this = data;
+	} catch (const YAML::Exception &e) {
+		return e.what();
+	}
+
+	return std::string();
+}
+
+void ConfigData::parse(const YAML::Node &config)
+{
+	if (config["last_colorset"]) {
+		last_colorset = config["last_colorset"].as<int>();
+	}
+
+	if (config["scroll_lines"]) {
+		scroll_lines = config["scroll_lines"].as<int>();
+	}
+
+	if (config["font"]) {
+		font_name = config["font"].as<std::string>();
+	}
+
+	if (config["show_always_first_tab"]) {
+		first_tab = config["show_always_first_tab"].as<bool>();
+	}
+
+	if (config["scrollbar"]) {
+		show_scrollbar = config["scrollbar"].as<bool>();
+	}
+
+	if (config["closebutton"]) {
+		show_closebutton = config["closebutton"].as<bool>();
+	}
+
+	if (config["tabs_on_bottom"]) {
+		tabs_on_bottom = config["tabs_on_bottom"].as<bool>();
+	}
+
+	if (config["less_questions"]) {
+		less_questions = config["less_questions"].as<bool>();
+	}
+
+	if (config["disable_numbered_tabswitch"]) {
+		disable_numbered_tabswitch = config["disable_numbered_tabswitch"].as<bool>();
+	}
+
+	if (config["use_fading"]) {
+		use_fading = config["use_fading"].as<bool>();
+	}
+
+	if (config["scrollable_tabs"]) {
+		scrollable_tabs = config["scrollable_tabs"].as<bool>();
+	}
+
+	if (config["urgent_bell"]) {
+		urgent_bell = config["urgent_bell"].as<bool>();
+	}
+
+	if (config["audible_bell"]) {
+		audible_bell = config["audible_bell"].as<bool>();
+	}
+
+	if (config["blinking_cursor"]) {
+		blinking_cursor = config["blinking_cursor"].as<bool>();
+	}
+
+	if (config["stop_tab_cycling_at_end_tabs"]) {
+		stop_tab_cycling_at_end_tabs = config["stop_tab_cycling_at_end_tabs"].as<bool>();
+	}
+
+	if (config["allow_bold"]) {
+		allow_bold = config["allow_bold"].as<bool>();
+	}
+
+	if (config["resource_meter"]) {
+		resource_meter = config["resource_meter"].as<bool>();
+	}
+
+	if (config["isolate_tabs"]) {
+		isolate_tabs = config["isolate_tabs"].as<bool>();
+	}
+
+	if (config["tab_cpu_weight"]) {
+		tab_cpu_weight = config["tab_cpu_weight"].as<int>();
+	}
+
+	if (config["tab_memory_high"]) {
+		tab_memory_high = config["tab_memory_high"].as<std::string>();
+	}
+
+	if (config["tab_nice"]) {
+		tab_nice = config["tab_nice"].as<int>();
+	}
+
+	if (config["shell_integration"]) {
+		shell_integration = config["shell_integration"].as<bool>();
+	}
+
+	if (config["paste_rate_limit"]) {
+		paste_rate_limit = config["paste_rate_limit"].as<int>();
+	}
+
+	if (config["virtual_tab_bar"]) {
+		virtual_tab_bar = config["virtual_tab_bar"].as<bool>();
+	}
+
+	if (config["cursor_type"]) {
+		cursor_shape = config["cursor_type"].as<int>();
+	}
+
+	if (config["word_chars"]) {
+		word_chars = config["word_chars"].as<std::string>();
+	}
+
+	if (config["palette"]) {
+		palette_str = config["palette"].as<std::string>();
+	}
+
+	if (config["add_tab_accelerator"]) {
+		add_tab_accelerator = config["add_tab_accelerator"].as<int>();
+	}
+
+	if (config["del_tab_accelerator"]) {
+		del_tab_accelerator = config["del_tab_accelerator"].as<int>();
+	}
+
+	if (config["switch_tab_accelerator"]) {
+		switch_tab_accelerator = config["switch_tab_accelerator"].as<int>();
+	}
+
+	if (config["move_tab_accelerator"]) {
+		move_tab_accelerator = config["move_tab_accelerator"].as<int>();
+	}
+
+	if (config["copy_accelerator"]) {
+		copy_accelerator = config["copy_accelerator"].as<int>();
+	}
+
+	if (config["scrollbar_accelerator"]) {
+		scrollbar_accelerator = config["scrollbar_accelerator"].as<int>();
+	}
+
+	if (config["open_url_accelerator"]) {
+		open_url_accelerator = config["open_url_accelerator"].as<int>();
+	}
+
+	if (config["font_size_accelerator"]) {
+		font_size_accelerator = config["font_size_accelerator"].as<int>();
+	}
+
+	if (config["global_font_size_accelerator"]) {
+		global_font_size_accelerator = config["global_font_size_accelerator"].as<int>();
+	}
+
+	if (config["set_tab_name_accelerator"]) {
+		set_tab_name_accelerator = config["set_tab_name_accelerator"].as<int>();
+	}
+
+	if (config["set_colorset_accelerator"]) {
+		set_colorset_accelerator = config["set_colorset_accelerator"].as<int>();
+	}
+
+	if (config["search_accelerator"]) {
+		search_accelerator = config["search_accelerator"].as<int>();
+	}
+
+	if (config["hints_accelerator"]) {
+		hints_accelerator = config["hints_accelerator"].as<int>();
+	}
+
+	if (config["prompt_accelerator"]) {
+		prompt_accelerator = config["prompt_accelerator"].as<int>();
+	}
+
+	if (config["broadcast_accelerator"]) {
+		broadcast_accelerator = config["broadcast_accelerator"].as<int>();
+	}
+
+	if (config["switcher_accelerator"]) {
+		switcher_accelerator = config["switcher_accelerator"].as<int>();
+	}
+
+	if (config["icon"]) {
+		icon = config["icon"].as<std::string>();
+	}
+
+	if (config["background_image"]) {
+		m_background_image = config["background_image"].as<std::string>();
+	}
+
+	if (config["background_alpha"]) {
+		m_background_alpha = config["background_alpha"].as<double>();
+		if (m_background_alpha < 0.0 || m_background_alpha > 1.0) {
+			std::cerr << "Invalid background alpha value " << m_background_alpha
+				  << ", reseting to " << (config["background_image"] ? 0.9 : 1.0)
+				  << std::endl;
+			m_background_alpha = (config["background_image"] ? 0.9 : 1.0);
+		}
+	}
+
+	if (config["keymap"]) {
+		loadKeymap(config["keymap"]);
+	}
+
+	for (int i = 0; i < NUM_COLORSETS; i++) {
+		const std::string name = "colorset" + std::to_string(i + 1);
+		if (config[name]) {
+			loadColorset(config[name], i);
+		}
+	}
+}
+
+/* Unknown key names keep the default key */
+static void load_key(const YAML::Node &keymap_node, const char *name, unsigned int &key)
+{
+	if (keymap_node[name]) {
+		unsigned int keyval = keyval_from_name(keymap_node[name].as<std::string>());
+		if (keyval) {
+			key = keyval;
+		} else {
+			std::cerr << "Invalid key " << keymap_node[name].as<std::string>()
+				  << " for " << name << std::endl;
+		}
+	}
+}
+
+void ConfigData::loadKeymap(const YAML::Node &keymap_node)
+{
+	load_key(keymap_node, "add_tab", keymap.add_tab_key);
+	load_key(keymap_node, "del_tab", keymap.del_tab_key);
+	load_key(keymap_node, "prev_tab", keymap.prev_tab_key);
+	load_key(keymap_node, "next_tab", keymap.next_tab_key);
+	load_key(keymap_node, "copy", keymap.copy_key);
+	load_key(keymap_node, "paste", keymap.paste_key);
+	load_key(keymap_node, "scrollbar", keymap.scrollbar_key);
+	load_key(keymap_node, "set_tab_name", keymap.set_tab_name_key);
+	load_key(keymap_node, "search", keymap.search_key);
+	load_key(keymap_node, "increase_font_size", keymap.increase_font_size_key);
+	load_key(keymap_node, "decrease_font_size", keymap.decrease_font_size_key);
+	load_key(keymap_node, "reset_font_size", keymap.reset_font_size_key);
+	load_key(keymap_node, "hints", keymap.hints_key);
+	load_key(keymap_node, "prev_prompt", keymap.prev_prompt_key);
+	load_key(keymap_node, "next_prompt", keymap.next_prompt_key);
+	load_key(keymap_node, "broadcast", keymap.broadcast_key);
+	load_key(keymap_node, "switcher", keymap.switcher_key);
+	load_key(keymap_node, "fullscreen", keymap.fullscreen_key);
+}
+
+void ConfigData::loadColorset(const YAML::Node &colorset_node, int index)
+{
+	if (colorset_node["fore"]) {
+		colorsets[index].fore = colorset_node["fore"].as<std::string>();
+	}
+
+	if (colorset_node["back"]) {
+		colorsets[index].back = colorset_node["back"].as<std::string>();
+	}
+
+	if (colorset_node["curs"]) {
+		colorsets[index].curs = colorset_node["curs"].as<std::string>();
+	}
+
+	load_key(colorset_node, "key", keymap.set_colorset_keys[index]);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <X11/keysym.h>
+
+#define NUM_COLORSETS 6
+
+/* Modifier masks, same values in X11 and GDK. X.h is not included, its macros break gtkmm */
+#define SAKURA_SHIFT_MASK (1 << 0)
+#define SAKURA_CONTROL_MASK (1 << 2)
+#define SAKURA_MOD1_MASK (1 << 3)
+
+namespace YAML {
+class Node;
+}
+
+struct SakuraKeyMap {
+	unsigned int add_tab_key = XK_T;
+	unsigned int del_tab_key = XK_W;
+	unsigned int prev_tab_key = XK_Left;
+	unsigned int next_tab_key = XK_Right;
+	unsigned int copy_key = XK_C;
+	unsigned int paste_key = XK_V;
+	unsigned int scrollbar_key = XK_S;
+	unsigned int set_tab_name_key = XK_N;
+	unsigned int search_key = XK_F;
+	unsigned int fullscreen_key = XK_F11;
+	unsigned int increase_font_size_key = XK_plus;
+	unsigned int decrease_font_size_key = XK_minus;
+	unsigned int reset_font_size_key = XK_0;
+	unsigned int hints_key = XK_E;
+	unsigned int prev_prompt_key = XK_Page_Up;
+	unsigned int next_prompt_key = XK_Page_Down;
+	unsigned int broadcast_key = XK_B;
+	unsigned int switcher_key = XK_P;
+	std::array<unsigned int, NUM_COLORSETS> set_colorset_keys = {
+			XK_F1, XK_F2, XK_F3, XK_F4, XK_F5, XK_F6};
+};
+
+/* Colors are kept as CSS color strings, the GUI parses them */
+struct SakuraColorset {
+	std::string fore = "rgb(192,192,192)";
+	std::string back = "rgba(0,0,0,1)";
+	std::string curs = "rgb(255,255,255)";
+};
+
+/**
+ * Settings of the sakura.yml file, without any toolkit type. Config adds the GTK side (font
+ * description, palette colors, cursor shape) on top of it.
+ */
+class ConfigData
+{
+public:
+	/* Both return an empty string on success, the error otherwise. On error no setting is
+	 * changed */
+	std::string load_file(const std::string &path);
+	std::string load_string(const std::string &yaml);
+
+	std::string font_name = "Ubuntu Mono,monospace 12";
+	std::string palette_str = "solarized_dark";
+
+	int last_colorset = 1;
+	int scroll_lines = 4096;
+
+	bool first_tab = false;
+	bool show_scrollbar = false;
+	bool show_closebutton = true;
+	bool tabs_on_bottom = false;
+	bool less_questions = false;
+	bool disable_numbered_tabswitch = false; /* For disabling direct tabswitching key */
+	bool use_fading = false;
+	bool scrollable_tabs = true;
+	bool urgent_bell = true;
+	bool audible_bell = true;
+	bool blinking_cursor = false;
+	bool stop_tab_cycling_at_end_tabs = false;
+	bool allow_bold = true;
+	bool resource_meter = false; /* CPU and memory of every tab in its tooltip */
+	bool isolate_tabs = false;   /* Tab children in cgroups of their own, or niced */
+	int tab_cpu_weight = 100;    /* cpu.weight of a tab cgroup, sakura has 100 */
+	int tab_nice = 10;           /* Without cgroups */
+	std::string tab_memory_high; /* memory.high of a tab cgroup ("4G"), none if empty */
+	bool shell_integration = false; /* Index of the OSC 133 prompts, tabs get a PtyProxy */
+	int paste_rate_limit = 0;       /* Bytes per second, 0 for no limit */
+	bool virtual_tab_bar = false;   /* TabBar instead of the tabs of the notebook */
+
+	int add_tab_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int del_tab_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int switch_tab_accelerator = (SAKURA_CONTROL_MASK);
+	int move_tab_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int copy_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int scrollbar_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int open_url_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int font_size_accelerator = (SAKURA_CONTROL_MASK); /* Zoom of the current tab */
+	int global_font_size_accelerator = (SAKURA_CONTROL_MASK | SAKURA_MOD1_MASK);
+	int set_tab_name_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int search_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int set_colorset_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int hints_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int prompt_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int broadcast_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+	int switcher_accelerator = (SAKURA_CONTROL_MASK | SAKURA_SHIFT_MASK);
+
+	int cursor_shape = 0; /* VteCursorShape value, block by default */
+	std::string word_chars = "-,./?%&#_~:";  /* Exceptions for word selection */
+	std::string icon = "terminal-tango.svg";
+
+	const std::string &get_background_image() const { return m_background_image; }
+	double get_background_alpha() const { return m_background_alpha; }
+
+	SakuraKeyMap keymap;
+	std::array<SakuraColorset, NUM_COLORSETS> colorsets;
+
+protected:
+	std::string m_background_image;
+	double m_background_alpha = 0.9;
+
+private:
+	void parse(const YAML::Node &config);
+	void loadKeymap(const YAML::Node &keymap_node);
+	void loadColorset(const YAML::Node &colorset_node, int index);
+};
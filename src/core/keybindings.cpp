@@ -0,0 +1,125 @@
+#include "keybindings.h"
+#include "configdata.h"
+#include <cstdlib>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+unsigned int keyval_from_name(const std::string &name)
+{
+	KeySym keysym = XStringToKeysym(name.c_str());
+
+	if (keysym == NoSymbol) {
+		char *end;
+		unsigned long value = strtoul(name.c_str(), &end, 10);
+		if (name.empty() || *end != '\0')
+			return 0;
+		keysym = value;
+	}
+
+	KeySym lower, upper;
+	XConvertCase(keysym, &lower, &upper);
+	return upper;
+}
+
+void KeyBindings::add(unsigned int keycode, unsigned int accelerator, KeyAction action, int arg,
+		unsigned int exclude)
+{
+	/* Keyvals missing from the keyboard have no keycode */
+	if (keycode == 0)
+		return;
+
+	if (keycode >= m_bindings.size())
+		m_bindings.resize(keycode + 1);
+
+	m_bindings[keycode].push_back({accelerator, exclude, action, arg});
+}
+
+void KeyBindings::clear()
+{
+	m_bindings.clear();
+}
+
+/* Bindings are added in the order on_key_press used to check them, the first match wins */
+void KeyBindings::build(const ConfigData &config,
+		const std::function<unsigned int(unsigned int)> &keycode_for)
+{
+	const SakuraKeyMap &keymap = config.keymap;
+
+	clear();
+
+	add(keycode_for(keymap.add_tab_key), config.add_tab_accelerator, KeyAction::ADD_TAB);
+	add(keycode_for(keymap.del_tab_key), config.del_tab_accelerator, KeyAction::CLOSE_TAB);
+
+	/* In cases when the user configured accelerators like these ones:
+		switch_tab_accelerator=4  for ctrl+next[prev]_tab_key
+		move_tab_accelerator=5  for ctrl+shift+next[prev]_tab_key
+	   move never works, because switch will be processed first, so switch bindings are
+	   excluded while the move accelerator is held */
+	for (int i = 0; i < 9; i++) {
+		add(keycode_for(XK_1 + i), config.switch_tab_accelerator, KeyAction::SWITCH_TAB, i,
+				config.move_tab_accelerator);
+	}
+	add(keycode_for(keymap.prev_tab_key), config.switch_tab_accelerator, KeyAction::PREV_TAB,
+			0, config.move_tab_accelerator);
+	add(keycode_for(keymap.next_tab_key), config.switch_tab_accelerator, KeyAction::NEXT_TAB,
+			0, config.move_tab_accelerator);
+
+	add(keycode_for(keymap.prev_tab_key), config.move_tab_accelerator,
+			KeyAction::MOVE_TAB_BACKWARDS);
+	add(keycode_for(keymap.next_tab_key), config.move_tab_accelerator,
+			KeyAction::MOVE_TAB_FORWARD);
+
+	add(keycode_for(keymap.copy_key), config.copy_accelerator, KeyAction::COPY);
+	add(keycode_for(keymap.paste_key), config.copy_accelerator, KeyAction::PASTE);
+	add(keycode_for(keymap.scrollbar_key), config.scrollbar_accelerator, KeyAction::SCROLLBAR);
+	add(keycode_for(keymap.set_tab_name_key), config.set_tab_name_accelerator,
+			KeyAction::SET_TAB_NAME);
+	add(keycode_for(keymap.search_key), config.search_accelerator, KeyAction::SEARCH);
+	add(keycode_for(keymap.hints_key), config.hints_accelerator, KeyAction::HINTS);
+	/* Prompts are only known with shell integration, otherwise the keys go to the terminal */
+	if (config.shell_integration) {
+		add(keycode_for(keymap.prev_prompt_key), config.prompt_accelerator,
+				KeyAction::PREV_PROMPT);
+		add(keycode_for(keymap.next_prompt_key), config.prompt_accelerator,
+				KeyAction::NEXT_PROMPT);
+	}
+	add(keycode_for(keymap.broadcast_key), config.broadcast_accelerator, KeyAction::BROADCAST);
+	add(keycode_for(keymap.switcher_key), config.switcher_accelerator, KeyAction::SWITCHER);
+	/* The global accelerator holds the one of the tab zoom with the default settings */
+	add(keycode_for(keymap.increase_font_size_key), config.global_font_size_accelerator,
+			KeyAction::INCREASE_FONT);
+	add(keycode_for(keymap.decrease_font_size_key), config.global_font_size_accelerator,
+			KeyAction::DECREASE_FONT);
+	add(keycode_for(keymap.increase_font_size_key), config.font_size_accelerator,
+			KeyAction::ZOOM_IN);
+	add(keycode_for(keymap.decrease_font_size_key), config.font_size_accelerator,
+			KeyAction::ZOOM_OUT);
+	add(keycode_for(keymap.reset_font_size_key), config.font_size_accelerator,
+			KeyAction::ZOOM_RESET);
+
+	/* F11 (fullscreen) needs no accelerator */
+	add(keycode_for(keymap.fullscreen_key), 0, KeyAction::FULLSCREEN);
+
+	for (int i = 0; i < NUM_COLORSETS; i++) {
+		add(keycode_for(keymap.set_colorset_keys[i]), config.set_colorset_accelerator,
+				KeyAction::SET_COLORSET, i);
+	}
+}
+
+KeyAction KeyBindings::resolve(unsigned int keycode, unsigned int state, int &arg) const
+{
+	if (keycode >= m_bindings.size())
+		return KeyAction::NONE;
+
+	for (const auto &binding : m_bindings[keycode]) {
+		if ((state & binding.accelerator) != binding.accelerator)
+			continue;
+		if (binding.exclude && (state & binding.exclude) == binding.exclude)
+			continue;
+
+		arg = binding.arg;
+		return binding.action;
+	}
+
+	return KeyAction::NONE;
+}
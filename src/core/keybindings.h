@@ -0,0 +1,72 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/* Key names are X11 keysym names ("T", "F11", "Left"), which are GDK keyvals too. Integer
+ * values are accepted for backwards compatibility. Returns the uppercase keyval, 0 if the name
+ * is not valid */
+unsigned int keyval_from_name(const std::string &name);
+
+class ConfigData;
+
+enum class KeyAction
+{
+	NONE,
+	ADD_TAB,
+	CLOSE_TAB,
+	SWITCH_TAB, /* To the page given as argument */
+	PREV_TAB,
+	NEXT_TAB,
+	MOVE_TAB_BACKWARDS,
+	MOVE_TAB_FORWARD,
+	COPY,
+	PASTE,
+	SCROLLBAR,
+	SET_TAB_NAME,
+	SEARCH,
+	HINTS,
+	PREV_PROMPT,
+	NEXT_PROMPT,
+	BROADCAST,
+	SWITCHER,
+	INCREASE_FONT, /* Of every tab, the window keeps its columns and rows */
+	DECREASE_FONT,
+	ZOOM_IN,       /* Font of the current tab only */
+	ZOOM_OUT,
+	ZOOM_RESET,
+	FULLSCREEN,
+	SET_COLORSET, /* To the colorset given as argument */
+};
+
+/**
+ * Shortcuts by hardware keycode, so every key press is resolved with a lookup instead of
+ * checking every shortcut. Keycodes come from the keyboard layout, the caller rebuilds the
+ * table when it changes.
+ */
+class KeyBindings
+{
+public:
+	/* Bindings of a keycode are checked in the order they were added, the first one whose
+	 * accelerator is held, and whose exclude mask is not, wins */
+	void add(unsigned int keycode, unsigned int accelerator, KeyAction action, int arg = 0,
+			unsigned int exclude = 0);
+	void clear();
+	/* Replaces the table with the shortcuts of the config. keycode_for gives the keycode of a
+	 * keyval in the current layout, 0 when no key has it */
+	void build(const ConfigData &config,
+			const std::function<unsigned int(unsigned int)> &keycode_for);
+
+	KeyAction resolve(unsigned int keycode, unsigned int state, int &arg) const;
+
+private:
+	struct Binding {
+		unsigned int accelerator;
+		unsigned int exclude;
+		KeyAction action;
+		int arg;
+	};
+
+	std::vector<std::vector<Binding>> m_bindings; /* Indexed by keycode */
+};
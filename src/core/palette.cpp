@@ -0,0 +1,34 @@
+#include "palette.h"
+
+static const struct {
+	const char *name;
+	PaletteId id;
+} palettes[] = {
+		{"linux", PaletteId::LINUX},
+		{"gruvbox", PaletteId::GRUVBOX},
+		{"xterm", PaletteId::XTERM},
+		{"rxvt", PaletteId::RXVT},
+		{"tango", PaletteId::TANGO},
+		{"solarized_dark", PaletteId::SOLARIZED_DARK},
+		{"solarized_light", PaletteId::SOLARIZED_LIGHT},
+};
+
+PaletteId palette_from_name(const std::string &name)
+{
+	for (const auto &palette : palettes) {
+		if (name == palette.name)
+			return palette.id;
+	}
+
+	return PaletteId::SOLARIZED_LIGHT;
+}
+
+const char *palette_name(PaletteId id)
+{
+	for (const auto &palette : palettes) {
+		if (palette.id == id)
+			return palette.name;
+	}
+
+	return "solarized_light";
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+enum class PaletteId
+{
+	LINUX,
+	GRUVBOX,
+	XTERM,
+	RXVT,
+	TANGO,
+	SOLARIZED_DARK,
+	SOLARIZED_LIGHT,
+};
+
+/* Unknown names select solarized light, as sakura always did */
+PaletteId palette_from_name(const std::string &name);
+const char *palette_name(PaletteId palette);
@@ -0,0 +1,170 @@
+#include "shellmarks.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#define SHELL_INDEX_MAX_COMMANDS 16384
+/* Longer OSCs are not marks (clipboard, hyperlinks), only their start is kept */
+#define OSC_MAX_SIZE 32
+
+#define CHAR_ESC '\033'
+#define CHAR_BEL '\007'
+
+size_t ShellMarkScanner::scan(const char *data, size_t size, ShellMark &mark)
+{
+	size_t start = 0; /* Of the current sequence, if it started in data */
+	mark.type = ShellMarkType::NONE;
+
+	for (size_t i = 0; i < size; i++) {
+		char c = data[i];
+
+		switch (m_state) {
+		case State::GROUND: {
+			auto esc = (const char *)memchr(data + i, CHAR_ESC, size - i);
+			if (!esc)
+				return size;
+			i = esc - data;
+			start = i;
+			m_state = State::ESC;
+			break;
+		}
+		case State::ESC:
+			if (c == ']') {
+				m_osc.clear();
+				m_state = State::OSC;
+			} else if (c != CHAR_ESC) {
+				m_state = State::GROUND;
+			} else {
+				start = i;
+			}
+			break;
+		case State::OSC:
+		case State::OSC_ESC:
+			if (c == CHAR_BEL || (m_state == State::OSC_ESC && c == '\\')) {
+				m_state = State::GROUND;
+				if (parse(mark)) {
+					mark.offset = start;
+					return i + 1;
+				}
+			} else if (c == CHAR_ESC) {
+				m_state = State::OSC_ESC;
+			} else if (m_state == State::OSC_ESC) {
+				/* ESC cancels the OSC and starts another sequence, c is scanned
+				 * again as its first byte */
+				m_state = State::ESC;
+				start = i > 0 ? i - 1 : 0;
+				i--;
+			} else if (m_osc.size() < OSC_MAX_SIZE) {
+				m_osc += c;
+			}
+			break;
+		}
+	}
+
+	return size;
+}
+
+bool ShellMarkScanner::parse(ShellMark &mark) const
+{
+	/* 133;X[;options], D may have the exit code as first option */
+	if (m_osc.size() < 5 || m_osc.compare(0, 4, "133;") != 0)
+		return false;
+	if (m_osc.size() > 5 && m_osc[5] != ';')
+		return false;
+
+	switch (m_osc[4]) {
+	case 'A':
+		mark.type = ShellMarkType::PROMPT;
+		break;
+	case 'B':
+		mark.type = ShellMarkType::COMMAND;
+		break;
+	case 'C':
+		mark.type = ShellMarkType::OUTPUT;
+		break;
+	case 'D':
+		mark.type = ShellMarkType::END;
+		mark.exit_code = -1;
+		if (m_osc.size() > 6 && m_osc[6] >= '0' && m_osc[6] <= '9')
+			mark.exit_code = atoi(m_osc.c_str() + 6);
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+bool ShellIndex::add(const ShellMark &mark, long row, int64_t now_us)
+{
+	if (mark.type == ShellMarkType::PROMPT) {
+		if (!m_commands.empty() && row < m_commands.back().prompt_row)
+			m_commands.clear();
+		if (m_commands.size() >= SHELL_INDEX_MAX_COMMANDS)
+			m_commands.pop_front();
+
+		ShellCommand command;
+		command.prompt_row = row;
+		command.prompt_us = now_us;
+		m_commands.push_back(command);
+		return false;
+	}
+
+	/* Marks before the first prompt have nothing to belong to */
+	if (m_commands.empty())
+		return false;
+
+	ShellCommand &command = m_commands.back();
+	switch (mark.type) {
+	case ShellMarkType::COMMAND:
+		command.command_row = row;
+		return false;
+	case ShellMarkType::OUTPUT:
+		command.output_row = row;
+		command.start_us = now_us;
+		return false;
+	case ShellMarkType::END:
+		/* Also sent for an empty command line, which never started */
+		if (!command.start_us || command.end_us)
+			return false;
+		command.end_us = now_us;
+		command.exit_code = mark.exit_code;
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool prompt_before(const ShellCommand &command, long row)
+{
+	return command.prompt_row < row;
+}
+
+static bool prompt_after(long row, const ShellCommand &command)
+{
+	return row < command.prompt_row;
+}
+
+long ShellIndex::previous_prompt(long row) const
+{
+	auto it = std::lower_bound(m_commands.begin(), m_commands.end(), row, prompt_before);
+	return it != m_commands.begin() ? std::prev(it)->prompt_row : -1;
+}
+
+long ShellIndex::next_prompt(long row) const
+{
+	auto it = std::upper_bound(m_commands.begin(), m_commands.end(), row, prompt_after);
+	return it != m_commands.end() ? it->prompt_row : -1;
+}
+
+const ShellCommand *ShellIndex::last_finished() const
+{
+	/* The one before the current prompt, or the last one while no new prompt is shown */
+	size_t size = m_commands.size();
+	for (size_t i = size; i > 0 && i + 2 > size; i--) {
+		if (m_commands[i - 1].end_us)
+			return &m_commands[i - 1];
+	}
+	return nullptr;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+/* OSC 133 marks, FinalTerm style, as sent by the shell integration of most shells */
+enum class ShellMarkType
+{
+	NONE,
+	PROMPT,  /* A: a prompt starts */
+	COMMAND, /* B: the prompt ends, the command line starts */
+	OUTPUT,  /* C: the command was entered, its output starts */
+	END,     /* D: the command finished, with its exit code if given */
+};
+
+struct ShellMark {
+	ShellMarkType type = ShellMarkType::NONE;
+	int exit_code = -1;  /* END only, -1 when unknown */
+	size_t offset = 0;   /* Where the sequence starts in the scanned data, 0 if before it */
+};
+
+/**
+ * Finds OSC 133 marks in the output of a child. The output is scanned as it is read, so a
+ * sequence can be split between two reads. Plain output is skipped with memchr, looking for
+ * ESC only.
+ */
+class ShellMarkScanner
+{
+public:
+	/* Scans data up to the end of the next mark, included. Returns the bytes scanned, all of
+	 * them when no mark ends in data, and sets mark to NONE then */
+	size_t scan(const char *data, size_t size, ShellMark &mark);
+
+private:
+	enum class State
+	{
+		GROUND,
+		ESC,
+		OSC,
+		OSC_ESC, /* ESC inside an OSC, the start of ST */
+	};
+
+	bool parse(ShellMark &mark) const;
+
+	State m_state = State::GROUND;
+	std::string m_osc; /* Start of the OSC being scanned, long ones are cut */
+};
+
+/* A prompt and the command entered at it. Rows are VTE buffer rows, timestamps are
+ * monotonic microseconds */
+struct ShellCommand {
+	long prompt_row = -1;
+	long command_row = -1;
+	long output_row = -1;
+	int64_t prompt_us = 0;
+	int64_t start_us = 0; /* 0 while the prompt is being edited */
+	int64_t end_us = 0;   /* 0 until it finishes */
+	int exit_code = -1;
+};
+
+/**
+ * Prompts and commands of a tab, in the order of their rows. Jumping between prompts is a
+ * binary search, whatever the size of the scrollback. The oldest entries are dropped past
+ * SHELL_INDEX_MAX_COMMANDS, and everything when the rows go back, as they do when the
+ * scrollback is cleared.
+ */
+class ShellIndex
+{
+public:
+	/* Returns true when a command finished */
+	bool add(const ShellMark &mark, long row, int64_t now_us);
+
+	/* Row of the closest prompt above or below row, -1 if there is none */
+	long previous_prompt(long row) const;
+	long next_prompt(long row) const;
+
+	/* The last command that finished, nullptr if none did */
+	const ShellCommand *last_finished() const;
+	size_t size() const { return m_commands.size(); }
+
+private:
+	std::deque<ShellCommand> m_commands;
+};
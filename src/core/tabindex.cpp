@@ -0,0 +1,149 @@
+#include "tabindex.h"
+#include <algorithm>
+
+#define SCORE_MATCH 16
+#define SCORE_WORD_START 8
+#define SCORE_CONSECUTIVE 4
+#define SCORE_GAP 1
+
+static void fold(const std::string &text, std::string &folded)
+{
+	folded.resize(text.size());
+	for (size_t i = 0; i < text.size(); i++) {
+		char c = text[i];
+		folded[i] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+	}
+}
+
+static bool is_word_start(const std::string &text, size_t i)
+{
+	if (i == 0)
+		return true;
+	char c = text[i - 1];
+	return c == ' ' || c == '/' || c == '-' || c == '_' || c == '.' || c == ':' || c == '@';
+}
+
+int fuzzy_score(const char *pattern, size_t pattern_size, const std::string &text)
+{
+	if (pattern_size == 0)
+		return 0;
+
+	/* The leftmost place where the whole pattern has been seen... */
+	size_t matched = 0, end = 0;
+	for (size_t i = 0; i < text.size() && matched < pattern_size; i++) {
+		if (text[i] == pattern[matched]) {
+			matched++;
+			end = i + 1;
+		}
+	}
+	if (matched < pattern_size)
+		return -1;
+
+	/* ...and the shortest match that ends there, found going back */
+	size_t start = end;
+	while (matched > 0) {
+		start--;
+		if (text[start] == pattern[matched - 1])
+			matched--;
+	}
+
+	int score = 0;
+	bool consecutive = false;
+	for (size_t i = start; i < end; i++) {
+		if (matched < pattern_size && text[i] == pattern[matched]) {
+			score += SCORE_MATCH;
+			if (consecutive)
+				score += SCORE_CONSECUTIVE;
+			if (is_word_start(text, i))
+				score += SCORE_WORD_START;
+			consecutive = true;
+			matched++;
+		} else {
+			score -= SCORE_GAP;
+			consecutive = false;
+		}
+	}
+	return std::max(score, 0);
+}
+
+void TabIndex::set(const void *tab, TabField field, const std::string &value)
+{
+	auto it = m_positions.find(tab);
+	if (it == m_positions.end()) {
+		it = m_positions.emplace(tab, m_entries.size()).first;
+		m_entries.push_back({tab, {}, {}});
+	}
+
+	Entry &entry = m_entries[it->second];
+	entry.fields[(size_t)field] = value;
+	fold(value, entry.folded[(size_t)field]);
+}
+
+void TabIndex::remove(const void *tab)
+{
+	auto it = m_positions.find(tab);
+	if (it == m_positions.end())
+		return;
+
+	/* Tabs are removed one at a time, keeping the order is worth the copy */
+	size_t position = it->second;
+	m_positions.erase(it);
+	m_entries.erase(m_entries.begin() + position);
+	for (size_t i = position; i < m_entries.size(); i++)
+		m_positions[m_entries[i].tab] = i;
+}
+
+const std::string &TabIndex::get(const void *tab, TabField field) const
+{
+	static const std::string empty;
+	auto it = m_positions.find(tab);
+	return it == m_positions.end() ? empty : m_entries[it->second].fields[(size_t)field];
+}
+
+void TabIndex::match(const std::string &pattern, size_t max, std::vector<TabMatch> &results) const
+{
+	std::string folded;
+	fold(pattern, folded);
+
+	/* Words as (start, size) in folded */
+	std::vector<std::pair<size_t, size_t>> words;
+	size_t i = 0;
+	while (i < folded.size()) {
+		size_t next = folded.find(' ', i);
+		if (next == std::string::npos)
+			next = folded.size();
+		if (next > i)
+			words.emplace_back(i, next - i);
+		i = next + 1;
+	}
+
+	/* Positions of the matching entries along with their scores, to break ties */
+	std::vector<std::pair<int, size_t>> found;
+	for (size_t position = 0; position < m_entries.size(); position++) {
+		const Entry &entry = m_entries[position];
+		int total = 0;
+		for (const auto &word : words) {
+			const char *text = &folded[word.first];
+			int best = -1;
+			for (const auto &field : entry.folded)
+				best = std::max(best, fuzzy_score(text, word.second, field));
+			if (best < 0) {
+				total = -1;
+				break;
+			}
+			total += best;
+		}
+		if (total >= 0)
+			found.emplace_back(total, position);
+	}
+
+	size_t count = std::min(max, found.size());
+	auto better = [](const std::pair<int, size_t> &a, const std::pair<int, size_t> &b) {
+		return a.first != b.first ? a.first > b.first : a.second < b.second;
+	};
+	std::partial_sort(found.begin(), found.begin() + count, found.end(), better);
+
+	results.clear();
+	for (size_t n = 0; n < count; n++)
+		results.push_back({m_entries[found[n].second].tab, found[n].first});
+}
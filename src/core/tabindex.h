@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/* What a tab can be found by in the quick switcher */
+enum class TabField
+{
+	LABEL,   /* Whole text of the tab label: the name given by the user, or the title */
+	TITLE,   /* Terminal title, as set by the program running in it */
+	CWD,
+	COMMAND, /* Foreground job */
+};
+#define TAB_FIELD_COUNT 4
+
+struct TabMatch {
+	const void *tab;
+	int score;
+};
+
+/* Score of pattern as a subsequence of text, -1 if it isn't one. Both must be lowercase.
+ * Matches at the start of words and runs of consecutive characters score higher, characters
+ * skipped inside the match lower */
+int fuzzy_score(const char *pattern, size_t pattern_size, const std::string &text);
+
+/**
+ * The fields of every tab, updated by the tabs as they change instead of gathered at every
+ * search. Every space separated word of a pattern must match one of the fields of a tab, and
+ * a tab scores the sum of the best score of each word. Case is ignored for ASCII letters.
+ */
+class TabIndex
+{
+public:
+	void set(const void *tab, TabField field, const std::string &value);
+	void remove(const void *tab);
+	/* Empty for unknown tabs */
+	const std::string &get(const void *tab, TabField field) const;
+	size_t size() const { return m_entries.size(); }
+
+	/* Best matches first, ties in the order the tabs were added, at most max of them. An empty
+	 * pattern matches every tab */
+	void match(const std::string &pattern, size_t max, std::vector<TabMatch> &results) const;
+
+private:
+	struct Entry {
+		const void *tab;
+		std::array<std::string, TAB_FIELD_COUNT> fields;
+		std::array<std::string, TAB_FIELD_COUNT> folded; /* Lowercase, for matching */
+	};
+
+	std::vector<Entry> m_entries; /* In the order the tabs were added */
+	std::unordered_map<const void *, size_t> m_positions;
+};
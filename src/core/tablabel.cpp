@@ -0,0 +1,23 @@
+#include "tablabel.h"
+
+std::string tab_label_text(const char *title, size_t max_chars, size_t min_chars)
+{
+	std::string label;
+	if (!title || !*title)
+		return label;
+
+	size_t chars = 0;
+	const char *p = title;
+	for (; *p && chars < max_chars; chars++) {
+		/* Skip the continuation bytes of the character */
+		p++;
+		while ((*p & 0xc0) == 0x80)
+			p++;
+	}
+	label.assign(title, p - title);
+
+	if (chars < min_chars)
+		label.append(min_chars - chars, ' ');
+
+	return label;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/* Tab label for a terminal title: at most max_chars characters, padded with spaces to
+ * min_chars. Counts UTF-8 characters, so a title is never cut inside one. Returns an empty
+ * string for an empty title, the caller uses the default label then */
+std::string tab_label_text(const char *title, size_t max_chars, size_t min_chars);
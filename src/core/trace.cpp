@@ -0,0 +1,141 @@
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+struct TraceRing {
+	TraceEvent events[TRACE_RING_EVENTS];
+	std::atomic<uint64_t> head{0}; /* Events ever recorded, only written by the owner */
+	int tid = 0;
+	std::string thread_name;
+};
+
+/* Rings are never freed, so the events of a thread that exited can still be exported */
+static std::mutex rings_mutex;
+static std::vector<TraceRing *> rings;
+static thread_local TraceRing *thread_ring;
+
+static TraceRing *ring_register()
+{
+	auto ring = new TraceRing;
+	std::lock_guard<std::mutex> lock(rings_mutex);
+	ring->tid = rings.size() + 1;
+	ring->thread_name = "thread " + std::to_string(ring->tid);
+	rings.push_back(ring);
+	thread_ring = ring;
+	return ring;
+}
+
+void trace_record(uint8_t category, char phase, const char *name, int64_t ts, int64_t dur,
+		const char *text)
+{
+	TraceRing *ring = thread_ring ? thread_ring : ring_register();
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+	TraceEvent &event = ring->events[head & (TRACE_RING_EVENTS - 1)];
+
+	event.ts = ts;
+	event.dur = dur;
+	event.name = name;
+	event.category = category;
+	event.phase = phase;
+	if (text)
+		strncpy(event.text, text, TRACE_TEXT_SIZE - 1);
+	event.text[text ? TRACE_TEXT_SIZE - 1 : 0] = '\0';
+
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void trace_set_thread_name(const char *name)
+{
+	TraceRing *ring = thread_ring ? thread_ring : ring_register();
+	std::lock_guard<std::mutex> lock(rings_mutex);
+	ring->thread_name = name;
+}
+
+static const char *category_name(uint8_t category)
+{
+	switch (category) {
+	case TRACE_CONFIG: return "config";
+	case TRACE_TABS: return "tabs";
+	case TRACE_CHILD: return "child";
+	case TRACE_LAYOUT: return "layout";
+	case TRACE_COLORS: return "colors";
+	case TRACE_DRAW: return "draw";
+	case TRACE_TITLE: return "title";
+	default: return "debug";
+	}
+}
+
+static std::string json_escape(const char *text)
+{
+	std::string escaped;
+	for (const char *c = text; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			escaped += '\\';
+			escaped += *c;
+		} else if ((unsigned char)*c < 0x20) {
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", *c);
+			escaped += code;
+		} else {
+			escaped += *c;
+		}
+	}
+
+	return escaped;
+}
+
+bool trace_export(const std::string &path)
+{
+	std::ofstream out(path);
+	if (!out)
+		return false;
+
+	int pid = getpid();
+	const char *separator = "";
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	std::lock_guard<std::mutex> lock(rings_mutex);
+	std::vector<TraceEvent> events;
+	for (auto ring : rings) {
+		out << separator << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+		    << ",\"tid\":" << ring->tid << ",\"args\":{\"name\":\""
+		    << json_escape(ring->thread_name.c_str()) << "\"}}";
+		separator = ",";
+
+		/* Copy first, then drop what the owner overwrote during the copy, and the slot it
+		 * may be writing */
+		uint64_t head = ring->head.load(std::memory_order_acquire);
+		uint64_t first = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+		events.clear();
+		for (uint64_t i = first; i < head; i++)
+			events.push_back(ring->events[i & (TRACE_RING_EVENTS - 1)]);
+		uint64_t now = ring->head.load(std::memory_order_acquire);
+		uint64_t valid = now >= TRACE_RING_EVENTS ? now + 1 - TRACE_RING_EVENTS : 0;
+		if (valid > first) {
+			uint64_t stale = std::min<uint64_t>(valid - first, events.size());
+			events.erase(events.begin(), events.begin() + stale);
+		}
+
+		for (const auto &event : events) {
+			out << ",\n{\"name\":\"" << json_escape(event.name) << "\",\"cat\":\""
+			    << category_name(event.category) << "\",\"ph\":\"" << event.phase
+			    << "\",\"ts\":" << event.ts << ",\"pid\":" << pid
+			    << ",\"tid\":" << ring->tid;
+			if (event.phase == 'X')
+				out << ",\"dur\":" << event.dur;
+			if (event.phase == 'i')
+				out << ",\"s\":\"t\"";
+			if (event.text[0])
+				out << ",\"args\":{\"message\":\"" << json_escape(event.text)
+				    << "\"}";
+			out << "}";
+		}
+	}
+	out << "\n]}\n";
+
+	return out.good();
+}
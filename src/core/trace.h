@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Tracing into per-thread in-memory rings, exported as Chrome trace JSON (chrome://tracing,
+ * ui.perfetto.dev) when sakura receives SIGUSR2.
+ *
+ * What is traced is chosen at build time: SAKURA_TRACE_LEVEL (cmake -DTRACE_LEVEL=N) and the
+ * SAKURA_TRACE_CATEGORIES mask (cmake -DTRACE_CATEGORIES=0xNN). Anything else compiles to
+ * nothing. A traced event is a clock read and a 64 byte store into the ring of the thread, no
+ * locks and no formatting, so spans are left on in release builds.
+ */
+
+#define TRACE_LEVEL_OFF 0
+#define TRACE_LEVEL_SPANS 1    /* Spans and instant events */
+#define TRACE_LEVEL_MESSAGES 2 /* Plus TRACE_MSG, formatted into the event */
+
+#define TRACE_CONFIG 0x01
+#define TRACE_TABS 0x02
+#define TRACE_CHILD 0x04
+#define TRACE_LAYOUT 0x08
+#define TRACE_COLORS 0x10
+#define TRACE_DRAW 0x20
+#define TRACE_TITLE 0x40
+#define TRACE_DEBUG 0x80
+#define TRACE_ALL 0xff
+
+#ifndef SAKURA_TRACE_LEVEL
+#define SAKURA_TRACE_LEVEL TRACE_LEVEL_SPANS
+#endif
+
+#ifndef SAKURA_TRACE_CATEGORIES
+#define SAKURA_TRACE_CATEGORIES TRACE_ALL
+#endif
+
+/* Events per thread, a power of two. 1 MB per thread */
+#define TRACE_RING_EVENTS 16384
+#define TRACE_TEXT_SIZE 38
+
+struct TraceEvent {
+	int64_t ts;       /* Microseconds, same clock as g_get_monotonic_time() */
+	int64_t dur;      /* Complete events only */
+	const char *name; /* Must be a string literal, only the pointer is stored */
+	uint8_t category;
+	char phase; /* Chrome trace phases: 'X' complete, 'B' begin, 'E' end, 'i' instant */
+	char text[TRACE_TEXT_SIZE];
+};
+
+constexpr bool trace_enabled(unsigned int category, int level = TRACE_LEVEL_SPANS)
+{
+	return SAKURA_TRACE_LEVEL >= level && (SAKURA_TRACE_CATEGORIES & category) != 0;
+}
+
+static inline int64_t trace_now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000L + now.tv_nsec / 1000;
+}
+
+void trace_record(uint8_t category, char phase, const char *name, int64_t ts, int64_t dur = 0,
+		const char *text = nullptr);
+/* Name of the calling thread in the exported trace */
+void trace_set_thread_name(const char *name);
+/* Writes the events of every thread. The rings keep recording meanwhile, events overwritten
+ * while they were copied are left out */
+bool trace_export(const std::string &path);
+
+template <unsigned int C> class TraceSpan
+{
+public:
+	explicit TraceSpan(const char *name) : m_name(name)
+	{
+		if constexpr (trace_enabled(C))
+			m_start = trace_now();
+	}
+
+	~TraceSpan()
+	{
+		if constexpr (trace_enabled(C))
+			trace_record(C, 'X', m_name, m_start, trace_now() - m_start);
+	}
+
+	TraceSpan(const TraceSpan &) = delete;
+	TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+	const char *m_name;
+	int64_t m_start = 0;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+/* Times the rest of the enclosing scope */
+#define TRACE_SPAN(category, name) \
+	TraceSpan<category> TRACE_CONCAT(trace_span_, __LINE__)(name)
+
+/* For spans that start and end in different functions, e.g. around a signal class handler */
+#define TRACE_BEGIN(category, name) do { \
+	if constexpr (trace_enabled(category)) \
+		trace_record(category, 'B', name, trace_now()); \
+} while (0)
+
+#define TRACE_END(category, name) do { \
+	if constexpr (trace_enabled(category)) \
+		trace_record(category, 'E', name, trace_now()); \
+} while (0)
+
+#define TRACE_INSTANT(category, name) do { \
+	if constexpr (trace_enabled(category)) \
+		trace_record(category, 'i', name, trace_now()); \
+} while (0)
+
+/* Debug message, an instant event named after the function. Debug builds print it to stderr
+ * too */
+#ifdef SAKURA_TRACE_STDERR
+#define TRACE_MSG_STDERR(format, ...) fprintf(stderr, "[%d] [%s] " format "\n", getpid(), \
+		__FUNCTION__, ##__VA_ARGS__)
+#else
+#define TRACE_MSG_STDERR(format, ...) do { } while (0)
+#endif
+
+#define TRACE_MSG(format, ...) do { \
+	if constexpr (trace_enabled(TRACE_DEBUG, TRACE_LEVEL_MESSAGES)) { \
+		char trace_text[TRACE_TEXT_SIZE]; \
+		snprintf(trace_text, sizeof(trace_text), format, ##__VA_ARGS__); \
+		trace_record(TRACE_DEBUG, 'i', __FUNCTION__, trace_now(), 0, trace_text); \
+	} \
+	TRACE_MSG_STDERR(format, ##__VA_ARGS__); \
+} while (0)
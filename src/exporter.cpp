@@ -0,0 +1,232 @@
+#include "exporter.h"
+#include <gio/gunixoutputstream.h>
+#include <glib/gstdio.h>
+#include <utility>
+#include <vte/vte.h>
+#include "core/trace.h"
+#include "gettext.h"
+#include "notebook.h"
+#include "sakura.h"
+#include "sakuraold.h"
+#include "terminal.h"
+#include "window.h"
+
+/* Rows taken from VTE at once, about a millisecond of work */
+#define EXPORT_SLICE_ROWS 2000
+
+#define EXPORT_HTML_HEADER                                                                         \
+	"<!DOCTYPE html>\n<html>\n<head><meta charset=\"utf-8\"></head>\n<body>\n"
+#define EXPORT_HTML_FOOTER "</body>\n</html>\n"
+
+/* A slice on its way to the stream. It outlives the exporter when the export is cancelled, GIO
+ * may still be writing it from a worker thread */
+struct ExportWrite {
+	GCancellable *cancellable; /* Finds the exporter, while there is one */
+	std::string data;
+};
+
+ScrollbackExporter::ScrollbackExporter(Terminal *term) : m_term(term)
+{
+	g_object_ref(m_term->vte);
+}
+
+ScrollbackExporter::~ScrollbackExporter()
+{
+	cancel();
+	g_object_unref(m_term->vte);
+}
+
+bool ScrollbackExporter::to_file(const char *path, GError **error)
+{
+	if (is_running())
+		return true;
+
+	GFile *file = g_file_new_for_path(path);
+	GFileOutputStream *stream =
+			g_file_replace(file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	g_object_unref(file);
+	if (!stream)
+		return false;
+
+	m_path = path;
+	start(G_OUTPUT_STREAM(stream), g_str_has_suffix(path, ".html"));
+	return true;
+}
+
+bool ScrollbackExporter::to_command(const char *command, GError **error)
+{
+	if (is_running())
+		return true;
+
+	gchar *path;
+	int fd = g_file_open_tmp("sakura-scrollback-XXXXXX", &path, error);
+	if (fd < 0)
+		return false;
+
+	m_path = path;
+	m_command = command;
+	g_free(path);
+	start(g_unix_output_stream_new(fd, TRUE), false);
+	return true;
+}
+
+void ScrollbackExporter::start(GOutputStream *stream, bool html)
+{
+	GtkAdjustment *adjustment = gtk_scrollable_get_vadjustment(GTK_SCROLLABLE(m_term->vte));
+
+	m_stream = stream;
+	m_html = html;
+	m_first_row = (long)gtk_adjustment_get_lower(adjustment);
+	m_next_row = m_first_row;
+	m_end_row = (long)gtk_adjustment_get_upper(adjustment);
+
+	m_cancellable = g_cancellable_new();
+	g_object_set_data(G_OBJECT(m_cancellable), "exporter", this);
+	m_draw_callback_id = g_signal_connect_after(
+			m_term->vte, "draw", G_CALLBACK(ScrollbackExporter::draw_cb), this);
+
+	TRACE_MSG("Exporting rows %ld to %ld to %s", m_first_row, m_end_row, m_path.c_str());
+	m_slice = m_html ? EXPORT_HTML_HEADER : "";
+	write_slice();
+}
+
+void ScrollbackExporter::write_slice()
+{
+	auto vte = VTE_TERMINAL(m_term->vte);
+
+	/* Rows that scrolled out of the scrollback meanwhile are lost */
+	GtkAdjustment *adjustment = gtk_scrollable_get_vadjustment(GTK_SCROLLABLE(m_term->vte));
+	m_next_row = MAX(m_next_row, (long)gtk_adjustment_get_lower(adjustment));
+
+	if (m_next_row < m_end_row) {
+		long end = MIN(m_next_row + EXPORT_SLICE_ROWS, m_end_row);
+		glong columns = vte_terminal_get_column_count(vte);
+#if VTE_CHECK_VERSION(0, 72, 0)
+		gsize length;
+		char *text = vte_terminal_get_text_range_format(vte,
+				m_html ? VTE_FORMAT_HTML : VTE_FORMAT_TEXT, m_next_row, 0, end - 1,
+				columns, &length);
+#else
+		char *text = vte_terminal_get_text_range(
+				vte, m_next_row, 0, end - 1, columns, NULL, NULL, NULL);
+		if (text && m_html) {
+			gchar *escaped = g_markup_escape_text(text, -1);
+			g_free(text);
+			text = g_strconcat("<pre>", escaped, "</pre>\n", NULL);
+			g_free(escaped);
+		}
+#endif
+		if (text)
+			m_slice += text;
+		g_free(text);
+		m_next_row = end;
+		gtk_widget_queue_draw(m_term->vte);
+	} else if (m_html && m_next_row == m_end_row) {
+		m_slice += EXPORT_HTML_FOOTER;
+		m_next_row++;
+	}
+
+	if (m_slice.empty()) {
+		g_output_stream_close_async(m_stream, G_PRIORITY_DEFAULT, m_cancellable,
+				ScrollbackExporter::closed_cb, g_object_ref(m_cancellable));
+		return;
+	}
+
+	auto write = new ExportWrite{
+			(GCancellable *)g_object_ref(m_cancellable), std::move(m_slice)};
+	m_slice.clear();
+	g_output_stream_write_all_async(m_stream, write->data.data(), write->data.size(),
+			G_PRIORITY_DEFAULT, m_cancellable, ScrollbackExporter::written_cb, write);
+}
+
+void ScrollbackExporter::written_cb(GObject *source, GAsyncResult *result, gpointer data)
+{
+	auto write = (ExportWrite *)data;
+	auto obj = (ScrollbackExporter *)g_object_get_data(
+			G_OBJECT(write->cancellable), "exporter");
+	GError *error = NULL;
+
+	g_output_stream_write_all_finish(G_OUTPUT_STREAM(source), result, NULL, &error);
+	if (obj && error)
+		obj->finish(error);
+	else if (obj)
+		obj->write_slice();
+
+	g_clear_error(&error);
+	g_object_unref(write->cancellable);
+	delete write;
+}
+
+void ScrollbackExporter::closed_cb(GObject *source, GAsyncResult *result, gpointer data)
+{
+	auto cancellable = (GCancellable *)data;
+	auto obj = (ScrollbackExporter *)g_object_get_data(G_OBJECT(cancellable), "exporter");
+	GError *error = NULL;
+
+	g_output_stream_close_finish(G_OUTPUT_STREAM(source), result, &error);
+	if (obj)
+		obj->finish(error);
+
+	g_clear_error(&error);
+	g_object_unref(cancellable);
+}
+
+void ScrollbackExporter::cancel()
+{
+	if (!is_running())
+		return;
+
+	TRACE_MSG("Export cancelled at row %ld", m_next_row);
+	/* The pending write finds us through the cancellable, like the PtyProxy spawn */
+	g_object_set_data(G_OBJECT(m_cancellable), "exporter", nullptr);
+	g_cancellable_cancel(m_cancellable);
+	if (!m_command.empty())
+		g_unlink(m_path.c_str());
+	m_command.clear();
+	finish(nullptr);
+}
+
+/* Done, failed or cancelled: error is only set for failures */
+void ScrollbackExporter::finish(GError *error)
+{
+	if (error)
+		sakura_error("Cannot export the scrollback to %s: %s", m_path.c_str(),
+				error->message);
+
+	if (m_draw_callback_id) {
+		g_signal_handler_disconnect(m_term->vte, m_draw_callback_id);
+		m_draw_callback_id = 0;
+		gtk_widget_queue_draw(m_term->vte);
+	}
+	g_clear_object(&m_stream);
+	g_clear_object(&m_cancellable);
+	m_slice.clear();
+
+	if (!m_command.empty()) {
+		if (!error) {
+			/* A shell is left in the tab, so the output of the command stays */
+			gchar *script = g_strdup_printf("{ %s; } <\"$0\"; rm -f \"$0\"; "
+							"exec \"${SHELL:-/bin/sh}\"",
+					m_command.c_str());
+			char *argv[] = {(char *)"/bin/sh", (char *)"-c", script,
+					(char *)m_path.c_str(), nullptr};
+			sakura->main_window->notebook.add_command_tab(argv);
+			g_free(script);
+		} else {
+			g_unlink(m_path.c_str());
+		}
+		m_command.clear();
+	}
+}
+
+gboolean ScrollbackExporter::draw_cb(GtkWidget *widget, cairo_t *cr, void *data)
+{
+	auto obj = (ScrollbackExporter *)data;
+	long rows = MAX(obj->m_end_row - obj->m_first_row, 1);
+	long done = MIN(obj->m_next_row, obj->m_end_row) - obj->m_first_row;
+
+	gchar *text = g_strdup_printf(_("Exporting row %ld of %ld, Escape cancels"), done, rows);
+	obj->m_term->draw_progress(cr, (double)done / rows, text);
+	g_free(text);
+	return FALSE;
+}
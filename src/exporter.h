@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <gio/gio.h>
+#include <gtk/gtk.h>
+
+class Terminal;
+
+/**
+ * Writes the scrollback of a tab to a file, as text or, for .html files, as HTML. The rows are
+ * taken EXPORT_SLICE_ROWS at a time, and the next slice is only taken once the previous one
+ * has been written asynchronously, so the GUI thread is never blocked for long and memory
+ * stays bounded whatever the size of the scrollback. A progress bar is drawn over the terminal
+ * meanwhile, and Escape cancels the export.
+ *
+ * Piping to a command exports to a temporary file first, then opens a tab running the command
+ * with the file on its standard input, so that pagers like less get a terminal.
+ */
+class ScrollbackExporter
+{
+public:
+	ScrollbackExporter(Terminal *term);
+	~ScrollbackExporter();
+
+	bool to_file(const char *path, GError **error);
+	bool to_command(const char *command, GError **error);
+	void cancel();
+	bool is_running() const { return m_stream != nullptr; }
+
+private:
+	void start(GOutputStream *stream, bool html);
+	void write_slice();
+	void finish(GError *error);
+	static void written_cb(GObject *source, GAsyncResult *result, gpointer data);
+	static void closed_cb(GObject *source, GAsyncResult *result, gpointer data);
+	static gboolean draw_cb(GtkWidget *widget, cairo_t *cr, void *data);
+
+	Terminal *m_term;
+	GOutputStream *m_stream = nullptr;
+	GCancellable *m_cancellable = nullptr;
+	bool m_html = false;
+	long m_first_row = 0;
+	long m_next_row = 0;
+	long m_end_row = 0;
+	std::string m_slice; /* Being taken, handed over to the write once complete */
+	std::string m_command; /* Run on the exported file once it is complete */
+	std::string m_path;
+	gulong m_draw_callback_id = 0;
+};
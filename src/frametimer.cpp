@@ -0,0 +1,235 @@
+#include "frametimer.h"
+#include <csignal>
+#include <glib-unix.h>
+#include "notebook.h"
+#include "sakuraold.h"
+#include "terminal.h"
+#include "window.h"
+
+/* Longer gaps between frames mean there was nothing to draw, not that frames were late */
+#define FRAME_IDLE_US 100000
+/* Used when the frame clock does not know the refresh rate yet */
+#define FRAME_DEFAULT_REFRESH_US 16667
+
+void FrameHistogram::add(gint64 us)
+{
+	int bucket = us > 0 ? g_bit_storage(us) - 1 : 0;
+	if (bucket >= FRAME_HISTOGRAM_BUCKETS)
+		bucket = FRAME_HISTOGRAM_BUCKETS - 1;
+
+	m_buckets[bucket]++;
+	m_count++;
+	m_sum += us;
+	if (us > m_max)
+		m_max = us;
+}
+
+gint64 FrameHistogram::percentile(double p) const
+{
+	guint64 wanted = (guint64)(p * m_count);
+	guint64 seen = 0;
+
+	for (int i = 0; i < FRAME_HISTOGRAM_BUCKETS; i++) {
+		seen += m_buckets[i];
+		if (seen > wanted || seen == m_count)
+			return MIN((gint64)1 << (i + 1), m_max);
+	}
+
+	return m_max;
+}
+
+std::string FrameHistogram::bars() const
+{
+	static const char *blocks[] = {"▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+	int first = -1, last = -1;
+	guint64 highest = 0;
+
+	for (int i = 0; i < FRAME_HISTOGRAM_BUCKETS; i++) {
+		if (m_buckets[i] == 0)
+			continue;
+		if (first < 0)
+			first = i;
+		last = i;
+		highest = MAX(highest, m_buckets[i]);
+	}
+
+	std::string bars;
+	for (int i = first; first >= 0 && i <= last; i++) {
+		if (m_buckets[i] == 0)
+			bars.append(" ");
+		else
+			bars.append(blocks[(m_buckets[i] * 7) / highest]);
+	}
+
+	return bars;
+}
+
+void FrameHistogram::dump(FILE *file, const char *name) const
+{
+	fprintf(file, "%s: count %" G_GUINT64_FORMAT, name, m_count);
+	if (m_count > 0) {
+		fprintf(file,
+				" mean %" G_GINT64_FORMAT " p50 %" G_GINT64_FORMAT
+				" p90 %" G_GINT64_FORMAT " p99 %" G_GINT64_FORMAT
+				" max %" G_GINT64_FORMAT " us",
+				m_sum / (gint64)m_count, percentile(0.5), percentile(0.9),
+				percentile(0.99), m_max);
+	}
+	fprintf(file, "\n");
+
+	for (int i = 0; i < FRAME_HISTOGRAM_BUCKETS; i++) {
+		if (m_buckets[i] == 0)
+			continue;
+		fprintf(file, "  [%ld, %ld) us: %" G_GUINT64_FORMAT "\n", i ? 1L << i : 0L,
+				1L << (i + 1), m_buckets[i]);
+	}
+}
+
+FrameTimer &FrameTimer::get()
+{
+	static FrameTimer timer;
+	return timer;
+}
+
+void FrameTimer::enable()
+{
+	m_enabled = true;
+
+	m_overlay = new Gtk::Label();
+	m_overlay->set_halign(Gtk::ALIGN_END);
+	m_overlay->set_valign(Gtk::ALIGN_START);
+	m_overlay->set_justify(Gtk::JUSTIFY_LEFT);
+	m_overlay->show();
+
+	/* Once a second, so the overlay adds a single frame per second to the numbers */
+	g_timeout_add_seconds(1, FrameTimer::update_overlay_cb, this);
+	g_unix_signal_add(SIGUSR1, FrameTimer::dump_cb, this);
+}
+
+void FrameTimer::attach(GtkWidget *window)
+{
+	if (!m_enabled)
+		return;
+
+	GdkFrameClock *clock = gtk_widget_get_frame_clock(window);
+	if (clock) {
+		g_signal_connect(clock, "before-paint", G_CALLBACK(FrameTimer::before_paint_cb),
+				this);
+		g_signal_connect(clock, "after-paint", G_CALLBACK(FrameTimer::after_paint_cb),
+				this);
+	}
+}
+
+void FrameTimer::before_paint_cb(GdkFrameClock *clock, void *data)
+{
+	auto obj = (FrameTimer *)data;
+	obj->m_paint_start = g_get_monotonic_time();
+}
+
+void FrameTimer::after_paint_cb(GdkFrameClock *clock, void *data)
+{
+	auto obj = (FrameTimer *)data;
+	gint64 paint = g_get_monotonic_time() - obj->m_paint_start;
+	gint64 frame_time = gdk_frame_clock_get_frame_time(clock);
+	gint64 interval = obj->m_last_frame_time ? frame_time - obj->m_last_frame_time : 0;
+	obj->m_last_frame_time = frame_time;
+
+	gint64 refresh = 0;
+	gdk_frame_clock_get_refresh_info(clock, frame_time, &refresh, NULL);
+	if (refresh <= 0)
+		refresh = FRAME_DEFAULT_REFRESH_US;
+
+	FrameStats *stats[2] = {&obj->m_total, nullptr};
+	if (sakura->main_window->notebook.get_n_pages() > 0) {
+		auto term = sakura->main_window->notebook.get_current_tab_term();
+		if (!term->frame_stats)
+			term->frame_stats = new FrameStats();
+		stats[1] = term->frame_stats;
+	}
+
+	for (auto frame_stats : stats) {
+		if (!frame_stats)
+			continue;
+
+		frame_stats->frames++;
+		frame_stats->paint.add(paint);
+		if (interval > 0 && interval <= FRAME_IDLE_US) {
+			frame_stats->interval.add(interval);
+			/* Rounded, so a frame a bit late on its refresh cycle is not a drop */
+			frame_stats->dropped += (interval + refresh / 2) / refresh - 1;
+		}
+	}
+}
+
+static std::string stats_summary(const FrameStats &stats)
+{
+	gchar *text = g_strdup_printf("%" G_GUINT64_FORMAT " frames, %" G_GUINT64_FORMAT
+				      " dropped\n"
+				      "paint    p50 %5.1f p99 %5.1f max %5.1f ms %s\n"
+				      "interval p50 %5.1f p99 %5.1f max %5.1f ms %s",
+			stats.frames, stats.dropped, stats.paint.percentile(0.5) / 1000.0,
+			stats.paint.percentile(0.99) / 1000.0, stats.paint.max() / 1000.0,
+			stats.paint.bars().c_str(), stats.interval.percentile(0.5) / 1000.0,
+			stats.interval.percentile(0.99) / 1000.0, stats.interval.max() / 1000.0,
+			stats.interval.bars().c_str());
+	std::string summary(text);
+	g_free(text);
+	return summary;
+}
+
+gboolean FrameTimer::update_overlay_cb(void *data)
+{
+	auto obj = (FrameTimer *)data;
+	obj->update_overlay();
+	return G_SOURCE_CONTINUE;
+}
+
+void FrameTimer::update_overlay()
+{
+	std::string text = "window: " + stats_summary(m_total);
+	if (sakura->main_window->notebook.get_n_pages() > 0) {
+		auto term = sakura->main_window->notebook.get_current_tab_term();
+		if (term->frame_stats) {
+			text = term->label.get_text().raw() + ": " +
+			       stats_summary(*term->frame_stats) + "\n" + text;
+		}
+	}
+
+	gchar *markup = g_markup_printf_escaped(
+			"<span font_family=\"monospace\" size=\"small\" foreground=\"white\" "
+			"background=\"black\" bgalpha=\"75%%\">%s</span>",
+			text.c_str());
+	m_overlay->set_markup(markup);
+	g_free(markup);
+}
+
+gboolean FrameTimer::dump_cb(void *data)
+{
+	auto obj = (FrameTimer *)data;
+	obj->dump(stderr);
+	return G_SOURCE_CONTINUE;
+}
+
+static void dump_stats(FILE *file, const char *name, const FrameStats &stats)
+{
+	fprintf(file, "%s: %" G_GUINT64_FORMAT " frames, %" G_GUINT64_FORMAT " dropped\n", name,
+			stats.frames, stats.dropped);
+	stats.paint.dump(file, "paint");
+	stats.interval.dump(file, "interval");
+}
+
+void FrameTimer::dump(FILE *file)
+{
+	fprintf(file, "Frame timing\n");
+	dump_stats(file, "window", m_total);
+
+	auto n_pages = sakura->main_window->notebook.get_n_pages();
+	for (int i = 0; i < n_pages; i++) {
+		auto term = sakura->main_window->notebook.get_tab_term(i);
+		if (term->frame_stats) {
+			dump_stats(file, term->label.get_text().c_str(), *term->frame_stats);
+		}
+	}
+
+	fflush(file);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstdio>
+#include <string>
+#include <gtk/gtk.h>
+#include <gtkmm/label.h>
+
+#define FRAME_HISTOGRAM_BUCKETS 24
+
+/**
+ * Log-scale histogram of durations in microseconds. Bucket N counts the values in
+ * [2^N, 2^(N+1)), the last one everything above.
+ */
+class FrameHistogram
+{
+public:
+	void add(gint64 us);
+
+	guint64 count() const { return m_count; }
+	guint64 bucket(int i) const { return m_buckets[i]; }
+	gint64 sum() const { return m_sum; }
+	gint64 max() const { return m_max; }
+	/* Upper bound of the bucket the percentile falls in */
+	gint64 percentile(double p) const;
+	/* One block character per bucket, from the lowest to the highest non empty one */
+	std::string bars() const;
+	void dump(FILE *file, const char *name) const;
+
+private:
+	std::array<guint64, FRAME_HISTOGRAM_BUCKETS> m_buckets{};
+	guint64 m_count = 0;
+	gint64 m_sum = 0;
+	gint64 m_max = 0;
+};
+
+struct FrameStats {
+	FrameHistogram paint;    /* From before-paint to after-paint */
+	FrameHistogram interval; /* Between consecutive frames, idle gaps are not included */
+	guint64 frames = 0;
+	guint64 dropped = 0;     /* Refresh cycles missed while frames were being drawn */
+};
+
+/**
+ * Frame timing instrumentation, enabled with --frame-timing. Hooks the window frame clock and
+ * charges every frame to the tab shown at the time, and to the window totals. The numbers are
+ * shown in an overlay and printed to stderr when sakura gets SIGUSR1.
+ */
+class FrameTimer
+{
+public:
+	static FrameTimer &get();
+
+	/* Needs GTK to be initialized */
+	void enable();
+	bool is_enabled() const { return m_enabled; }
+
+	void attach(GtkWidget *window);
+	Gtk::Label *overlay() { return m_overlay; }
+	const FrameStats &total() const { return m_total; }
+	void dump(FILE *file);
+
+private:
+	FrameTimer() = default;
+	static void before_paint_cb(GdkFrameClock *clock, void *data);
+	static void after_paint_cb(GdkFrameClock *clock, void *data);
+	static gboolean update_overlay_cb(void *data);
+	static gboolean dump_cb(void *data);
+	void update_overlay();
+
+	bool m_enabled = false;
+	gint64 m_paint_start = 0;
+	gint64 m_last_frame_time = 0;
+	FrameStats m_total;
+	Gtk::Label *m_overlay = nullptr; /* Created by enable(), GTK must be initialized */
+};
@@ -0,0 +1,344 @@
+#include "hints.h"
+#include <algorithm>
+#include <cstring>
+#include <libintl.h>
+#include <vte/vte.h>
+#include "core/trace.h"
+#include "regexes.h"
+#include "sakura.h"
+#include "sakuraold.h"
+#include "terminal.h"
+#include "window.h"
+
+/* Home row first, so the most common labels are the easiest ones to type */
+static const char hint_alphabet[] = "asdfghjklqwertyuiopzxcvbnm";
+
+HintMatcher::HintMatcher()
+{
+	int errcode;
+	PCRE2_SIZE erroffset;
+
+	m_code = pcre2_compile((PCRE2_SPTR)HINTS_REGEXP, PCRE2_ZERO_TERMINATED, PCRE2_UTF,
+			&errcode, &erroffset, nullptr);
+	if (!m_code) {
+		PCRE2_UCHAR msg[256];
+		pcre2_get_error_message(errcode, msg, sizeof(msg));
+		TRACE_MSG("hints regexp: %s at offset %zu", (const char *)msg, (size_t)erroffset);
+		return;
+	}
+
+	m_jit = pcre2_jit_compile(m_code, PCRE2_JIT_COMPLETE) == 0;
+	m_match_data = pcre2_match_data_create_from_pattern(m_code, nullptr);
+}
+
+HintMatcher::~HintMatcher()
+{
+	if (m_match_data) {
+		pcre2_match_data_free(m_match_data);
+	}
+
+	if (m_code) {
+		pcre2_code_free(m_code);
+	}
+}
+
+/* A path hint must name a file with an extension, otherwise timestamps and host:port pairs
+ * would be labelled too */
+static bool path_has_extension(const char *start, const char *end)
+{
+	const char *colon = (const char *)memchr(start, ':', end - start);
+	const char *name = start;
+
+	for (const char *p = start; p < colon; p++) {
+		if (*p == '/')
+			name = p + 1;
+	}
+
+	for (const char *p = name; p + 1 < colon; p++) {
+		if (*p == '.' && g_ascii_isalpha(p[1]))
+			return true;
+	}
+
+	return false;
+}
+
+void HintMatcher::scan(const char *text, size_t len, std::vector<HintMatch> &matches) const
+{
+	matches.clear();
+
+	if (!m_code)
+		return;
+
+	PCRE2_SIZE offset = 0;
+	while (offset < len) {
+		int rc;
+		if (m_jit) {
+			rc = pcre2_jit_match(m_code, (PCRE2_SPTR)text, len, offset, 0, m_match_data,
+					nullptr);
+		} else {
+			rc = pcre2_match(m_code, (PCRE2_SPTR)text, len, offset, PCRE2_NO_UTF_CHECK,
+					m_match_data, nullptr);
+		}
+
+		if (rc < 0)
+			break;
+
+		PCRE2_SIZE *ovector = pcre2_get_ovector_pointer(m_match_data);
+		for (int group = 1; group < rc; group++) {
+			if (ovector[2 * group] == PCRE2_UNSET)
+				continue;
+
+			HintMatch match = {(HintKind)(group - 1), ovector[2 * group],
+					ovector[2 * group + 1]};
+			if (match.kind != HintKind::PATH ||
+					path_has_extension(text + match.start, text + match.end)) {
+				matches.push_back(match);
+			}
+			break;
+		}
+
+		/* Never loop on an empty match */
+		offset = std::max(ovector[1], ovector[0] + 1);
+	}
+}
+
+HintMode::~HintMode()
+{
+	stop();
+}
+
+void HintMode::start(Terminal *term)
+{
+	stop();
+
+	m_term = term;
+	extract();
+
+	if (m_hints.empty()) {
+		TRACE_MSG("No hints found on screen");
+		m_term = nullptr;
+		return;
+	}
+
+	assign_labels();
+	m_draw_callback_id =
+			g_signal_connect_after(term->vte, "draw", G_CALLBACK(HintMode::draw_cb), this);
+	gtk_widget_queue_draw(term->vte);
+}
+
+void HintMode::stop()
+{
+	if (!m_term)
+		return;
+
+	if (m_draw_callback_id) {
+		g_signal_handler_disconnect(m_term->vte, m_draw_callback_id);
+		m_draw_callback_id = 0;
+	}
+
+	gtk_widget_queue_draw(m_term->vte);
+	m_term = nullptr;
+	m_hints.clear();
+	m_typed.clear();
+}
+
+/* Wide characters take two cells */
+static glong cell_count(const char *p, const char *end)
+{
+	glong cells = 0;
+	for (; p < end; p = g_utf8_next_char(p))
+		cells += g_unichar_iswide(g_utf8_get_char(p)) ? 2 : 1;
+	return cells;
+}
+
+/* Read the visible screen into a single buffer, one line per row, and run the combined pattern
+ * over it once */
+void HintMode::extract()
+{
+	auto vte = VTE_TERMINAL(m_term->vte);
+	auto vadjustment = gtk_scrollable_get_vadjustment(GTK_SCROLLABLE(vte));
+	glong first_row = (glong)gtk_adjustment_get_value(vadjustment);
+	glong rows = vte_terminal_get_row_count(vte);
+	glong columns = vte_terminal_get_column_count(vte);
+
+	m_buffer.clear();
+	m_row_offsets.clear();
+	m_hints.clear();
+
+	bool wrapped = false;
+	for (glong row = 0; row < rows; row++) {
+		char *line = vte_terminal_get_text_range(vte, first_row + row, 0, first_row + row,
+				columns - 1, NULL, NULL, NULL);
+		size_t len = line ? strlen(line) : 0;
+		while (len > 0 && line[len - 1] == '\n')
+			len--;
+
+		/* Rows filling the whole width are most likely soft wrapped, so join them with the
+		 * next one and let a long URL be matched as a whole */
+		if (row > 0 && !wrapped)
+			m_buffer.push_back('\n');
+		m_row_offsets.push_back(m_buffer.size());
+		m_buffer.append(line ? line : "", len);
+		wrapped = line && cell_count(line, line + len) >= columns;
+
+		g_free(line);
+	}
+
+	m_matcher.scan(m_buffer.data(), m_buffer.size(), m_matches);
+
+	for (const auto &match : m_matches) {
+		auto it = std::upper_bound(m_row_offsets.begin(), m_row_offsets.end(), match.start);
+		glong row = (glong)(it - m_row_offsets.begin()) - 1;
+
+		glong column = cell_count(m_buffer.data() + m_row_offsets[row],
+				m_buffer.data() + match.start);
+
+		m_hints.push_back({match.kind, m_buffer.substr(match.start, match.end - match.start),
+				"", row, column});
+	}
+}
+
+/* All labels share the same length, so no label is a prefix of another one and a hint is
+ * activated as soon as its last character is typed */
+void HintMode::assign_labels()
+{
+	const size_t base = strlen(hint_alphabet);
+	size_t length = 1;
+	for (size_t capacity = base; capacity < m_hints.size(); capacity *= base)
+		length++;
+
+	for (size_t i = 0; i < m_hints.size(); i++) {
+		std::string label(length, hint_alphabet[0]);
+		size_t n = i;
+		for (size_t pos = length; pos-- > 0;) {
+			label[pos] = hint_alphabet[n % base];
+			n /= base;
+		}
+		m_hints[i].label = label;
+	}
+}
+
+gboolean HintMode::on_key_press(GdkEventKey *event)
+{
+	if (!is_active())
+		return FALSE;
+
+	switch (event->keyval) {
+	case GDK_KEY_Escape:
+		stop();
+		return TRUE;
+	case GDK_KEY_BackSpace:
+		if (!m_typed.empty())
+			m_typed.pop_back();
+		gtk_widget_queue_draw(m_term->vte);
+		return TRUE;
+	case GDK_KEY_Shift_L:
+	case GDK_KEY_Shift_R:
+		return TRUE;
+	}
+
+	guint32 c = gdk_keyval_to_unicode(event->keyval);
+	if (c == 0 || c > 127 || !g_ascii_isalpha((gchar)c))
+		return TRUE;
+
+	/* Typing the last character of a label with shift copies the match instead */
+	bool copy = g_ascii_isupper((gchar)c);
+	std::string typed = m_typed + g_ascii_tolower((gchar)c);
+
+	const Hint *found = nullptr;
+	bool any_prefix = false;
+	for (const auto &hint : m_hints) {
+		if (hint.label.compare(0, typed.size(), typed) == 0) {
+			any_prefix = true;
+			if (hint.label.size() == typed.size())
+				found = &hint;
+		}
+	}
+
+	if (found) {
+		Hint hint = *found;
+		stop();
+		activate(hint, copy);
+	} else if (any_prefix) {
+		m_typed = typed;
+		gtk_widget_queue_draw(m_term->vte);
+	}
+
+	return TRUE;
+}
+
+void HintMode::activate(const Hint &hint, bool copy)
+{
+	std::string text = hint.text;
+
+	if (hint.kind == HintKind::PATH) {
+		/* Drop the line (and column) suffix and resolve the path against the tab cwd */
+		text = text.substr(0, text.find(':'));
+		if (text.compare(0, 2, "~/") == 0) {
+			text = std::string(g_get_home_dir()) + text.substr(1);
+		} else if (!g_path_is_absolute(text.c_str())) {
+			auto term = sakura->main_window->notebook.get_current_tab_term();
+			gchar *cwd = term->get_cwd();
+			if (cwd) {
+				gchar *path = g_build_filename(cwd, text.c_str(), NULL);
+				text = path;
+				g_free(path);
+				g_free(cwd);
+			}
+		}
+	}
+
+	g_free(sakura->current_match);
+	sakura->current_match = g_strdup(text.c_str());
+
+	if (copy || hint.kind == HintKind::IP || hint.kind == HintKind::HASH) {
+		sakura->copy_url();
+	} else if (hint.kind == HintKind::MAIL) {
+		sakura->open_mail();
+	} else {
+		sakura->open_url();
+	}
+}
+
+gboolean HintMode::draw_cb(GtkWidget *widget, cairo_t *cr, void *data)
+{
+	auto obj = (HintMode *)data;
+	obj->draw(widget, cr);
+	return FALSE;
+}
+
+void HintMode::draw(GtkWidget *widget, cairo_t *cr)
+{
+	auto vte = VTE_TERMINAL(widget);
+	glong char_width = vte_terminal_get_char_width(vte);
+	glong char_height = vte_terminal_get_char_height(vte);
+
+	GtkBorder padding;
+	gtk_style_context_get_padding(gtk_widget_get_style_context(widget),
+			gtk_widget_get_state_flags(widget), &padding);
+
+	PangoLayout *layout = pango_cairo_create_layout(cr);
+	pango_layout_set_font_description(layout, vte_terminal_get_font(vte));
+
+	for (const auto &hint : m_hints) {
+		if (hint.label.compare(0, m_typed.size(), m_typed) != 0)
+			continue;
+
+		double x = padding.left + hint.column * char_width;
+		double y = padding.top + hint.row * char_height;
+
+		pango_layout_set_text(layout, hint.label.c_str(), -1);
+		int text_width, text_height;
+		pango_layout_get_pixel_size(layout, &text_width, &text_height);
+
+		cairo_set_source_rgb(cr, 1.0, 0.84, 0.0);
+		cairo_rectangle(cr, x, y, text_width, char_height);
+		cairo_fill(cr);
+
+		cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+		cairo_move_to(cr, x, y);
+		pango_cairo_show_layout(cr, layout);
+	}
+
+	g_object_unref(layout);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <gtk/gtk.h>
+#define PCRE2_CODE_UNIT_WIDTH 8
+#include <pcre2.h>
+
+class Terminal;
+
+enum class HintKind
+{
+	URL,
+	MAIL,
+	IP,
+	PATH,
+	HASH,
+};
+
+struct HintMatch {
+	HintKind kind;
+	size_t start; /* Byte offsets inside the scanned buffer */
+	size_t end;
+};
+
+/**
+ * All the hint patterns compiled into a single alternation, so the visible screen
+ * is scanned once no matter how many kinds of hints we look for
+ */
+class HintMatcher
+{
+public:
+	HintMatcher();
+	~HintMatcher();
+
+	bool is_valid() const { return m_code != nullptr; }
+	void scan(const char *text, size_t len, std::vector<HintMatch> &matches) const;
+
+private:
+	pcre2_code *m_code = nullptr;
+	pcre2_match_data *m_match_data = nullptr;
+	bool m_jit = false;
+};
+
+struct Hint {
+	HintKind kind;
+	std::string text;
+	std::string label;
+	glong row;    /* Screen row, relative to the first visible one */
+	glong column;
+};
+
+class HintMode
+{
+public:
+	HintMode() = default;
+	~HintMode();
+
+	void start(Terminal *term);
+	void stop();
+	bool is_active() const { return m_term != nullptr; }
+
+	/* Consumes every key while active. Returns TRUE when the event was handled */
+	gboolean on_key_press(GdkEventKey *event);
+
+private:
+	static gboolean draw_cb(GtkWidget *widget, cairo_t *cr, void *data);
+	void draw(GtkWidget *widget, cairo_t *cr);
+	void extract();
+	void assign_labels();
+	void activate(const Hint &hint, bool copy);
+
+	HintMatcher m_matcher;
+	Terminal *m_term = nullptr;
+	gulong m_draw_callback_id = 0;
+	std::vector<Hint> m_hints;
+	std::string m_typed;
+	std::string m_buffer;
+	std::vector<size_t> m_row_offsets;
+	std::vector<HintMatch> m_matches;
+};
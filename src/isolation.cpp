@@ -0,0 +1,203 @@
+#include "isolation.h"
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "core/configdata.h"
+#include "core/trace.h"
+#include "sakuraold.h"
+#include "terminal.h"
+
+#define CGROUP_MOUNT "/sys/fs/cgroup"
+
+/* ioprio_set(2) values, glibc has no wrapper for it */
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_LOWEST_BE ((IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | 7)
+
+static bool write_file(const std::string &path, const std::string &value)
+{
+	int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	bool written = write(fd, value.data(), value.size()) == (ssize_t)value.size();
+	close(fd);
+	return written;
+}
+
+static bool has_controller(const std::string &dir, const char *controller)
+{
+	std::ifstream file(dir + "/cgroup.subtree_control");
+	std::string name;
+	while (file >> name) {
+		if (name == controller)
+			return true;
+	}
+	return false;
+}
+
+TabIsolation &TabIsolation::get()
+{
+	static TabIsolation isolation;
+	return isolation;
+}
+
+void TabIsolation::setup(const ConfigData &config)
+{
+	m_enabled = config.isolate_tabs;
+	if (m_enabled && !setup_cgroups())
+		TRACE_MSG("No delegated cgroup v2 subtree, tabs are isolated with nice");
+}
+
+bool TabIsolation::setup_cgroups()
+{
+	std::ifstream file("/proc/self/cgroup");
+	std::string line, path;
+	while (std::getline(file, line)) {
+		if (line.compare(0, 3, "0::") == 0)
+			path = line.substr(3);
+	}
+	if (path.empty())
+		return false;
+
+	std::string root = CGROUP_MOUNT + (path == "/" ? "" : path);
+	if (access((root + "/cgroup.procs").c_str(), W_OK) != 0 ||
+			access((root + "/cgroup.subtree_control").c_str(), W_OK) != 0)
+		return false;
+
+	/* Everything goes below a directory of this instance, other sakura processes can share
+	 * the delegated cgroup */
+	std::string instance = root + "/sakura-" + std::to_string(getpid());
+	if (mkdir(instance.c_str(), 0755) != 0)
+		return false;
+	if (mkdir((instance + "/gui").c_str(), 0755) != 0) {
+		rmdir(instance.c_str());
+		return false;
+	}
+	m_root = root;
+	m_instance = instance;
+
+	/* Controllers can only be enabled for the children of a cgroup without processes, so
+	 * sakura moves to its leaf first, and back if no controller can be had */
+	if (write_file(instance + "/gui/cgroup.procs", std::to_string(getpid()))) {
+		for (const char *controller : {"cpu", "memory"}) {
+			if (!has_controller(root, controller)) {
+				if (!write_file(root + "/cgroup.subtree_control",
+							std::string("+") + controller))
+					continue;
+				m_root_controllers.push_back(controller);
+			}
+			write_file(instance + "/cgroup.subtree_control",
+					std::string("+") + controller);
+		}
+		if (has_controller(instance, "cpu") || has_controller(instance, "memory"))
+			return true;
+	}
+
+	stop();
+	return false;
+}
+
+/* Undoes setup_cgroups, as far as the processes of the tabs still running allow */
+void TabIsolation::stop()
+{
+	if (!has_cgroups())
+		return;
+
+	/* A cgroup with controllers enabled for its children can't have processes, the
+	 * controllers sakura enabled are disabled before it moves back */
+	for (const char *controller : {"cpu", "memory"})
+		write_file(m_instance + "/cgroup.subtree_control", std::string("-") + controller);
+	for (const auto &controller : m_root_controllers)
+		write_file(m_root + "/cgroup.subtree_control", "-" + controller);
+	write_file(m_root + "/cgroup.procs", std::to_string(getpid()));
+
+	rmdir((m_instance + "/gui").c_str());
+	remove_released();
+	rmdir(m_instance.c_str());
+	m_root.clear();
+	m_instance.clear();
+	m_root_controllers.clear();
+}
+
+ChildIsolation *TabIsolation::prepare(Terminal *term)
+{
+	if (!m_enabled)
+		return nullptr;
+
+	remove_released();
+
+	const ConfigData &config = sakura->config;
+	auto isolation = new ChildIsolation();
+	isolation->cgroup_procs[0] = '\0';
+	isolation->nice = config.tab_nice;
+
+	if (has_cgroups()) {
+		std::string dir = m_instance + "/tab-" + std::to_string(m_next_tab++);
+		if (mkdir(dir.c_str(), 0755) == 0) {
+			write_file(dir + "/cpu.weight", std::to_string(config.tab_cpu_weight));
+			if (!config.tab_memory_high.empty())
+				write_file(dir + "/memory.high", config.tab_memory_high);
+			snprintf(isolation->cgroup_procs, sizeof(isolation->cgroup_procs),
+					"%s/cgroup.procs", dir.c_str());
+			term->cgroup = dir;
+		}
+	}
+
+	return isolation;
+}
+
+void TabIsolation::release(Terminal *term)
+{
+	if (term->cgroup.empty())
+		return;
+
+	m_released.push_back(term->cgroup);
+	term->cgroup.clear();
+	remove_released();
+}
+
+/* A cgroup can't be removed while it has processes, the ones still busy are retried later */
+void TabIsolation::remove_released()
+{
+	for (auto it = m_released.begin(); it != m_released.end();) {
+		if (rmdir(it->c_str()) == 0 || errno == ENOENT)
+			it = m_released.erase(it);
+		else
+			++it;
+	}
+}
+
+/* Runs in the child, between fork and exec: async-signal-safe calls only */
+void TabIsolation::child_setup(void *data)
+{
+	auto isolation = (ChildIsolation *)data;
+
+	if (isolation->cgroup_procs[0]) {
+		int fd = open(isolation->cgroup_procs, O_WRONLY | O_CLOEXEC);
+		if (fd >= 0) {
+			bool moved = write(fd, "0", 1) == 1;
+			close(fd);
+			if (moved)
+				return;
+		}
+	}
+
+	/* Lowering the priority again needs CAP_SYS_NICE, so it is done once for good */
+	errno = 0;
+	int nice = getpriority(PRIO_PROCESS, 0);
+	if (errno == 0)
+		setpriority(PRIO_PROCESS, 0, nice + isolation->nice);
+	syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_LOWEST_BE);
+}
+
+void TabIsolation::free_child_setup(void *data)
+{
+	delete (ChildIsolation *)data;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <climits>
+#include <string>
+#include <vector>
+
+class ConfigData;
+class Terminal;
+
+/* What the child of a tab does between fork and exec, prepared by the GUI thread */
+struct ChildIsolation {
+	char cgroup_procs[PATH_MAX]; /* cgroup.procs of the tab cgroup, empty without cgroups */
+	int nice;                    /* Added to the child niceness without cgroups */
+};
+
+/**
+ * Keeps the children of the tabs from starving sakura, enabled with isolate_tabs. When the
+ * cgroup v2 subtree of sakura is delegated to the user (a systemd user scope, usually), sakura
+ * creates a sakura-<pid> directory in it, moves itself to its "gui" leaf and puts the child of
+ * every tab in a tab-N leaf of its own, with tab_cpu_weight and tab_memory_high. Otherwise the
+ * children run with tab_nice added to their niceness and the lowest best-effort I/O priority.
+ *
+ * The children move themselves, from the child_setup of the spawn, so nothing they start runs
+ * a single instruction in the cgroup of sakura.
+ */
+class TabIsolation
+{
+public:
+	static TabIsolation &get();
+
+	/* Once, before the first tab */
+	void setup(const ConfigData &config);
+	/* Before exiting, moves sakura back and removes the cgroups that are empty by now */
+	void stop();
+	bool is_enabled() const { return m_enabled; }
+	bool has_cgroups() const { return !m_root.empty(); }
+
+	/* Setup data for the spawn of the tab child, nullptr when disabled. Freed by
+	 * free_child_setup */
+	ChildIsolation *prepare(Terminal *term);
+	/* The tab is gone, its cgroup is removed once its processes are */
+	void release(Terminal *term);
+
+	static void child_setup(void *data);
+	static void free_child_setup(void *data);
+
+private:
+	TabIsolation() = default;
+	bool setup_cgroups();
+	void remove_released();
+
+	bool m_enabled = false;
+	std::string m_root;     /* cgroup directory sakura started in, empty without cgroups */
+	std::string m_instance; /* sakura-<pid> directory holding the gui and tab leaves */
+	std::vector<std::string> m_root_controllers; /* Enabled in m_root by sakura */
+	int m_next_tab = 1;
+	std::vector<std::string> m_released;
+};
@@ -0,0 +1,117 @@
+#include "latency.h"
+#include <algorithm>
+#include <cstdio>
+#include "benchreport.h"
+
+/* Keys without an echo after this long are given up */
+#define LATENCY_TIMEOUT_US 1000000
+/* VTE commits typed text from its key press handler, right after ours. Later commits come from
+ * pastes, even if they were started with a key */
+#define LATENCY_COMMIT_US 10000
+
+LatencyProbe &LatencyProbe::get()
+{
+	static LatencyProbe probe;
+	return probe;
+}
+
+void LatencyProbe::key_pressed()
+{
+	if (!m_enabled)
+		return;
+
+	m_key_time = g_get_monotonic_time();
+}
+
+void LatencyProbe::watch(GtkWidget *vte)
+{
+	if (!m_enabled)
+		return;
+
+	g_signal_connect(vte, "commit", G_CALLBACK(LatencyProbe::commit_cb), this);
+	g_signal_connect(vte, "contents-changed", G_CALLBACK(LatencyProbe::contents_changed_cb),
+			this);
+}
+
+void LatencyProbe::attach(GtkWidget *window)
+{
+	if (!m_enabled)
+		return;
+
+	GdkFrameClock *clock = gtk_widget_get_frame_clock(window);
+	if (clock) {
+		g_signal_connect(clock, "after-paint", G_CALLBACK(LatencyProbe::after_paint_cb),
+				this);
+	}
+}
+
+void LatencyProbe::commit_cb(GtkWidget *vte, gchar *text, guint size, void *data)
+{
+	auto obj = (LatencyProbe *)data;
+	gint64 key_time = obj->m_key_time;
+	obj->m_key_time = 0;
+	if (key_time == 0 || g_get_monotonic_time() - key_time > LATENCY_COMMIT_US)
+		return;
+
+	if (obj->m_pending_time) {
+		if (key_time - obj->m_pending_time < LATENCY_TIMEOUT_US) {
+			obj->m_skipped++;
+			return;
+		}
+		obj->m_lost++;
+	}
+
+	obj->m_pending_time = key_time;
+	obj->m_pending_vte = vte;
+	obj->m_echoed = false;
+}
+
+void LatencyProbe::contents_changed_cb(GtkWidget *vte, void *data)
+{
+	auto obj = (LatencyProbe *)data;
+	if (obj->m_pending_time && vte == obj->m_pending_vte)
+		obj->m_echoed = true;
+}
+
+void LatencyProbe::after_paint_cb(GdkFrameClock *clock, void *data)
+{
+	auto obj = (LatencyProbe *)data;
+	if (!obj->m_echoed)
+		return;
+
+	obj->m_latencies.push_back(g_get_monotonic_time() - obj->m_pending_time);
+	obj->m_pending_time = 0;
+	obj->m_pending_vte = nullptr;
+	obj->m_echoed = false;
+}
+
+void LatencyProbe::report()
+{
+	if (!m_enabled)
+		return;
+
+	auto &bench = BenchReport::get();
+	bench.set("latency_keys", m_latencies.size());
+	bench.set("latency_skipped", m_skipped);
+	bench.set("latency_lost", m_lost);
+
+	if (m_latencies.empty()) {
+		fprintf(stderr, "Keystroke latency: no key measured\n");
+		return;
+	}
+
+	std::sort(m_latencies.begin(), m_latencies.end());
+	gint64 p50 = m_latencies[m_latencies.size() / 2];
+	gint64 p99 = m_latencies[std::min(m_latencies.size() - 1, m_latencies.size() * 99 / 100)];
+	gint64 max = m_latencies.back();
+
+	bench.set("latency_p50_us", p50);
+	bench.set("latency_p99_us", p99);
+	bench.set("latency_max_us", max);
+
+	fprintf(stderr,
+			"Keystroke latency: %zu keys, p50 %.2f ms, p99 %.2f ms, max %.2f ms "
+			"(%" G_GUINT64_FORMAT " skipped, %" G_GUINT64_FORMAT " lost)\n",
+			m_latencies.size(), p50 / 1000.0, p99 / 1000.0, max / 1000.0, m_skipped,
+			m_lost);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <gtk/gtk.h>
+
+/**
+ * Keystroke to photon latency, enabled with --measure-latency. A key press is timestamped in
+ * Sakura::on_key_press, before VTE sees it. If VTE sends it to the child ("commit"), the
+ * measurement ends at the first frame painted after the terminal contents changed, which is
+ * the frame showing the echo.
+ *
+ * One key is measured at a time: keys typed while another one waits for its echo are counted
+ * as skipped, and keys without an echo after a second (passwords, shortcuts of the child) as
+ * lost. The results are printed when sakura exits, and added to the --bench-report.
+ */
+class LatencyProbe
+{
+public:
+	static LatencyProbe &get();
+
+	void enable() { m_enabled = true; }
+	bool is_enabled() const { return m_enabled; }
+
+	void key_pressed();
+	void watch(GtkWidget *vte);
+	void attach(GtkWidget *window);
+	void report();
+
+private:
+	LatencyProbe() = default;
+	static void commit_cb(GtkWidget *vte, gchar *text, guint size, void *data);
+	static void contents_changed_cb(GtkWidget *vte, void *data);
+	static void after_paint_cb(GdkFrameClock *clock, void *data);
+
+	bool m_enabled = false;
+	gint64 m_key_time = 0;      /* Last key press not sent to the child yet */
+	gint64 m_pending_time = 0;  /* Key press waiting for its echo */
+	GtkWidget *m_pending_vte = nullptr;
+	bool m_echoed = false;
+	std::vector<gint64> m_latencies;
+	guint64 m_skipped = 0;
+	guint64 m_lost = 0;
+};
@@ -1,16 +1,43 @@
 #include <clocale>
 #include <libintl.h>
 #include <glib.h>
+#include <glib-unix.h>
 #include <gtk/gtk.h>
 #include <gtkmm.h>
+#include "benchreport.h"
+#include "benchscenario.h"
+#include "core/trace.h"
+#include "frametimer.h"
 #include "gettext.h"
+#include "isolation.h"
+#include "latency.h"
+#include "metrics.h"
+#include "proctracker.h"
+#include "resourcemeter.h"
 #include "sakuraold.h"
+#include "watchdog.h"
 
 // The global sakura singleton
 // It should disappear at a moment
 Sakura *sakura;
 GQuark term_data_id = 0;
 
+/* kill -USR2 PID writes the events recorded so far to a new file */
+static gboolean trace_export_cb(void *data)
+{
+	static int exports = 0;
+	gchar *path = g_strdup_printf(
+			"%s/sakura-trace-%d-%d.json", g_get_tmp_dir(), getpid(), ++exports);
+
+	if (trace_export(path))
+		fprintf(stderr, "Trace written to %s\n", path);
+	else
+		fprintf(stderr, "Cannot write the trace to %s\n", path);
+
+	g_free(path);
+	return G_SOURCE_CONTINUE;
+}
+
 int main(int argc, char **argv)
 {
 	gchar *localedir;
@@ -20,6 +47,10 @@ int main(int argc, char **argv)
 	int nargc;
 	gboolean have_e;
 
+	BenchReport::get().mark("main_start");
+	if constexpr (SAKURA_TRACE_LEVEL > TRACE_LEVEL_OFF)
+		trace_set_thread_name("gui");
+
 	/* Localization */
 	std::setlocale(LC_ALL, "");
 	localedir = g_strdup_printf("%s/locale", DATADIR);
@@ -67,6 +98,7 @@ int main(int argc, char **argv)
 	}
 
 	g_option_context_free(context);
+	BenchReport::get().mark("options_parsed");
 
 	if (option_workdir && chdir(option_workdir)) {
 		fprintf(stderr, _("Cannot change working directory\n"));
@@ -82,11 +114,51 @@ int main(int argc, char **argv)
 		option_ntabs = 1;
 	}
 
+	if (option_bench_report) {
+		BenchReport::get().open(option_bench_report);
+	}
+
+	if (option_measure_latency) {
+		LatencyProbe::get().enable();
+	}
+
 	/* Init stuff */
 	Gtk::Main app(&nargc, &nargv);
 	g_strfreev(nargv);
+	BenchReport::get().mark("gtk_init");
+
+	if (option_frame_timing) {
+		FrameTimer::get().enable();
+	}
+
+	if constexpr (SAKURA_TRACE_LEVEL > TRACE_LEVEL_OFF)
+		g_unix_signal_add(SIGUSR2, trace_export_cb, NULL);
+
+	if (option_watchdog > 0) {
+		Watchdog::get().start(option_watchdog, option_watchdog_backtrace);
+	}
+
+	if (option_metrics_socket && !MetricsServer::get().start(option_metrics_socket)) {
+		exit(1);
+	}
 
 	std::unique_ptr<Sakura> me(new Sakura());
+
+	if (option_bench_scenario && !BenchScenario::start(option_bench_scenario)) {
+		fprintf(stderr, "Unknown benchmark scenario %s\n", option_bench_scenario);
+		exit(1);
+	}
+
+	BenchReport::get().mark("main_loop");
 	Gtk::Main::run();
+
+	MetricsServer::get().stop();
+	Watchdog::get().stop();
+	ProcTracker::get().stop();
+	ResourceMeter::get().stop();
+	TabIsolation::get().stop();
+
+	LatencyProbe::get().report();
+	BenchReport::get().write();
 	return 0;
 }
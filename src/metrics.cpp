@@ -0,0 +1,372 @@
+#include "metrics.h"
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "core/trace.h"
+#include "frametimer.h"
+#include "notebook.h"
+#include "sakuraold.h"
+#include "terminal.h"
+#include "watchdog.h"
+#include "window.h"
+
+/* How long a scrape waits for the GUI thread before leaving its values out */
+#define METRICS_GUI_TIMEOUT_MS 250
+#define METRICS_REQUEST_SIZE 4096
+
+/* Filled by the GUI thread for a scrape, shared because the scrape may give up first */
+struct GuiMetrics {
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool done = false;
+	std::string text;
+};
+
+MetricsServer &MetricsServer::get()
+{
+	static MetricsServer server;
+	return server;
+}
+
+bool MetricsServer::start(const char *path)
+{
+	struct sockaddr_un addr = {};
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Metrics socket path is too long: %s\n", path);
+		return false;
+	}
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	/* A socket left by a sakura that crashed is replaced, anything else at the path is kept */
+	struct stat st;
+	if (lstat(path, &st) == 0) {
+		if (!S_ISSOCK(st.st_mode)) {
+			fprintf(stderr, "Cannot listen on %s: not a socket\n", path);
+			return false;
+		}
+		unlink(path);
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd == -1) {
+		perror("socket");
+		return false;
+	}
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, 4) == -1) {
+		fprintf(stderr, "Cannot listen on %s: %s\n", path, strerror(errno));
+		close(fd);
+		return false;
+	}
+	chmod(path, S_IRUSR | S_IWUSR);
+
+	m_listen_fd = fd;
+	m_path = path;
+	m_thread = std::thread(&MetricsServer::serve, this);
+	return true;
+}
+
+void MetricsServer::stop()
+{
+	if (m_listen_fd < 0)
+		return;
+
+	/* Wakes up the accept() of the metrics thread */
+	shutdown(m_listen_fd, SHUT_RDWR);
+	m_thread.join();
+	close(m_listen_fd);
+	unlink(m_path.c_str());
+	m_listen_fd = -1;
+}
+
+static void tab_bell_cb(GtkWidget *vte, void *data)
+{
+	auto metrics = (std::shared_ptr<TabMetrics> *)data;
+	(*metrics)->bells.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void tab_title_changed_cb(GtkWidget *vte, void *data)
+{
+	auto metrics = (std::shared_ptr<TabMetrics> *)data;
+	(*metrics)->title_changes.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void free_tab_metrics(void *data, GClosure *closure)
+{
+	delete (std::shared_ptr<TabMetrics> *)data;
+}
+
+std::shared_ptr<TabMetrics> MetricsServer::add_tab(Terminal *term)
+{
+	if (!is_enabled())
+		return nullptr;
+
+	auto metrics = std::make_shared<TabMetrics>();
+	{
+		std::lock_guard<std::mutex> lock(m_tabs_mutex);
+		metrics->id = m_next_tab_id++;
+		m_tabs.push_back(metrics);
+	}
+
+	/* The handlers keep the counters alive as long as the vte, which can outlive the tab */
+	g_signal_connect_data(G_OBJECT(term->vte), "bell", G_CALLBACK(tab_bell_cb),
+			new std::shared_ptr<TabMetrics>(metrics), free_tab_metrics,
+			(GConnectFlags)0);
+	g_signal_connect_data(G_OBJECT(term->vte), "window-title-changed",
+			G_CALLBACK(tab_title_changed_cb), new std::shared_ptr<TabMetrics>(metrics),
+			free_tab_metrics, (GConnectFlags)0);
+
+	return metrics;
+}
+
+void MetricsServer::serve()
+{
+	if constexpr (SAKURA_TRACE_LEVEL > TRACE_LEVEL_OFF)
+		trace_set_thread_name("metrics");
+
+	while (true) {
+		int fd = accept4(m_listen_fd, NULL, NULL, SOCK_CLOEXEC);
+		if (fd == -1) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			/* The socket was shut down by stop() */
+			return;
+		}
+
+		/* The request itself does not matter, but it must be read before answering */
+		struct timeval timeout = {1, 0};
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		std::string request;
+		char buffer[512];
+		ssize_t n;
+		while (request.size() < METRICS_REQUEST_SIZE &&
+				request.find("\r\n\r\n") == std::string::npos &&
+				(n = read(fd, buffer, sizeof(buffer))) > 0) {
+			request.append(buffer, n);
+		}
+
+		std::string body = collect();
+		std::string response = "HTTP/1.0 200 OK\r\n"
+				       "Content-Type: text/plain; version=0.0.4\r\n"
+				       "Content-Length: " +
+				       std::to_string(body.size()) + "\r\n\r\n" + body;
+
+		const char *data = response.data();
+		size_t left = response.size();
+		while (left > 0 && (n = send(fd, data, left, MSG_NOSIGNAL)) > 0) {
+			data += n;
+			left -= n;
+		}
+		close(fd);
+	}
+}
+
+static void family(std::ostringstream &out, const char *name, const char *type, const char *help)
+{
+	out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+
+/* Bytes the process wrote to any file, from /proc. Not readable for setuid children */
+static bool child_write_bytes(int pid, guint64 &bytes)
+{
+	std::ifstream io("/proc/" + std::to_string(pid) + "/io");
+	std::string key;
+	while (io >> key >> bytes) {
+		if (key == "wchar:")
+			return true;
+	}
+
+	return false;
+}
+
+std::string MetricsServer::collect()
+{
+	/* Ask the GUI thread first, it works while the counters below are read */
+	auto gui = std::make_shared<GuiMetrics>();
+	gint64 asked = g_get_monotonic_time();
+	g_main_context_invoke(NULL, MetricsServer::collect_gui_cb,
+			new std::shared_ptr<GuiMetrics>(gui));
+
+	std::vector<std::shared_ptr<TabMetrics>> tabs;
+	{
+		std::lock_guard<std::mutex> lock(m_tabs_mutex);
+		for (auto it = m_tabs.begin(); it != m_tabs.end();) {
+			if (auto tab = it->lock()) {
+				tabs.push_back(tab);
+				++it;
+			} else {
+				it = m_tabs.erase(it);
+			}
+		}
+	}
+
+	std::ostringstream out;
+	family(out, "sakura_tabs", "gauge", "Open tabs.");
+	out << "sakura_tabs " << tabs.size() << "\n";
+
+	family(out, "sakura_tab_child_pid", "gauge", "PID of the process started in the tab.");
+	for (const auto &tab : tabs)
+		out << "sakura_tab_child_pid{tab=\"" << tab->id << "\"} " << tab->pid << "\n";
+
+	family(out, "sakura_tab_read_bytes_total", "counter",
+			"Bytes read from the child, only for tabs whose output sakura reads itself "
+			"(--record).");
+	for (const auto &tab : tabs) {
+		if (tab->proxied)
+			out << "sakura_tab_read_bytes_total{tab=\"" << tab->id << "\"} "
+			    << tab->bytes_read.load(std::memory_order_relaxed) << "\n";
+	}
+
+	family(out, "sakura_tab_child_write_bytes_total", "counter",
+			"Bytes written by the child to any file, from /proc/PID/io.");
+	for (const auto &tab : tabs) {
+		guint64 bytes;
+		if (tab->pid > 0 && child_write_bytes(tab->pid, bytes))
+			out << "sakura_tab_child_write_bytes_total{tab=\"" << tab->id << "\"} "
+			    << bytes << "\n";
+	}
+
+	family(out, "sakura_tab_bells_total", "counter", "Bells rung in the tab.");
+	for (const auto &tab : tabs)
+		out << "sakura_tab_bells_total{tab=\"" << tab->id << "\"} "
+		    << tab->bells.load(std::memory_order_relaxed) << "\n";
+
+	family(out, "sakura_tab_title_changes_total", "counter", "Title changes of the tab.");
+	for (const auto &tab : tabs)
+		out << "sakura_tab_title_changes_total{tab=\"" << tab->id << "\"} "
+		    << tab->title_changes.load(std::memory_order_relaxed) << "\n";
+
+	long pages = 0;
+	std::ifstream statm("/proc/self/statm");
+	statm >> pages >> pages;
+	family(out, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes.");
+	out << "process_resident_memory_bytes " << pages * sysconf(_SC_PAGESIZE) << "\n";
+
+	bool answered;
+	{
+		std::unique_lock<std::mutex> lock(gui->mutex);
+		auto timeout = std::chrono::milliseconds(METRICS_GUI_TIMEOUT_MS);
+		answered = gui->cond.wait_for(lock, timeout, [&gui] { return gui->done; });
+		if (answered)
+			out << gui->text;
+	}
+	if (!answered)
+		m_gui_stalls++;
+
+	if (Watchdog::get().is_enabled()) {
+		auto stalls = Watchdog::get().stats();
+		family(out, "sakura_gui_watchdog_stalls_total", "counter",
+				"GUI thread stalls longer than --watchdog, by phase.");
+		for (const auto &stall : stalls)
+			out << "sakura_gui_watchdog_stalls_total{phase=\"" << stall.first << "\"} "
+			    << stall.second.count << "\n";
+		family(out, "sakura_gui_watchdog_stall_seconds_total", "counter",
+				"Time the GUI thread spent in those stalls.");
+		for (const auto &stall : stalls)
+			out << "sakura_gui_watchdog_stall_seconds_total{phase=\"" << stall.first
+			    << "\"} " << stall.second.total_us / 1e6 << "\n";
+		family(out, "sakura_gui_watchdog_stall_max_seconds", "gauge",
+				"Longest of those stalls.");
+		for (const auto &stall : stalls)
+			out << "sakura_gui_watchdog_stall_max_seconds{phase=\"" << stall.first
+			    << "\"} " << stall.second.max_us / 1e6 << "\n";
+	}
+
+	family(out, "sakura_gui_response_seconds", "gauge",
+			"Time the GUI thread took to answer this scrape, or the timeout.");
+	out << "sakura_gui_response_seconds " << (g_get_monotonic_time() - asked) / 1e6 << "\n";
+	family(out, "sakura_gui_stalls_total", "counter",
+			"Scrapes the GUI thread did not answer in time.");
+	out << "sakura_gui_stalls_total " << m_gui_stalls << "\n";
+
+	return out.str();
+}
+
+gboolean MetricsServer::collect_gui_cb(void *data)
+{
+	auto gui = (std::shared_ptr<GuiMetrics> *)data;
+	std::string text = gui_metrics();
+
+	{
+		std::lock_guard<std::mutex> lock((*gui)->mutex);
+		(*gui)->text = text;
+		(*gui)->done = true;
+	}
+	(*gui)->cond.notify_one();
+
+	delete gui;
+	return G_SOURCE_REMOVE;
+}
+
+static void histogram(std::ostringstream &out, const char *name, const char *help,
+		const FrameHistogram &histogram)
+{
+	family(out, name, "histogram", help);
+
+	guint64 count = 0;
+	for (int i = 0; i < FRAME_HISTOGRAM_BUCKETS - 1; i++) {
+		count += histogram.bucket(i);
+		double le = (1L << (i + 1)) / 1e6;
+		out << name << "_bucket{le=\"" << le << "\"} " << count << "\n";
+	}
+	out << name << "_bucket{le=\"+Inf\"} " << histogram.count() << "\n";
+	out << name << "_sum " << histogram.sum() / 1e6 << "\n";
+	out << name << "_count " << histogram.count() << "\n";
+}
+
+/* Runs in the GUI thread */
+std::string MetricsServer::gui_metrics()
+{
+	std::ostringstream out;
+	if (!sakura || !sakura->main_window)
+		return out.str();
+
+	auto &notebook = sakura->main_window->notebook;
+	int n_pages = notebook.get_n_pages();
+
+	family(out, "sakura_tab_scrollback_lines", "gauge",
+			"Lines in the tab, scrollback included.");
+	for (int i = 0; i < n_pages; i++) {
+		auto term = notebook.get_tab_term(i);
+		if (!term->metrics)
+			continue;
+		auto adjustment = gtk_scrollable_get_vadjustment(GTK_SCROLLABLE(term->vte));
+		out << "sakura_tab_scrollback_lines{tab=\"" << term->metrics->id << "\"} "
+		    << (long)gtk_adjustment_get_upper(adjustment) << "\n";
+	}
+
+	auto &timer = FrameTimer::get();
+	if (!timer.is_enabled())
+		return out.str();
+
+	family(out, "sakura_tab_frames_total", "counter", "Frames drawn while the tab was shown.");
+	for (int i = 0; i < n_pages; i++) {
+		auto term = notebook.get_tab_term(i);
+		if (term->metrics && term->frame_stats)
+			out << "sakura_tab_frames_total{tab=\"" << term->metrics->id << "\"} "
+			    << term->frame_stats->frames << "\n";
+	}
+
+	family(out, "sakura_tab_frames_dropped_total", "counter",
+			"Refresh cycles missed while the tab was shown.");
+	for (int i = 0; i < n_pages; i++) {
+		auto term = notebook.get_tab_term(i);
+		if (term->metrics && term->frame_stats)
+			out << "sakura_tab_frames_dropped_total{tab=\"" << term->metrics->id
+			    << "\"} " << term->frame_stats->dropped << "\n";
+	}
+
+	histogram(out, "sakura_frame_paint_seconds", "Time to paint a frame.",
+			timer.total().paint);
+	histogram(out, "sakura_frame_interval_seconds", "Time between consecutive frames.",
+			timer.total().interval);
+
+	return out.str();
+}
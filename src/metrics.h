@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtk/gtk.h>
+
+class Terminal;
+
+/* Counters of a tab, updated from the GUI thread and read by the metrics thread */
+struct TabMetrics {
+	int id = 0; /* Stable number of the tab, used as its label */
+	std::atomic<int> pid{0};
+	std::atomic<bool> proxied{false}; /* Output is read by sakura, so bytes_read is exact */
+	std::atomic<guint64> bytes_read{0};
+	std::atomic<guint64> bells{0};
+	std::atomic<guint64> title_changes{0};
+};
+
+/**
+ * Prometheus text metrics on a Unix socket, enabled with --metrics-socket=PATH. Any request to
+ * the socket gets the metrics as an HTTP response, e.g.
+ *     curl --unix-socket PATH http://localhost/metrics
+ *
+ * Requests are answered by a thread of their own, so the hot paths only bump the per-tab
+ * atomics. Values that live in GTK objects (scrollback, frame timing) are collected by the
+ * GUI thread when a scrape asks for them; if it does not answer in time they are left out and
+ * the scrape counts as a GUI stall.
+ */
+class MetricsServer
+{
+public:
+	static MetricsServer &get();
+
+	bool start(const char *path);
+	void stop();
+	bool is_enabled() const { return m_listen_fd >= 0; }
+
+	/* Creates and registers the counters of a new tab, nullptr when metrics are disabled */
+	std::shared_ptr<TabMetrics> add_tab(Terminal *term);
+
+private:
+	MetricsServer() = default;
+	void serve();
+	std::string collect();
+	static gboolean collect_gui_cb(void *data);
+	static std::string gui_metrics();
+
+	int m_listen_fd = -1;
+	std::string m_path;
+	std::thread m_thread;
+	std::mutex m_tabs_mutex;
+	std::vector<std::weak_ptr<TabMetrics>> m_tabs;
+	int m_next_tab_id = 1;
+	guint64 m_gui_stalls = 0;
+};
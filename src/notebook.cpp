@@ -7,11 +7,21 @@
 #include <gdk/gdk.h>
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
+#include "benchreport.h"
+#include "broadcast.h"
+#include "core/trace.h"
 #include "gettext.h"
+#include "isolation.h"
+#include "latency.h"
+#include "metrics.h"
 #include "terminal.h"
 #include "sakura.h"
+#include "watchdog.h"
 #include "window.h"
 #include "sakuraold.h"
+#include "recorder.h"
+#include "proctracker.h"
+#include "switcher.h"
 
 #define TAB_TITLE_CSS                                                                              \
 	"* {\n"                                                                                    \
@@ -27,6 +37,7 @@ SakuraNotebook::SakuraNotebook(const Config *cfg) : m_cfg(cfg)
 
 	signal_scroll_event().connect(sigc::mem_fun(*this, &SakuraNotebook::on_scroll_event));
 	signal_page_removed().connect(sigc::mem_fun(*this, &SakuraNotebook::on_page_removed_event));
+	signal_switch_page().connect(sigc::mem_fun(*this, &SakuraNotebook::on_switch_page_event));
 }
 
 SakuraNotebook::~SakuraNotebook()
@@ -77,6 +88,19 @@ void SakuraNotebook::on_page_removed_event(Gtk::Widget *, guint)
 	}
 }
 
+void SakuraNotebook::on_switch_page_event(Gtk::Widget *, guint page_num)
+{
+	/* Hints are only valid for the screen they were extracted from */
+	sakura->hints.stop();
+	/* The resize increments follow the cell size of the tab shown. The first page is switched
+	 * to before it has its Terminal */
+	auto term = get_tab_term(page_num);
+	if (term && term->zoom != sakura->geometry_zoom)
+		sakura->set_size();
+	/* Link matching only runs on the focused terminal */
+	sakura->disable_matching();
+}
+
 void SakuraNotebook::move_tab(gint direction)
 {
 	gint page = get_current_page();
@@ -142,16 +166,74 @@ static void sakura_beep(GtkWidget *w, void *data)
 	obj->beep(w);
 }
 
+/* OSC 7, a remote directory is shown with its host */
+static void tab_cwd_changed_cb(GtkWidget *vte, void *data)
+{
+	const char *uri = vte_terminal_get_current_directory_uri(VTE_TERMINAL(vte));
+	gchar *host = NULL;
+	gchar *path = uri ? g_filename_from_uri(uri, &host, NULL) : NULL;
+	if (!path)
+		return;
+
+	std::string cwd = path;
+	if (host && g_strcmp0(host, g_get_host_name()) != 0)
+		cwd = std::string(host) + ":" + cwd;
+	TabSwitcher::get().update((Terminal *)data, TabField::CWD, cwd);
+
+	g_free(host);
+	g_free(path);
+}
+
+/* Keys that usually start or stop a job: Enter, ^C, ^D and ^Z */
+static void tab_commit_cb(GtkWidget *vte, gchar *text, guint size, void *data)
+{
+	Broadcaster::get().input((Terminal *)data, text, size);
+
+	for (guint i = 0; i < size; i++) {
+		if (text[i] == '\r' || text[i] == 0x03 || text[i] == 0x04 || text[i] == 0x1a) {
+			ProcTracker::get().hint((Terminal *)data);
+			return;
+		}
+	}
+}
+
+/* Around the draw class handler of the vte */
+static gboolean trace_draw_begin(GtkWidget *widget, cairo_t *cr, void *data)
+{
+	TRACE_BEGIN(TRACE_DRAW, "draw");
+	return FALSE;
+}
+
+static gboolean trace_draw_end(GtkWidget *widget, cairo_t *cr, void *data)
+{
+	TRACE_END(TRACE_DRAW, "draw");
+	return FALSE;
+}
+
 void SakuraNotebook::add_tab()
 {
+	add_command_tab(nullptr);
+}
+
+void SakuraNotebook::add_command_tab(char **argv)
+{
+	TRACE_SPAN(TRACE_TABS, "add_tab");
+	WatchdogPhase phase("add_tab");
+
 	auto term = new Terminal();
-	auto tab_label_hbox = new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 2);
-	tab_label_hbox->set_hexpand(true);
-	tab_label_hbox->pack_start(term->label, true, false, 0);
+	Gtk::Box *tab_label_hbox = nullptr;
+	Gtk::Button *close_button = nullptr;
+
+	/* The TabBar has widgets for the tabs in view only, pages get none */
+	if (!m_cfg->virtual_tab_bar) {
+		tab_label_hbox = new Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 2);
+		tab_label_hbox->set_hexpand(true);
+		tab_label_hbox->pack_start(term->broadcast_icon, Gtk::PACK_SHRINK);
+		tab_label_hbox->pack_start(term->label, true, false, 0);
+	}
 
-	Gtk::Button *close_button;
 	/* If the tab close button is enabled, create and add it to the tab */
-	if (sakura->config.show_closebutton) {
+	if (tab_label_hbox && sakura->config.show_closebutton) {
 		close_button = new Gtk::Button();
 		/* Adding scroll-event to button, to propagate it to notebook (fix for scroll event
 		 * when pointer is above the button) */
@@ -168,13 +250,15 @@ void SakuraNotebook::add_tab()
 		set_tab_pos(Gtk::POS_BOTTOM);
 	}
 
-	/* Set tab title style */
-	sakura->provider->load_from_data(TAB_TITLE_CSS);
+	if (tab_label_hbox) {
+		/* Set tab title style */
+		sakura->provider->load_from_data(TAB_TITLE_CSS);
 
-	auto context = tab_label_hbox->get_style_context();
-	context->add_provider(sakura->provider, GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+		auto context = tab_label_hbox->get_style_context();
+		context->add_provider(sakura->provider, GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
 
-	tab_label_hbox->show_all();
+		tab_label_hbox->show_all();
+	}
 
 	gchar *cwd = NULL;
 	/* Select the directory to use for the new tab */
@@ -191,7 +275,8 @@ void SakuraNotebook::add_tab()
 	/* Keep values when adding tabs */
 	sakura->keep_fc = true;
 
-	if ((index = append_page(term->hbox, *tab_label_hbox)) == -1) {
+	index = tab_label_hbox ? append_page(term->hbox, *tab_label_hbox) : append_page(term->hbox);
+	if (index == -1) {
 		sakura_error("Cannot create a new tab");
 		exit(1);
 	}
@@ -206,9 +291,9 @@ void SakuraNotebook::add_tab()
 	/* vte signals */
 	g_signal_connect(G_OBJECT(term->vte), "bell", G_CALLBACK(sakura_beep), sakura);
 	g_signal_connect(G_OBJECT(term->vte), "increase-font-size",
-			G_CALLBACK(&Sakura::increase_font), NULL);
+			G_CALLBACK(&Sakura::zoom_in), term);
 	g_signal_connect(G_OBJECT(term->vte), "decrease-font-size",
-			G_CALLBACK(&Sakura::decrease_font), NULL);
+			G_CALLBACK(&Sakura::zoom_out), term);
 	g_signal_connect(G_OBJECT(term->vte), "child-exited", G_CALLBACK(sakura_child_exited),
 			sakura);
 	g_signal_connect(G_OBJECT(term->vte), "eof", G_CALLBACK(sakura_eof), sakura);
@@ -216,19 +301,35 @@ void SakuraNotebook::add_tab()
 			G_CALLBACK(sakura_title_changed), NULL);
 	g_signal_connect_swapped(G_OBJECT(term->vte), "button-press-event",
 			G_CALLBACK(sakura_button_press), sakura->menu->gobj());
+	g_signal_connect(G_OBJECT(term->vte), "motion-notify-event",
+			G_CALLBACK(sakura_motion_notify), term);
+	g_signal_connect(G_OBJECT(term->vte), "commit", G_CALLBACK(tab_commit_cb), term);
+	g_signal_connect(G_OBJECT(term->vte), "current-directory-uri-changed",
+			G_CALLBACK(tab_cwd_changed_cb), term);
+	TabSwitcher::get().update(term, TabField::LABEL, term->label_text);
+	LatencyProbe::get().watch(term->vte);
+	if constexpr (trace_enabled(TRACE_DRAW)) {
+		g_signal_connect(G_OBJECT(term->vte), "draw", G_CALLBACK(trace_draw_begin), NULL);
+		g_signal_connect_after(
+				G_OBJECT(term->vte), "draw", G_CALLBACK(trace_draw_end), NULL);
+	}
+	term->metrics = MetricsServer::get().add_tab(term);
 
 	/* Notebook signals */
-	if (sakura->config.show_closebutton) {
+	if (close_button) {
 		g_signal_connect(G_OBJECT(close_button->gobj()), "clicked",
 				G_CALLBACK(sakura_closebutton_clicked), term->hbox.gobj());
 	}
 
 	/* Since vte-2.91 env is properly overwritten */
 	char *command_env[2] = {const_cast<char *>("TERM=xterm-256color"), nullptr};
+	char **tab_argv = argv ? argv : sakura->argv;
+	auto tab_flags = (GSpawnFlags)(argv ? G_SPAWN_SEARCH_PATH
+					    : G_SPAWN_SEARCH_PATH | G_SPAWN_FILE_AND_ARGV_ZERO);
 	/* First tab */
 	int npages = get_n_pages();
 	if (npages == 1) {
-		set_show_tabs(sakura->config.first_tab);
+		set_tabs_visible(sakura->config.first_tab);
 		set_show_border(false);
 		sakura->set_font();
 		sakura->set_colors();
@@ -257,9 +358,24 @@ void SakuraNotebook::add_tab()
 		}
 #endif
 
+		BenchReport::get().watch_output(term->vte);
+
 		int command_argc = 0;
 		char **command_argv;
-		if (option_execute || option_xterm_execute) {
+		bool replaying = false;
+		if (option_replay) {
+			/* The recording takes the place of the child */
+			GError *gerror = NULL;
+			term->replay = new Replayer(term);
+			if (term->replay->start(option_replay, option_replay_fast, &gerror)) {
+				replaying = true;
+			} else {
+				sakura_error("%s", gerror->message);
+				g_error_free(gerror);
+				delete term->replay;
+				term->replay = nullptr;
+			}
+		} else if (option_execute || option_xterm_execute) {
 			GError *gerror = NULL;
 			gchar *path;
 
@@ -317,11 +433,8 @@ void SakuraNotebook::add_tab()
 			if (command_argc > 0) {
 				path = g_find_program_in_path(command_argv[0]);
 				if (path) {
-					vte_terminal_spawn_async(VTE_TERMINAL(term->vte),
-							VTE_PTY_NO_HELPER, NULL, command_argv,
-							command_env, G_SPAWN_SEARCH_PATH, NULL,
-							NULL, NULL, -1, NULL, sakura_spawn_callback,
-							term);
+					spawn(term, NULL, command_argv, command_env,
+							G_SPAWN_SEARCH_PATH);
 				} else {
 					sakura_error("%s command not found", command_argv[0]);
 					command_argc = 0;
@@ -334,16 +447,13 @@ void SakuraNotebook::add_tab()
 		} // else { /* No execute option */
 
 		/* Only fork if there is no execute option or if it has failed */
-		if ((!option_execute && !option_xterm_args) || (command_argc == 0)) {
+		if (!replaying &&
+				((!option_execute && !option_xterm_args) || (command_argc == 0))) {
 			if (option_hold == TRUE) {
 				sakura_error("Hold option given without any command");
 				option_hold = FALSE;
 			}
-			vte_terminal_spawn_async(VTE_TERMINAL(term->vte), VTE_PTY_NO_HELPER, cwd,
-					sakura->argv, command_env,
-					(GSpawnFlags)(G_SPAWN_SEARCH_PATH |
-							G_SPAWN_FILE_AND_ARGV_ZERO),
-					NULL, NULL, NULL, -1, NULL, sakura_spawn_callback, term);
+			spawn(term, cwd, tab_argv, command_env, tab_flags);
 		}
 		/* Not the first tab */
 	} else {
@@ -356,27 +466,20 @@ void SakuraNotebook::add_tab()
 		}
 
 		if (npages == 2) {
-			set_show_tabs(true);
+			set_tabs_visible(true);
 			sakura->set_size();
 		}
 		/* Call set_current page after showing the widget: gtk ignores this
 		 * function in the window is not visible *sigh*. Gtk documentation
 		 * says this is for "historical" reasons. Me arse */
 		set_current_page(index);
-		vte_terminal_spawn_async(VTE_TERMINAL(term->vte), VTE_PTY_NO_HELPER, cwd,
-				sakura->argv, command_env,
-				(GSpawnFlags)(G_SPAWN_SEARCH_PATH | G_SPAWN_FILE_AND_ARGV_ZERO),
-				NULL, NULL, NULL, -1, NULL, sakura_spawn_callback, term);
+		spawn(term, cwd, tab_argv, command_env, tab_flags);
 	}
 
 	free(cwd);
 
 	/* Init vte terminal */
 	vte_terminal_set_scrollback_lines(VTE_TERMINAL(term->vte), sakura->config.scroll_lines);
-	vte_terminal_match_add_regex(
-			VTE_TERMINAL(term->vte), sakura->http_vteregexp, PCRE2_CASELESS);
-	vte_terminal_match_add_regex(
-			VTE_TERMINAL(term->vte), sakura->mail_vteregexp, PCRE2_CASELESS);
 	vte_terminal_set_mouse_autohide(VTE_TERMINAL(term->vte), TRUE);
 	vte_terminal_set_backspace_binding(VTE_TERMINAL(term->vte), VTE_ERASE_ASCII_DELETE);
 	vte_terminal_set_word_char_exceptions(
@@ -397,6 +500,48 @@ void SakuraNotebook::add_tab()
 	sakura->keep_fc = false;
 }
 
+/* Spawn the child of a new tab, on a pty of our own when its output is recorded or scanned for
+ * shell integration marks */
+void SakuraNotebook::spawn(
+		Terminal *term, const char *cwd, char **argv, char **envv, GSpawnFlags flags)
+{
+	TRACE_SPAN(TRACE_CHILD, "spawn");
+	WatchdogPhase phase("spawn");
+
+	ChildIsolation *isolation = TabIsolation::get().prepare(term);
+	GSpawnChildSetupFunc child_setup = isolation ? TabIsolation::child_setup : NULL;
+	GDestroyNotify free_child_setup = isolation ? TabIsolation::free_child_setup : NULL;
+
+	if (option_record || sakura->config.shell_integration) {
+		/* The first tab is recorded to the given file, the next ones get a number */
+		gchar *path = NULL;
+		if (option_record) {
+			path = m_recordings == 0 ? g_strdup(option_record)
+					: g_strdup_printf("%s.%d", option_record, m_recordings);
+			m_recordings++;
+		}
+
+		term->proxy = new PtyProxy(term);
+		if (!path || term->proxy->record(path)) {
+			if (term->metrics)
+				term->metrics->proxied = true;
+			term->proxy->spawn(cwd, argv, envv, flags, child_setup, isolation,
+					free_child_setup);
+			g_free(path);
+			return;
+		}
+
+		sakura_error("Cannot write the recording to %s", path);
+		g_free(path);
+		delete term->proxy;
+		term->proxy = nullptr;
+	}
+
+	vte_terminal_spawn_async(VTE_TERMINAL(term->vte), VTE_PTY_NO_HELPER, cwd, argv, envv,
+			flags, child_setup, isolation, free_child_setup, -1, NULL,
+			sakura_spawn_callback, term);
+}
+
 void SakuraNotebook::close_tab()
 {
 	gint page = get_current_page();
@@ -408,11 +553,8 @@ void SakuraNotebook::close_tab()
 		sakura_config_done();
 	}
 
-	/* Check if there are running processes for this tab. Use tcgetpgrp to compare to the shell
-	 * PGID */
-	auto pgid = tcgetpgrp(vte_pty_get_fd(vte_terminal_get_pty(VTE_TERMINAL(term->vte))));
-
-	if ((pgid != -1) && (pgid != term->pid) && (!sakura->config.less_questions)) {
+	/* Check if there are running processes for this tab, as seen by the ProcTracker */
+	if (term->foreground.pgid != 0 && !sakura->config.less_questions) {
 		auto dialog = gtk_message_dialog_new(sakura->main_window->gobj(), GTK_DIALOG_MODAL,
 				GTK_MESSAGE_QUESTION, GTK_BUTTONS_YES_NO,
 				_("There is a running process in this terminal.\n\nDo you really "
@@ -449,10 +591,12 @@ void SakuraNotebook::del_tab(gint page, bool exit_if_needed)
 	/* Do the first tab checks BEFORE deleting the tab, to ensure correct
 	 * sizes are calculated when the tab is deleted */
 	if (npages == 2) {
-		set_show_tabs(sakura->config.first_tab);
+		set_tabs_visible(sakura->config.first_tab);
 		sakura->keep_fc = true;
 	}
 
+	sakura->hints.stop();
+	sakura->disable_matching();
 	term->hbox.hide();
 	remove_page(page);
 
@@ -468,6 +612,16 @@ void SakuraNotebook::del_tab(gint page, bool exit_if_needed)
 	}
 }
 
+void SakuraNotebook::set_tabs_visible(bool visible)
+{
+	if (m_cfg->virtual_tab_bar) {
+		set_show_tabs(false);
+		sakura->main_window->tab_bar.set_visible(visible);
+	} else {
+		set_show_tabs(visible);
+	}
+}
+
 Terminal *SakuraNotebook::get_tab_term(gint page_id)
 {
 	return (Terminal *)g_object_get_qdata(
@@ -13,8 +13,11 @@ public:
 
 	bool on_scroll_event(GdkEventScroll *scroll);
 	void on_page_removed_event(Gtk::Widget *, guint);
+	void on_switch_page_event(Gtk::Widget *, guint);
 
 	void add_tab();
+	/* A tab running argv instead of the shell */
+	void add_command_tab(char **argv);
 	gint find_tab(VteTerminal *term);
 	void move_tab(gint direction);
 	void close_tab();
@@ -23,7 +26,12 @@ public:
 	Terminal *get_tab_term(gint page_id);
 	Terminal *get_current_tab_term();
 	void show_scrollbar();
+	/* Of the notebook, or of the TabBar with virtual_tab_bar */
+	void set_tabs_visible(bool visible);
 
 private:
+	void spawn(Terminal *term, const char *cwd, char **argv, char **envv, GSpawnFlags flags);
+
 	const Config *m_cfg = nullptr;
+	int m_recordings = 0;
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "core/palette.h"
+
 #define PALETTE_SIZE 16
 
 /* 16 color palettes in GdkRGBA format (red, green, blue, alpha)
@@ -175,3 +177,23 @@ const GdkRGBA rxvt_palette[PALETTE_SIZE] = {
 	{0,        1,        1,        1 },
 	{1,        1,        1,        1 }
 };
+
+static inline const GdkRGBA *palette_colors(PaletteId palette)
+{
+	switch (palette) {
+	case PaletteId::LINUX:
+		return linux_palette;
+	case PaletteId::GRUVBOX:
+		return gruvbox_palette;
+	case PaletteId::XTERM:
+		return xterm_palette;
+	case PaletteId::RXVT:
+		return rxvt_palette;
+	case PaletteId::TANGO:
+		return tango_palette;
+	case PaletteId::SOLARIZED_DARK:
+		return solarized_dark_palette;
+	default:
+		return solarized_light_palette;
+	}
+}
@@ -0,0 +1,207 @@
+#include "paste.h"
+#include <cstring>
+#include <vte/vte.h>
+#include "core/trace.h"
+#include "gettext.h"
+#include "recorder.h"
+#include "sakura.h"
+#include "sakuraold.h"
+#include "terminal.h"
+
+/* Small enough for VTE to parse and draw its echo within a frame */
+#define PASTE_CHUNK_SIZE 16384
+/* With a rate limit, chunks are cut so that one goes out every PASTE_RATE_SLICE_MS */
+#define PASTE_RATE_SLICE_MS 50
+
+/* The clipboard can answer after the tab is gone, so the request holds a weak reference */
+struct PasteRequest {
+	std::weak_ptr<PasteJob> job;
+};
+
+PasteJob::PasteJob(Terminal *term) : m_term(term)
+{
+	g_object_ref(m_term->vte);
+}
+
+PasteJob::~PasteJob()
+{
+	finish();
+	g_object_unref(m_term->vte);
+}
+
+void PasteJob::start()
+{
+	if (is_running())
+		return;
+
+#if VTE_CHECK_VERSION(0, 68, 0)
+	m_requested = true;
+	GtkClipboard *clipboard = gtk_widget_get_clipboard(m_term->vte, GDK_SELECTION_CLIPBOARD);
+	gtk_clipboard_request_text(clipboard, PasteJob::text_received_cb,
+			new PasteRequest{m_term->paste_job});
+#else
+	/* No way to paste a chunk the way VTE pastes, it pastes it all at once */
+	vte_terminal_paste_clipboard(VTE_TERMINAL(m_term->vte));
+#endif
+}
+
+void PasteJob::text_received_cb(GtkClipboard *clipboard, const gchar *text, gpointer data)
+{
+	auto request = (PasteRequest *)data;
+	auto obj = request->job.lock();
+	delete request;
+
+	if (!obj || !obj->m_requested)
+		return;
+
+	obj->m_requested = false;
+	if (!text || !*text)
+		return;
+
+	TRACE_MSG("Pasting %zu bytes", strlen(text));
+	obj->m_text = text;
+	obj->m_sent = 0;
+	obj->m_start = g_get_monotonic_time();
+	if (obj->m_text.size() > PASTE_CHUNK_SIZE) {
+		obj->m_draw_callback_id = g_signal_connect_after(
+				obj->m_term->vte, "draw", G_CALLBACK(PasteJob::draw_cb), obj.get());
+	}
+	obj->send();
+}
+
+void PasteJob::cancel()
+{
+	if (!is_running())
+		return;
+
+	TRACE_MSG("Paste cancelled after %zu of %zu bytes", m_sent, m_text.size());
+	finish();
+}
+
+void PasteJob::finish()
+{
+	m_requested = false;
+	m_text.clear();
+	m_sent = 0;
+
+	if (m_write_source) {
+		g_source_remove(m_write_source);
+		m_write_source = 0;
+	}
+	if (m_resume_source) {
+		g_source_remove(m_resume_source);
+		m_resume_source = 0;
+	}
+	if (m_draw_callback_id) {
+		g_signal_handler_disconnect(m_term->vte, m_draw_callback_id);
+		m_draw_callback_id = 0;
+		m_drawn_permille = -1;
+		gtk_widget_queue_draw(m_term->vte);
+	}
+}
+
+/* Sends the next chunk, then waits for the pty or for the rate limit */
+void PasteJob::send()
+{
+	size_t size = PASTE_CHUNK_SIZE;
+	int rate = sakura->config.paste_rate_limit;
+	if (rate > 0)
+		size = CLAMP((size_t)rate * PASTE_RATE_SLICE_MS / 1000, 1, PASTE_CHUNK_SIZE);
+
+	size_t end = MIN(m_sent + size, m_text.size());
+	/* Never cut a UTF-8 character or a CRLF, VTE would paste a newline for both halves */
+	while (end < m_text.size() && end > m_sent + 1 &&
+			(((m_text[end] & 0xc0) == 0x80) ||
+					(m_text[end] == '\n' && m_text[end - 1] == '\r')))
+		end--;
+
+#if VTE_CHECK_VERSION(0, 68, 0)
+	/* start() only gets here with it */
+	std::string chunk = m_text.substr(m_sent, end - m_sent);
+	vte_terminal_paste_text(VTE_TERMINAL(m_term->vte), chunk.c_str());
+#endif
+	m_sent = end;
+
+	if (m_draw_callback_id && m_sent * 1000 / m_text.size() != (size_t)m_drawn_permille)
+		gtk_widget_queue_draw(m_term->vte);
+
+	if (m_sent >= m_text.size()) {
+		TRACE_MSG("Pasted %zu bytes in %" G_GINT64_FORMAT " ms", m_text.size(),
+				(g_get_monotonic_time() - m_start) / 1000);
+		finish();
+		return;
+	}
+
+	if (rate > 0) {
+		gint64 due = m_start + (gint64)(m_sent * G_USEC_PER_SEC / rate);
+		gint64 delay = due - g_get_monotonic_time();
+		if (delay > 0) {
+			m_resume_source =
+					g_timeout_add(delay / 1000 + 1, PasteJob::resume_cb, this);
+			return;
+		}
+	}
+
+	wait_for_pty();
+}
+
+void PasteJob::wait_for_pty()
+{
+	if (m_write_source)
+		return;
+
+	int fd = m_term->get_pty_fd();
+	if (fd < 0) {
+		finish();
+		return;
+	}
+
+	/* Below the priority of VTE's own writes, parsing and drawing */
+	m_write_source = g_unix_fd_add_full(
+			G_PRIORITY_LOW, fd, G_IO_OUT, PasteJob::write_cb, this, NULL);
+}
+
+gboolean PasteJob::write_cb(gint fd, GIOCondition condition, gpointer data)
+{
+	auto obj = (PasteJob *)data;
+
+	/* The proxy writes input from a watch of its own, what it holds is not in the pty yet */
+	if (obj->m_term->proxy && obj->m_term->proxy->has_pending_input())
+		return G_SOURCE_CONTINUE;
+
+	obj->m_write_source = 0;
+	obj->send();
+	return G_SOURCE_REMOVE;
+}
+
+gboolean PasteJob::resume_cb(gpointer data)
+{
+	auto obj = (PasteJob *)data;
+
+	obj->m_resume_source = 0;
+	obj->wait_for_pty();
+	return G_SOURCE_REMOVE;
+}
+
+gboolean PasteJob::draw_cb(GtkWidget *widget, cairo_t *cr, void *data)
+{
+	auto obj = (PasteJob *)data;
+	obj->draw(widget, cr);
+	return FALSE;
+}
+
+void PasteJob::draw(GtkWidget *widget, cairo_t *cr)
+{
+	if (m_text.empty())
+		return;
+
+	m_drawn_permille = m_sent * 1000 / m_text.size();
+
+	gchar *sent = g_format_size(m_sent);
+	gchar *total = g_format_size(m_text.size());
+	gchar *text = g_strdup_printf(_("Pasting %s of %s, Escape cancels"), sent, total);
+	m_term->draw_progress(cr, (double)m_sent / m_text.size(), text);
+	g_free(text);
+	g_free(total);
+	g_free(sent);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <gtk/gtk.h>
+
+class Terminal;
+
+/**
+ * Pastes the clipboard into a tab in chunks, so pasting a huge log or dump neither blocks the
+ * GUI thread nor floods the child. The text is requested asynchronously, then every chunk is
+ * sent once the pty has room for more: the next one goes out from a low priority G_IO_OUT
+ * watch of the pty, which only runs after VTE (or the PtyProxy) has written what it queued and
+ * after the terminal has parsed and drawn the echoed output.
+ *
+ * Chunks go through vte_terminal_paste_text, so VTE still converts newlines and brackets them
+ * when the child asked for bracketed paste. Every chunk is bracketed on its own, VTE does not
+ * expose the mode for us to bracket the whole text. A progress bar is drawn over the terminal
+ * for the pastes longer than one chunk, and Escape cancels them. paste_rate_limit caps the bytes
+ * sent per second, for remote sides that lose input.
+ */
+class PasteJob
+{
+public:
+	PasteJob(Terminal *term);
+	~PasteJob();
+
+	/* Pastes the CLIPBOARD selection, unless a paste is already running */
+	void start();
+	void cancel();
+	bool is_running() const { return m_requested || m_sent < m_text.size(); }
+
+private:
+	static void text_received_cb(GtkClipboard *clipboard, const gchar *text, gpointer data);
+	static gboolean write_cb(gint fd, GIOCondition condition, gpointer data);
+	static gboolean resume_cb(gpointer data);
+	static gboolean draw_cb(GtkWidget *widget, cairo_t *cr, void *data);
+	void send();
+	void wait_for_pty();
+	void finish();
+	void draw(GtkWidget *widget, cairo_t *cr);
+
+	Terminal *m_term;
+	bool m_requested = false; /* Waiting for the clipboard */
+	std::string m_text;
+	size_t m_sent = 0;
+	gint64 m_start = 0;
+	guint m_write_source = 0;
+	guint m_resume_source = 0;
+	gulong m_draw_callback_id = 0;
+	int m_drawn_permille = -1;
+};
@@ -0,0 +1,283 @@
+#include "proctracker.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vte/vte.h>
+#include "switcher.h"
+#include "terminal.h"
+
+/* Checks with no event, for jobs started without typing, e.g. by a script */
+#define PROCTRACKER_FALLBACK_US 3000000
+/* A hint comes with the key that starts the job, before the shell forks it */
+#define PROCTRACKER_HINT_DELAY_US 50000
+#define PROCTRACKER_EXIT_DELAY_US 20000
+
+struct TrackedProcess {
+	Terminal *term; /* GUI thread only, nullptr once the tab is removed */
+	int pty_fd;     /* Our own copy, VTE closes its pty before the tracker knows */
+	pid_t shell_pid;
+	int shell_pidfd = -1;
+	int job_pidfd = -1;
+	bool removed = false;
+	gint64 check_at = 0; /* Next check, 0 to wait for the fallback */
+	gint64 last_check = 0;
+	ForegroundJob job; /* As last seen by the tracker thread */
+	std::string cwd;   /* Of the shell, for the quick switcher */
+};
+
+/* A foreground job change on its way to the GUI thread */
+struct TrackerUpdate {
+	std::shared_ptr<TrackedProcess> tracked;
+	ForegroundJob job;
+	std::string cwd;
+};
+
+static int open_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+	return syscall(SYS_pidfd_open, pid, 0);
+#else
+	/* No pidfds, the fallback checks notice the exits */
+	return -1;
+#endif
+}
+
+static void close_tracked(TrackedProcess &tracked)
+{
+	close(tracked.pty_fd);
+	if (tracked.shell_pidfd >= 0)
+		close(tracked.shell_pidfd);
+	if (tracked.job_pidfd >= 0)
+		close(tracked.job_pidfd);
+}
+
+static gint64 next_check(const TrackedProcess &tracked)
+{
+	return tracked.check_at ? tracked.check_at : tracked.last_check + PROCTRACKER_FALLBACK_US;
+}
+
+ProcTracker &ProcTracker::get()
+{
+	static ProcTracker tracker;
+	return tracker;
+}
+
+void ProcTracker::add(Terminal *term)
+{
+	int pty_fd = term->get_pty_fd();
+	if (pty_fd < 0 || term->pid <= 0)
+		return;
+
+	auto tracked = std::make_shared<TrackedProcess>();
+	tracked->term = term;
+	tracked->pty_fd = fcntl(pty_fd, F_DUPFD_CLOEXEC, 0);
+	tracked->shell_pid = term->pid;
+	tracked->shell_pidfd = open_pidfd(term->pid);
+	tracked->check_at = g_get_monotonic_time();
+	if (tracked->pty_fd < 0) {
+		close_tracked(*tracked);
+		return;
+	}
+	term->tracked = tracked;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_running) {
+			m_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+			m_running = true;
+			m_thread = std::thread(&ProcTracker::run, this);
+		}
+		m_tabs.push_back(tracked);
+	}
+	wake();
+}
+
+void ProcTracker::remove(Terminal *term)
+{
+	if (!term->tracked)
+		return;
+
+	term->tracked->term = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		term->tracked->removed = true;
+	}
+	term->tracked.reset();
+	wake();
+}
+
+void ProcTracker::hint(Terminal *term)
+{
+	if (!term->tracked)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		gint64 at = g_get_monotonic_time() + PROCTRACKER_HINT_DELAY_US;
+		if (!term->tracked->check_at || at < term->tracked->check_at)
+			term->tracked->check_at = at;
+	}
+	wake();
+}
+
+void ProcTracker::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_running)
+			return;
+		m_running = false;
+	}
+	wake();
+	m_thread.join();
+	close(m_wake_fd);
+	m_wake_fd = -1;
+}
+
+void ProcTracker::wake()
+{
+	uint64_t one = 1;
+	if (m_wake_fd >= 0 && write(m_wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		perror("eventfd");
+}
+
+void ProcTracker::run()
+{
+	std::vector<struct pollfd> fds;
+	std::vector<std::shared_ptr<TrackedProcess>> owners;
+	std::vector<std::shared_ptr<TrackedProcess>> due;
+
+	while (true) {
+		gint64 now = g_get_monotonic_time();
+		gint64 next = now + PROCTRACKER_FALLBACK_US;
+		fds.assign(1, {m_wake_fd, POLLIN, 0});
+		owners.assign(1, nullptr);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_running)
+				break;
+
+			for (auto it = m_tabs.begin(); it != m_tabs.end();) {
+				auto &tracked = *it;
+				if (tracked->removed) {
+					close_tracked(*tracked);
+					it = m_tabs.erase(it);
+					continue;
+				}
+
+				next = std::min(next, next_check(*tracked));
+				if (tracked->shell_pidfd >= 0) {
+					fds.push_back({tracked->shell_pidfd, POLLIN, 0});
+					owners.push_back(tracked);
+				}
+				if (tracked->job_pidfd >= 0) {
+					fds.push_back({tracked->job_pidfd, POLLIN, 0});
+					owners.push_back(tracked);
+				}
+				++it;
+			}
+		}
+
+		int timeout = (std::max<gint64>(next - now, 0) + 999) / 1000;
+		if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR)
+			perror("poll");
+
+		uint64_t wakes;
+		if (fds[0].revents && read(m_wake_fd, &wakes, sizeof(wakes)) < 0 && errno != EAGAIN)
+			perror("eventfd");
+
+		now = g_get_monotonic_time();
+		due.clear();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			/* A pidfd stays readable after the exit, it is not polled again */
+			for (size_t i = 1; i < fds.size(); i++) {
+				if (!fds[i].revents)
+					continue;
+				auto &tracked = owners[i];
+				bool shell = fds[i].fd == tracked->shell_pidfd;
+				int &pidfd = shell ? tracked->shell_pidfd : tracked->job_pidfd;
+				close(pidfd);
+				pidfd = -1;
+				/* The shell takes the terminal back once it has reaped the job */
+				tracked->check_at = now + PROCTRACKER_EXIT_DELAY_US;
+			}
+
+			for (const auto &tracked : m_tabs) {
+				if (tracked->removed)
+					continue;
+				if (next_check(*tracked) <= now) {
+					tracked->check_at = 0;
+					tracked->last_check = now;
+					due.push_back(tracked);
+				}
+			}
+		}
+
+		/* Descriptors are only closed by this thread, so they are used without the lock */
+		for (const auto &tracked : due)
+			check(tracked);
+	}
+
+	for (const auto &tracked : m_tabs)
+		close_tracked(*tracked);
+	m_tabs.clear();
+}
+
+void ProcTracker::check(const std::shared_ptr<TrackedProcess> &tracked)
+{
+	ForegroundJob job;
+	pid_t pgid = tcgetpgrp(tracked->pty_fd);
+	if (pgid > 0 && pgid != tracked->shell_pid) {
+		job.pgid = pgid;
+		std::ifstream comm("/proc/" + std::to_string(pgid) + "/comm");
+		std::getline(comm, job.name);
+	}
+
+	/* Checks come with Enter, so a cd is seen as soon as a job start would be */
+	char cwd[PATH_MAX];
+	std::string link = "/proc/" + std::to_string(tracked->shell_pid) + "/cwd";
+	ssize_t size = readlink(link.c_str(), cwd, sizeof(cwd));
+	std::string shell_cwd = size > 0 ? std::string(cwd, size) : tracked->cwd;
+
+	if (job == tracked->job && shell_cwd == tracked->cwd)
+		return;
+
+	if (job.pgid != tracked->job.pgid) {
+		if (tracked->job_pidfd >= 0)
+			close(tracked->job_pidfd);
+		tracked->job_pidfd = job.pgid ? open_pidfd(job.pgid) : -1;
+	}
+	tracked->job = job;
+	tracked->cwd = shell_cwd;
+
+	g_main_context_invoke(
+			NULL, ProcTracker::update_cb, new TrackerUpdate{tracked, job, shell_cwd});
+}
+
+/* Runs in the GUI thread */
+gboolean ProcTracker::update_cb(void *data)
+{
+	auto update = (TrackerUpdate *)data;
+	Terminal *term = update->tracked->term;
+
+	if (term) {
+		term->foreground = update->job;
+		term->update_tooltip();
+		TabSwitcher::get().update(term, TabField::COMMAND, update->job.name);
+		/* Shells that send OSC 7 keep it up to date themselves, even over ssh */
+		if (!vte_terminal_get_current_directory_uri(VTE_TERMINAL(term->vte)))
+			TabSwitcher::get().update(term, TabField::CWD, update->cwd);
+	}
+
+	delete update;
+	return G_SOURCE_REMOVE;
+}
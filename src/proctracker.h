@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include <glib.h>
+
+class Terminal;
+
+/* Process group in the foreground of a tab's pty, other than its shell */
+struct ForegroundJob {
+	pid_t pgid = 0; /* 0 when the shell itself is in the foreground */
+	std::string name;
+
+	bool operator==(const ForegroundJob &other) const
+	{
+		return pgid == other.pgid && name == other.name;
+	}
+	bool operator!=(const ForegroundJob &other) const { return !(*this == other); }
+};
+
+struct TrackedProcess;
+
+/**
+ * Keeps Terminal::foreground up to date from a thread of its own, so the GUI thread reads it
+ * with no syscalls (close confirmations, tab tooltips). The working directory of the shell is
+ * read at every check too, for the quick switcher.
+ *
+ * The kernel has no notification for foreground group changes of a pty that an unprivileged
+ * process can use, so the thread checks a tab with tcgetpgrp when something suggests a change:
+ * Enter, ^C, ^D or ^Z typed in it (hint()), the exit of its foreground job or its shell,
+ * watched with pidfds, and otherwise every few seconds.
+ */
+class ProcTracker
+{
+public:
+	static ProcTracker &get();
+
+	/* Starts tracking the tab, once its child is spawned */
+	void add(Terminal *term);
+	void remove(Terminal *term);
+	/* Something was typed that can start or stop a job */
+	void hint(Terminal *term);
+	void stop();
+
+private:
+	ProcTracker() = default;
+	void wake();
+	void run();
+	void check(const std::shared_ptr<TrackedProcess> &tracked);
+	static gboolean update_cb(void *data);
+
+	std::thread m_thread;
+	int m_wake_fd = -1;
+	bool m_running = false;
+	std::mutex m_mutex; /* Guards m_tabs and the scheduling fields of its entries */
+	std::vector<std::shared_ptr<TrackedProcess>> m_tabs;
+};
@@ -0,0 +1,406 @@
+#include "recorder.h"
+#include <cerrno>
+#include <glib-unix.h>
+#include <unistd.h>
+#include "benchreport.h"
+#include "core/trace.h"
+#include "metrics.h"
+#include "sakuraold.h"
+#include "terminal.h"
+
+#define READ_BUFFER_SIZE 65536
+/* How much of a recording is fed per main loop iteration with --replay-fast, so the terminal
+ * still gets the chance to draw in between like it would reading a busy pty */
+#define REPLAY_FAST_CHUNK (256 * 1024)
+/* How long a mark waits for VTE to parse the output before it, for output that changes
+ * nothing VTE tells about */
+#define SHELL_MARK_TIMEOUT_MS 20
+
+static void reap_cb(GPid pid, gint status, gpointer data)
+{
+	g_spawn_close_pid(pid);
+}
+
+PtyProxy::PtyProxy(Terminal *term) : m_term(term), m_scan_marks(sakura->config.shell_integration)
+{
+	g_object_ref(m_term->vte);
+}
+
+PtyProxy::~PtyProxy()
+{
+	if (m_commit_callback_id)
+		g_signal_handler_disconnect(m_term->vte, m_commit_callback_id);
+	if (m_size_callback_id)
+		g_signal_handler_disconnect(m_term->vte, m_size_callback_id);
+	if (m_contents_callback_id)
+		g_signal_handler_disconnect(m_term->vte, m_contents_callback_id);
+	g_object_unref(m_term->vte);
+
+	if (m_read_source)
+		g_source_remove(m_read_source);
+	if (m_write_source)
+		g_source_remove(m_write_source);
+	if (m_mark_source)
+		g_source_remove(m_mark_source);
+
+	if (m_child_source) {
+		/* The child gets SIGHUP when the pty is closed below, reap it when it exits */
+		g_source_remove(m_child_source);
+		g_child_watch_add(m_term->pid, reap_cb, nullptr);
+	}
+
+	if (m_cancellable) {
+		g_object_set_data(G_OBJECT(m_cancellable), "proxy", nullptr);
+		g_cancellable_cancel(m_cancellable);
+		g_object_unref(m_cancellable);
+	}
+
+	if (m_pty)
+		g_object_unref(m_pty);
+}
+
+bool PtyProxy::record(const char *path)
+{
+	return m_writer.open(path, vte_terminal_get_column_count(VTE_TERMINAL(m_term->vte)),
+			vte_terminal_get_row_count(VTE_TERMINAL(m_term->vte)));
+}
+
+void PtyProxy::spawn(const char *cwd, char **argv, char **envv, GSpawnFlags flags,
+		GSpawnChildSetupFunc child_setup, gpointer child_setup_data,
+		GDestroyNotify child_setup_data_destroy)
+{
+	GError *error = NULL;
+
+	m_pty = vte_pty_new_sync(VTE_PTY_NO_HELPER, NULL, &error);
+	if (!m_pty) {
+		if (child_setup_data_destroy)
+			child_setup_data_destroy(child_setup_data);
+		sakura_spawn_callback(VTE_TERMINAL(m_term->vte), -1, error, m_term);
+		g_error_free(error);
+		return;
+	}
+
+	int fd = vte_pty_get_fd(m_pty);
+	g_unix_set_fd_nonblocking(fd, TRUE, NULL);
+
+	m_columns = vte_terminal_get_column_count(VTE_TERMINAL(m_term->vte));
+	m_rows = vte_terminal_get_row_count(VTE_TERMINAL(m_term->vte));
+	vte_pty_set_size(m_pty, m_rows, m_columns, NULL);
+
+	m_commit_callback_id = g_signal_connect(
+			G_OBJECT(m_term->vte), "commit", G_CALLBACK(PtyProxy::commit_cb), this);
+	m_size_callback_id = g_signal_connect_after(G_OBJECT(m_term->vte), "size-allocate",
+			G_CALLBACK(PtyProxy::size_allocate_cb), this);
+	if (m_scan_marks) {
+		m_contents_callback_id = g_signal_connect(G_OBJECT(m_term->vte), "contents-changed",
+				G_CALLBACK(PtyProxy::contents_changed_cb), this);
+	}
+	start_reading();
+
+	/* The proxy can be deleted before the spawn finishes, so the callback finds it through
+	 * the cancellable, which holds a reference of its own */
+	m_cancellable = g_cancellable_new();
+	g_object_set_data(G_OBJECT(m_cancellable), "proxy", this);
+	vte_pty_spawn_async(m_pty, cwd, argv, envv,
+			(GSpawnFlags)(flags | G_SPAWN_DO_NOT_REAP_CHILD), child_setup,
+			child_setup_data, child_setup_data_destroy, -1,
+			m_cancellable, PtyProxy::spawn_cb, g_object_ref(m_cancellable));
+}
+
+void PtyProxy::spawn_cb(GObject *source, GAsyncResult *result, gpointer data)
+{
+	auto cancellable = (GCancellable *)data;
+	auto obj = (PtyProxy *)g_object_get_data(G_OBJECT(cancellable), "proxy");
+	GError *error = NULL;
+	GPid pid;
+
+	if (!vte_pty_spawn_finish(VTE_PTY(source), result, &pid, &error)) {
+		if (obj) {
+			sakura_spawn_callback(VTE_TERMINAL(obj->m_term->vte), -1, error, obj->m_term);
+		}
+		g_error_free(error);
+	} else if (obj) {
+		sakura_spawn_callback(VTE_TERMINAL(obj->m_term->vte), pid, NULL, obj->m_term);
+		obj->m_child_source = g_child_watch_add(pid, PtyProxy::child_exited_cb, obj);
+	} else {
+		g_child_watch_add(pid, reap_cb, nullptr);
+	}
+
+	g_object_unref(cancellable);
+}
+
+/* Returns the number of bytes read, 0 if there was nothing to read and -1 once the pty is
+ * closed */
+int PtyProxy::read_output()
+{
+	char buf[READ_BUFFER_SIZE];
+
+	ssize_t n = read(vte_pty_get_fd(m_pty), buf, sizeof(buf));
+	if (n > 0) {
+		m_writer.output(buf, n);
+		feed(buf, n);
+		if (m_term->metrics)
+			m_term->metrics->bytes_read.fetch_add(n, std::memory_order_relaxed);
+		return n;
+	}
+
+	if (n < 0 && (errno == EAGAIN || errno == EINTR))
+		return 0;
+
+	return -1;
+}
+
+gboolean PtyProxy::read_cb(gint fd, GIOCondition condition, gpointer data)
+{
+	auto obj = (PtyProxy *)data;
+
+	/* Reading goes on once the mark found is added */
+	if (obj->read_output() < 0 || obj->m_mark.type != ShellMarkType::NONE) {
+		obj->m_read_source = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+void PtyProxy::start_reading()
+{
+	m_read_source = g_unix_fd_add(vte_pty_get_fd(m_pty),
+			(GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR), PtyProxy::read_cb, this);
+}
+
+void PtyProxy::feed(const char *data, size_t size)
+{
+	VteTerminal *vte = VTE_TERMINAL(m_term->vte);
+
+	if (!m_scan_marks) {
+		vte_terminal_feed(vte, data, size);
+		return;
+	}
+
+	while (size > 0) {
+		if (m_mark.type != ShellMarkType::NONE) {
+			m_held.append(data, size);
+			return;
+		}
+
+		ShellMark mark;
+		size_t scanned = m_scanner.scan(data, size, mark);
+		size_t before = mark.type != ShellMarkType::NONE ? mark.offset : scanned;
+		if (before > 0) {
+			vte_terminal_feed(vte, data, before);
+			m_unparsed = true;
+		}
+		/* The mark itself moves nothing */
+		if (scanned > before)
+			vte_terminal_feed(vte, data + before, scanned - before);
+		data += scanned;
+		size -= scanned;
+
+		if (mark.type == ShellMarkType::NONE)
+			continue;
+
+		m_mark = mark;
+		m_mark_time = g_get_monotonic_time();
+		if (!m_unparsed || m_exited)
+			add_mark();
+		else
+			m_mark_source = g_timeout_add(
+					SHELL_MARK_TIMEOUT_MS, PtyProxy::mark_timeout_cb, this);
+	}
+}
+
+/* Adds m_mark at the cursor row, which VTE has reached, and lets the output go on */
+void PtyProxy::add_mark()
+{
+	glong column, row;
+	vte_terminal_get_cursor_position(VTE_TERMINAL(m_term->vte), &column, &row);
+	if (m_term->shell_index.add(m_mark, row, m_mark_time))
+		m_term->update_tooltip();
+	m_mark.type = ShellMarkType::NONE;
+
+	if (m_mark_source) {
+		g_source_remove(m_mark_source);
+		m_mark_source = 0;
+	}
+
+	if (!m_held.empty()) {
+		std::string held;
+		held.swap(m_held);
+		feed(held.data(), held.size());
+	}
+
+	if (m_mark.type == ShellMarkType::NONE && !m_read_source)
+		start_reading();
+}
+
+/* Emitted once VTE has parsed what it was fed */
+void PtyProxy::contents_changed_cb(VteTerminal *vte, gpointer data)
+{
+	auto obj = (PtyProxy *)data;
+
+	obj->m_unparsed = false;
+	if (obj->m_mark.type != ShellMarkType::NONE)
+		obj->add_mark();
+}
+
+gboolean PtyProxy::mark_timeout_cb(gpointer data)
+{
+	auto obj = (PtyProxy *)data;
+
+	obj->m_mark_source = 0;
+	obj->m_unparsed = false;
+	obj->add_mark();
+	return G_SOURCE_REMOVE;
+}
+
+void PtyProxy::write_input()
+{
+	int fd = vte_pty_get_fd(m_pty);
+
+	while (!m_input.empty()) {
+		ssize_t n = write(fd, m_input.data(), m_input.size());
+		if (n > 0) {
+			m_input.erase(0, n);
+		} else if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+			break;
+		} else {
+			m_input.clear();
+		}
+	}
+
+	/* Large pastes do not fit in the pty buffer, send the rest when the child reads */
+	if (!m_input.empty() && !m_write_source) {
+		m_write_source = g_unix_fd_add(fd, G_IO_OUT, PtyProxy::write_cb, this);
+	}
+}
+
+gboolean PtyProxy::write_cb(gint fd, GIOCondition condition, gpointer data)
+{
+	auto obj = (PtyProxy *)data;
+
+	obj->write_input();
+	if (obj->m_input.empty()) {
+		obj->m_write_source = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+void PtyProxy::commit_cb(VteTerminal *vte, gchar *text, guint size, gpointer data)
+{
+	auto obj = (PtyProxy *)data;
+
+	obj->m_input.append(text, size);
+	if (!obj->m_write_source)
+		obj->write_input();
+}
+
+/* Keep the pty window size in sync with the terminal, VTE only does it for its own pty */
+void PtyProxy::size_allocate_cb(GtkWidget *widget, GdkRectangle *allocation, gpointer data)
+{
+	auto obj = (PtyProxy *)data;
+	glong columns = vte_terminal_get_column_count(VTE_TERMINAL(widget));
+	glong rows = vte_terminal_get_row_count(VTE_TERMINAL(widget));
+
+	if (columns != obj->m_columns || rows != obj->m_rows) {
+		obj->m_columns = columns;
+		obj->m_rows = rows;
+		vte_pty_set_size(obj->m_pty, rows, columns, NULL);
+		obj->m_writer.resize(columns, rows);
+	}
+}
+
+void PtyProxy::child_exited_cb(GPid pid, gint status, gpointer data)
+{
+	auto obj = (PtyProxy *)data;
+	obj->m_child_source = 0;
+
+	/* Output written just before exiting may still be in the pty */
+	obj->m_exited = true;
+	if (obj->m_mark.type != ShellMarkType::NONE)
+		obj->add_mark();
+	if (obj->m_read_source) {
+		while (obj->read_output() > 0)
+			;
+	}
+	obj->m_writer.close();
+
+	/* This deletes the tab, and us with it */
+	sakura_child_exited(obj->m_term->vte, sakura);
+}
+
+Replayer::Replayer(Terminal *term) : m_term(term)
+{
+}
+
+Replayer::~Replayer()
+{
+	if (m_source)
+		g_source_remove(m_source);
+}
+
+bool Replayer::start(const char *path, bool fast, GError **error)
+{
+	if (!m_reader.open(path, error))
+		return false;
+
+	m_fast = fast;
+	m_start = g_get_monotonic_time();
+	if (!m_reader.next(m_next_time, m_next))
+		m_next = nullptr;
+
+	schedule();
+	return true;
+}
+
+void Replayer::schedule()
+{
+	if (m_fast) {
+		m_source = g_idle_add(Replayer::feed_cb, this);
+	} else {
+		gint64 due = m_start + (gint64)(m_next_time * G_USEC_PER_SEC);
+		gint64 delay = MAX(due - g_get_monotonic_time(), 0);
+		m_source = g_timeout_add(delay / 1000, Replayer::feed_cb, this);
+	}
+}
+
+gboolean Replayer::feed_cb(gpointer data)
+{
+	auto obj = (Replayer *)data;
+
+	obj->m_source = 0;
+	obj->feed();
+	return G_SOURCE_REMOVE;
+}
+
+void Replayer::feed()
+{
+	gint64 now = g_get_monotonic_time();
+	size_t fed = 0;
+
+	while (m_next) {
+		if (m_fast ? fed >= REPLAY_FAST_CHUNK
+			   : m_start + (gint64)(m_next_time * G_USEC_PER_SEC) > now) {
+			break;
+		}
+
+		vte_terminal_feed(VTE_TERMINAL(m_term->vte), m_next->data(), m_next->size());
+		fed += m_next->size();
+
+		if (!m_reader.next(m_next_time, m_next))
+			m_next = nullptr;
+	}
+
+	if (m_next) {
+		schedule();
+		return;
+	}
+
+	TRACE_MSG("Replay finished");
+	BenchReport::get().set("replay_us", g_get_monotonic_time() - m_start);
+
+	/* Like the end of the child: the tab is closed unless --hold was given. This deletes us */
+	sakura_child_exited(m_term->vte, sakura);
+}
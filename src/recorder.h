@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <vte/vte.h>
+#include "asciicast.h"
+#include "core/shellmarks.h"
+
+class Terminal;
+
+/**
+ * Runs the child on a pty owned by sakura instead of VTE, so its output can be recorded before
+ * it is fed to the terminal. Keyboard input reaches the child through the "commit" signal.
+ *
+ * With shell_integration the output is scanned for OSC 133 marks, which go to the shell index
+ * of the tab with the cursor row they were found at. VTE parses what it is fed later, from the
+ * main loop, so the output after a mark is held back until VTE has caught up with it.
+ */
+class PtyProxy
+{
+public:
+	PtyProxy(Terminal *term);
+	~PtyProxy();
+
+	bool record(const char *path);
+	void spawn(const char *cwd, char **argv, char **envv, GSpawnFlags flags,
+			GSpawnChildSetupFunc child_setup, gpointer child_setup_data,
+			GDestroyNotify child_setup_data_destroy);
+
+	VtePty *get_pty() const { return m_pty; }
+	bool has_pending_input() const { return !m_input.empty(); }
+
+private:
+	static void spawn_cb(GObject *source, GAsyncResult *result, gpointer data);
+	static gboolean read_cb(gint fd, GIOCondition condition, gpointer data);
+	static gboolean write_cb(gint fd, GIOCondition condition, gpointer data);
+	static void commit_cb(VteTerminal *vte, gchar *text, guint size, gpointer data);
+	static void size_allocate_cb(GtkWidget *widget, GdkRectangle *allocation, gpointer data);
+	static void child_exited_cb(GPid pid, gint status, gpointer data);
+	static void contents_changed_cb(VteTerminal *vte, gpointer data);
+	static gboolean mark_timeout_cb(gpointer data);
+
+	void start_reading();
+	int read_output();
+	void feed(const char *data, size_t size);
+	void add_mark();
+	void write_input();
+
+	Terminal *m_term;
+	VtePty *m_pty = nullptr;
+	GCancellable *m_cancellable = nullptr;
+	AsciicastWriter m_writer;
+	glong m_columns = 0;
+	glong m_rows = 0;
+	guint m_read_source = 0;
+	guint m_write_source = 0;
+	guint m_child_source = 0;
+	gulong m_commit_callback_id = 0;
+	gulong m_size_callback_id = 0;
+	gulong m_contents_callback_id = 0;
+	std::string m_input; /* Input the child has not read yet */
+	bool m_scan_marks = false;
+	ShellMarkScanner m_scanner;
+	ShellMark m_mark;        /* Waiting for VTE to parse the output before it */
+	gint64 m_mark_time = 0;
+	guint m_mark_source = 0;
+	bool m_unparsed = false; /* VTE was fed output it has not parsed yet */
+	std::string m_held;      /* Output after m_mark */
+	bool m_exited = false;
+};
+
+/**
+ * Feeds an asciicast recording to a terminal, at the recorded pace or as fast as possible.
+ * The tab behaves as if its child exited when the recording ends.
+ */
+class Replayer
+{
+public:
+	Replayer(Terminal *term);
+	~Replayer();
+
+	bool start(const char *path, bool fast, GError **error);
+
+private:
+	static gboolean feed_cb(gpointer data);
+	void feed();
+	void schedule();
+
+	Terminal *m_term;
+	AsciicastReader m_reader;
+	bool m_fast = false;
+	gint64 m_start = 0;
+	guint m_source = 0;
+	double m_next_time = 0;
+	const std::string *m_next = nullptr;
+};
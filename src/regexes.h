@@ -0,0 +1,24 @@
+#pragma once
+
+/* Patterns used to find links on the terminal. They are shared with the regex benchmark, so any
+ * change here is measured against the same corpus */
+
+#define HTTP_REGEXP "(ftp|http)s?://[^ \t\n\b()<>{}«»\\[\\]\'\"]+[^.]"
+/* Anchored to the start of the address and possessive, a run of "user@" or a dotted name with
+ * no top level domain fails in linear time */
+#define MAIL_REGEXP "(?<![\\w.%+-])[\\w.%+-]++@(?:[\\w-]++\\.)+[a-zA-Z]{2,}"
+
+/* Every hint kind is a capture group of a single alternation, in HintKind order. Patterns that
+ * can start anywhere inside a word are anchored to a token start with a lookbehind, so a long
+ * base64 blob does not restart the match at every byte. */
+#define HINT_URL_REGEXP "((?:ftp|https?)://[^\\s()<>{}«»\\[\\]'\"]*[^\\s.,;:!?()<>{}«»\\[\\]'\"])"
+#define HINT_MAIL_REGEXP "(?<![\\w.%+-])([\\w.%+-]+@(?:[\\w-]+\\.)+[a-zA-Z]{2,})"
+#define HINT_PATH_REGEXP                                                                           \
+	"(?<![\\w.~+/-])((?:[\\w.~+-]*+/)*+[\\w+-]++(?:\\.[\\w+-]++)*+:\\d++(?::\\d++)?)"
+#define HINT_IP_REGEXP                                                                             \
+	"\\b((?:25[0-5]|2[0-4]\\d|1?\\d?\\d)(?:\\.(?:25[0-5]|2[0-4]\\d|1?\\d?\\d)){3}"           \
+	"(?::\\d{1,5})?)\\b"
+#define HINT_HASH_REGEXP "\\b((?=[0-9]*[a-f])[0-9a-f]{7,40})\\b"
+#define HINTS_REGEXP                                                                               \
+	HINT_URL_REGEXP "|" HINT_MAIL_REGEXP "|" HINT_IP_REGEXP "|" HINT_PATH_REGEXP              \
+			"|" HINT_HASH_REGEXP
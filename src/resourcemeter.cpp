@@ -0,0 +1,229 @@
+#include "resourcemeter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <time.h>
+#include <unistd.h>
+#include "terminal.h"
+
+#define METER_INTERVAL_US 2000000
+/* Longest interval while the window is unfocused */
+#define METER_MAX_INTERVAL_US 32000000
+/* Most CPU time a batch may take, in thousandths of the interval */
+#define METER_BUDGET_PERMILLE 1
+
+struct MeteredTab {
+	Terminal *term; /* GUI thread only, nullptr once the tab is removed */
+	pid_t pid;
+	bool removed = false;
+	std::map<pid_t, guint64> ticks; /* CPU ticks of every process at the last sample */
+};
+
+/* The samples of all the tabs, on their way to the GUI thread */
+struct MeterUpdate {
+	std::vector<std::pair<std::shared_ptr<MeteredTab>, TabUsage>> tabs;
+};
+
+/* Fields of /proc/PID/stat after the command name, which can contain anything */
+static bool read_stat(pid_t pid, guint64 &ticks, guint64 &rss_pages)
+{
+	char path[64], buffer[1024];
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	FILE *file = fopen(path, "re");
+	if (!file)
+		return false;
+	size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+	fclose(file);
+	buffer[length] = '\0';
+
+	char *fields = strrchr(buffer, ')');
+	unsigned long utime, stime;
+	long rss;
+	/* state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime
+	 * cutime cstime priority nice num_threads itrealvalue starttime vsize rss */
+	const char *format = " %*c %*ld %*ld %*ld %*ld %*ld %*lu %*lu %*lu %*lu %*lu %lu %lu "
+			     "%*ld %*ld %*ld %*ld %*ld %*ld %*lu %*lu %ld";
+	if (!fields || sscanf(fields + 1, format, &utime, &stime, &rss) != 3)
+		return false;
+
+	ticks = utime + stime;
+	rss_pages = rss > 0 ? rss : 0;
+	return true;
+}
+
+/* Children of the main thread, the ones of other threads are missed */
+static void read_children(pid_t pid, std::vector<pid_t> &pids)
+{
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/task/%d/children", pid, pid);
+	FILE *file = fopen(path, "re");
+	if (!file)
+		return;
+
+	int child;
+	while (fscanf(file, "%d", &child) == 1)
+		pids.push_back(child);
+	fclose(file);
+}
+
+static gint64 thread_cpu_time()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec * 1000000L + now.tv_nsec / 1000;
+}
+
+ResourceMeter &ResourceMeter::get()
+{
+	static ResourceMeter meter;
+	return meter;
+}
+
+void ResourceMeter::add(Terminal *term)
+{
+	if (term->pid <= 0)
+		return;
+
+	auto tab = std::make_shared<MeteredTab>();
+	tab->term = term;
+	tab->pid = term->pid;
+	term->meter = tab;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_running) {
+		m_ticks_per_second = sysconf(_SC_CLK_TCK);
+		m_running = true;
+		m_thread = std::thread(&ResourceMeter::run, this);
+	}
+	m_tabs.push_back(tab);
+}
+
+void ResourceMeter::remove(Terminal *term)
+{
+	if (!term->meter)
+		return;
+
+	term->meter->term = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		term->meter->removed = true;
+	}
+	term->meter.reset();
+}
+
+void ResourceMeter::set_focused(bool focused)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (focused && !m_focused)
+		m_wake.notify_one();
+	m_focused = focused;
+}
+
+void ResourceMeter::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_running)
+			return;
+		m_running = false;
+	}
+	m_wake.notify_one();
+	m_thread.join();
+}
+
+void ResourceMeter::run()
+{
+	gint64 interval = METER_INTERVAL_US;
+	gint64 last = g_get_monotonic_time();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_running) {
+		bool was_focused = m_focused;
+		auto woken = [this, was_focused] { return !m_running || m_focused != was_focused; };
+		m_wake.wait_for(lock, std::chrono::microseconds(interval), woken);
+		if (!m_running)
+			break;
+
+		auto removed = [](const std::shared_ptr<MeteredTab> &tab) { return tab->removed; };
+		auto first_removed = std::remove_if(m_tabs.begin(), m_tabs.end(), removed);
+		m_tabs.erase(first_removed, m_tabs.end());
+		auto tabs = m_tabs;
+		bool focused = m_focused;
+		lock.unlock();
+
+		gint64 now = g_get_monotonic_time();
+		gint64 cpu_start = thread_cpu_time();
+		auto update = new MeterUpdate;
+		for (const auto &tab : tabs)
+			update->tabs.emplace_back(tab, sample(*tab, now - last));
+		last = now;
+		g_main_context_invoke(NULL, ResourceMeter::update_cb, update);
+
+		/* Back off while unfocused, and whenever the batch gets too expensive */
+		if (focused)
+			interval = METER_INTERVAL_US;
+		else
+			interval = std::min<gint64>(interval * 2, METER_MAX_INTERVAL_US);
+		gint64 cost = thread_cpu_time() - cpu_start;
+		interval = std::max<gint64>(interval, cost * 1000 / METER_BUDGET_PERMILLE);
+
+		lock.lock();
+	}
+}
+
+TabUsage ResourceMeter::sample(MeteredTab &tab, gint64 elapsed_us)
+{
+	TabUsage usage;
+	std::map<pid_t, guint64> ticks;
+	guint64 delta = 0;
+	guint64 rss_pages = 0;
+
+	std::vector<pid_t> pids = {tab.pid};
+	while (!pids.empty()) {
+		pid_t pid = pids.back();
+		pids.pop_back();
+
+		guint64 process_ticks, process_rss;
+		if (!read_stat(pid, process_ticks, process_rss))
+			continue;
+
+		/* A process new since the last sample ran all of its time in between */
+		auto previous = tab.ticks.find(pid);
+		if (previous == tab.ticks.end())
+			delta += process_ticks;
+		else if (process_ticks > previous->second)
+			delta += process_ticks - previous->second;
+
+		ticks[pid] = process_ticks;
+		rss_pages += process_rss;
+		usage.processes++;
+		read_children(pid, pids);
+	}
+
+	/* The first sample has nothing to compare to */
+	if (!tab.ticks.empty() && elapsed_us > 0)
+		usage.cpu_percent = delta * 100.0 * 1000000 / m_ticks_per_second / elapsed_us;
+	usage.rss_bytes = rss_pages * sysconf(_SC_PAGESIZE);
+	tab.ticks = std::move(ticks);
+
+	return usage;
+}
+
+/* Runs in the GUI thread */
+gboolean ResourceMeter::update_cb(void *data)
+{
+	auto update = (MeterUpdate *)data;
+
+	for (const auto &tab : update->tabs) {
+		Terminal *term = tab.first->term;
+		if (term) {
+			term->usage = tab.second;
+			term->update_tooltip();
+		}
+	}
+
+	delete update;
+	return G_SOURCE_REMOVE;
+}
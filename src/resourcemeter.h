@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include <glib.h>
+
+class Terminal;
+
+/* CPU and memory of the processes of a tab */
+struct TabUsage {
+	double cpu_percent = 0; /* Of one CPU, like top */
+	guint64 rss_bytes = 0;
+	int processes = 0;
+};
+
+struct MeteredTab;
+
+/**
+ * Per-tab CPU and memory meter, enabled with the resource_meter setting and shown in the tab
+ * tooltips. A thread walks the process tree of every tab (/proc/PID/task/PID/children) and
+ * reads /proc/PID/stat of each process, all tabs in one batch per interval, and hands the
+ * results to the GUI thread in a single callback.
+ *
+ * The interval is 2 s while the window has the focus and backs off up to 32 s while it does
+ * not. It also grows when a batch takes more than 0.1% of it in CPU time, so the meter stays
+ * under that budget whatever the number of tabs.
+ */
+class ResourceMeter
+{
+public:
+	static ResourceMeter &get();
+
+	/* Starts metering the tab, once its child is spawned */
+	void add(Terminal *term);
+	void remove(Terminal *term);
+	void set_focused(bool focused);
+	void stop();
+
+private:
+	ResourceMeter() = default;
+	void run();
+	TabUsage sample(MeteredTab &tab, gint64 elapsed_us);
+	static gboolean update_cb(void *data);
+
+	std::thread m_thread;
+	bool m_running = false;
+	bool m_focused = true;
+	std::mutex m_mutex; /* Guards the fields above and m_tabs */
+	std::condition_variable m_wake;
+	std::vector<std::shared_ptr<MeteredTab>> m_tabs;
+	long m_ticks_per_second = 100;
+};
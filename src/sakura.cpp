@@ -7,11 +7,20 @@
 #include <gtkmm/window.h>
 #include <gtkmm/notebook.h>
 #include "sakura.h"
-#include "debug.h"
+#include "benchreport.h"
+#include "broadcast.h"
+#include "core/trace.h"
+#include "exporter.h"
+#include "isolation.h"
+#include "latency.h"
 #include "palettes.h"
 #include "notebook.h"
+#include "paste.h"
+#include "regexes.h"
 #include "sakuraold.h"
+#include "switcher.h"
 #include "terminal.h"
+#include "watchdog.h"
 #include "window.h"
 
 #define FONT_MINIMAL_SIZE (PANGO_SCALE * 6)
@@ -29,13 +38,48 @@
 	"-GtkDialog-button-spacing : 12;\n"                                                        \
 	"}"
 
-#define HTTP_REGEXP "(ftp|http)s?://[^ \t\n\b()<>{}«»\\[\\]\'\"]+[^.]"
-#define MAIL_REGEXP "[^ \t\n\b]+@([^ \t\n\b]+\\.)+([a-zA-Z]{2,4})"
+static gboolean sakura_on_key_press(GtkWidget *widget, GdkEventKey *event, gpointer data)
+{
+	auto obj = (Sakura *)data;
+	return obj->on_key_press(widget, event);
+}
 
-static void sakura_on_key_press(GtkWidget *widget, GdkEventKey *event, gpointer data)
+static gboolean sakura_on_key_release(GtkWidget *widget, GdkEventKey *event, gpointer data)
 {
 	auto obj = (Sakura *)data;
-	obj->on_key_press(widget, event);
+	return obj->on_key_release(widget, event);
+}
+
+static void sakura_keys_changed(GdkKeymap *keymap, gpointer data)
+{
+	auto obj = (Sakura *)data;
+	obj->update_key_bindings();
+}
+
+/* Modifier mask a modifier key adds to the state once it's pressed. Key events report the state
+ * from before the event, so the key itself is not included */
+static guint sakura_modifier_for_keyval(guint keyval)
+{
+	switch (keyval) {
+	case GDK_KEY_Shift_L:
+	case GDK_KEY_Shift_R:
+		return GDK_SHIFT_MASK;
+	case GDK_KEY_Control_L:
+	case GDK_KEY_Control_R:
+		return GDK_CONTROL_MASK;
+	case GDK_KEY_Alt_L:
+	case GDK_KEY_Alt_R:
+	case GDK_KEY_Meta_L:
+	case GDK_KEY_Meta_R:
+		return GDK_MOD1_MASK;
+	case GDK_KEY_Super_L:
+	case GDK_KEY_Super_R:
+		return GDK_SUPER_MASK | GDK_MOD4_MASK;
+	case GDK_KEY_ISO_Level3_Shift:
+		return GDK_MOD5_MASK;
+	default:
+		return 0;
+	}
 }
 
 /* This function is used to fix bug #1393939 */
@@ -63,9 +107,18 @@ Sakura::Sakura() : cfg(g_key_file_new()), provider(Gtk::CssProvider::create())
 	if (!config.read()) {
 		exit(EXIT_FAILURE);
 	}
+	BenchReport::get().mark("config_read");
+
+	/* Before the first tab is added */
+	TabIsolation::get().setup(config);
 
 	config.monitor();
 
+	/* Shortcuts are resolved by keycode, they change with the keyboard layout */
+	update_key_bindings();
+	g_signal_connect(G_OBJECT(gdk_keymap_get_for_display(gdk_display_get_default())),
+			"keys-changed", G_CALLBACK(sakura_keys_changed), this);
+
 	main_window = std::make_unique<SakuraWindow>(Gtk::WINDOW_TOPLEVEL, &config);
 
 	/* set default title pattern from config or NULL */
@@ -123,22 +176,26 @@ Sakura::Sakura() : cfg(g_key_file_new()), provider(Gtk::CssProvider::create())
 	GError *error = nullptr;
 	http_vteregexp = vte_regex_new_for_match(HTTP_REGEXP, strlen(HTTP_REGEXP), 0, &error);
 	if (!http_vteregexp) {
-		SAY("http_regexp: %s", error->message);
+		TRACE_MSG("http_regexp: %s", error->message);
 		g_error_free(error);
 	}
 
 	error = nullptr;
 	mail_vteregexp = vte_regex_new_for_match(MAIL_REGEXP, strlen(MAIL_REGEXP), 0, &error);
 	if (!mail_vteregexp) {
-		SAY("mail_regexp: %s", error->message);
+		TRACE_MSG("mail_regexp: %s", error->message);
 		g_error_free(error);
 	}
+	BenchReport::get().mark("regex");
 
 	init_popup();
+	BenchReport::get().mark("popup");
 
 	main_window->signal_delete_event().connect(sigc::mem_fun(*this, &Sakura::destroy));
 	g_signal_connect(G_OBJECT(main_window->gobj()), "key-press-event",
 			G_CALLBACK(sakura_on_key_press), this);
+	g_signal_connect(G_OBJECT(main_window->gobj()), "key-release-event",
+			G_CALLBACK(sakura_on_key_release), this);
 	// g_signal_connect(G_OBJECT(notebook), "focus-in-event",
 	// G_CALLBACK(sakura_notebook_focus_in), NULL);
 
@@ -146,6 +203,7 @@ Sakura::Sakura() : cfg(g_key_file_new()), provider(Gtk::CssProvider::create())
 	for (int i = 0; i < option_ntabs; i++) {
 		main_window->notebook.add_tab();
 	}
+	BenchReport::get().mark("tabs");
 
 	sanitize_working_directory();
 }
@@ -165,6 +223,12 @@ Sakura::~Sakura()
 	if (mail_vteregexp) {
 		vte_regex_unref(mail_vteregexp);
 	}
+
+	g_free(current_match);
+
+	if (m_size_source) {
+		g_source_remove(m_size_source);
+	}
 }
 
 static const gint BACKWARDS = 2;
@@ -202,7 +266,7 @@ void sakura_setname_entry_changed(GtkWidget *widget, void *data)
 
 bool Sakura::destroy(GdkEventAny*)
 {
-	SAY("Destroying sakura");
+	TRACE_MSG("Destroying sakura");
 
 	g_key_file_free(cfg);
 
@@ -211,11 +275,84 @@ bool Sakura::destroy(GdkEventAny*)
 }
 
 
+/* Register the link regexes on a single terminal, so VTE highlights links under the pointer
+ * there and nowhere else */
+void Sakura::enable_matching(Terminal *term)
+{
+	if (match_term == term)
+		return;
+
+	disable_matching();
+
+	auto vte = VTE_TERMINAL(term->vte);
+	if (http_vteregexp) {
+		http_match_tag = vte_terminal_match_add_regex(vte, http_vteregexp, 0);
+	}
+	if (mail_vteregexp) {
+		mail_match_tag = vte_terminal_match_add_regex(vte, mail_vteregexp, 0);
+	}
+
+	match_term = term;
+	hover_match_valid = false;
+}
+
+void Sakura::disable_matching()
+{
+	if (!match_term)
+		return;
+
+	vte_terminal_match_remove_all(VTE_TERMINAL(match_term->vte));
+	http_match_tag = -1;
+	mail_match_tag = -1;
+	match_term = nullptr;
+	hover_match_valid = false;
+}
+
+/* Cache the match under the pointer, so a click reuses it instead of matching again */
+void Sakura::update_hover_match(GdkEvent *event)
+{
+	gint tag = -1;
+
+	g_free(current_match);
+	current_match = vte_terminal_match_check_event(VTE_TERMINAL(match_term->vte), event, &tag);
+	current_match_is_mail = current_match && tag == mail_match_tag;
+	hover_match_valid = true;
+}
+
+/* Find the link at the event position. The hover cache is used when the pointer has been
+ * tracked, otherwise both regexes are checked in a single pass */
+void Sakura::check_match(Terminal *term, GdkEvent *event)
+{
+	if (match_term == term && hover_match_valid)
+		return;
+
+	VteRegex *regexes[2] = {http_vteregexp, mail_vteregexp};
+	char *matches[2] = {nullptr, nullptr};
+
+	g_free(current_match);
+	current_match = nullptr;
+	current_match_is_mail = false;
+
+	if (!http_vteregexp || !mail_vteregexp)
+		return;
+
+	if (vte_terminal_event_check_regex_simple(
+			    VTE_TERMINAL(term->vte), event, regexes, 2, 0, matches)) {
+		if (matches[0]) {
+			current_match = matches[0];
+			g_free(matches[1]);
+		} else {
+			current_match = matches[1];
+			current_match_is_mail = current_match != nullptr;
+		}
+	}
+}
+
 void Sakura::open_url()
 {
 	GError *error = NULL;
 
-	SAY("Opening %s", current_match);
+	TRACE_MSG("Opening %s", current_match);
 
 	gchar *browser = g_strdup(g_getenv("BROWSER"));
 
@@ -255,6 +392,8 @@ void Sakura::init_popup()
 	auto item_fullscreen = new Gtk::MenuItem(_("Full screen"));
 	auto item_copy = new Gtk::MenuItem(_("Copy"));
 	auto item_paste = new Gtk::MenuItem(_("Paste"));
+	auto item_save_scrollback = new Gtk::MenuItem(_("Save scrollback..."));
+	auto item_pipe_scrollback = new Gtk::MenuItem(_("Pipe scrollback to command..."));
 	auto item_select_font = new Gtk::MenuItem(_("Select font..."));
 	auto item_select_colors = new Gtk::MenuItem(_("Select colors..."));
 	auto item_set_title = new Gtk::MenuItem(_("Set window title..."));
@@ -357,6 +496,8 @@ void Sakura::init_popup()
 	menu->append(*item_fullscreen);
 	menu->append(*item_copy);
 	menu->append(*item_paste);
+	menu->append(*item_save_scrollback);
+	menu->append(*item_pipe_scrollback);
 	menu->append(*separator2);
 	menu->append(*item_options);
 
@@ -410,6 +551,10 @@ void Sakura::init_popup()
 
 	item_copy->signal_activate().connect(sigc::mem_fun(*this, &Sakura::copy));
 	item_paste->signal_activate().connect(sigc::mem_fun(*this, &Sakura::paste));
+	item_save_scrollback->signal_activate().connect(
+			sigc::mem_fun(*this, &Sakura::save_scrollback_dialog));
+	item_pipe_scrollback->signal_activate().connect(
+			sigc::mem_fun(*this, &Sakura::pipe_scrollback_dialog));
 	g_signal_connect(G_OBJECT(item_select_colors->gobj()), "activate", G_CALLBACK(sakura_color_dialog),
 			NULL);
 
@@ -578,7 +723,9 @@ void Sakura::copy()
 void Sakura::paste()
 {
 	auto term = main_window->notebook.get_current_tab_term();
-	vte_terminal_paste_clipboard(VTE_TERMINAL(term->vte));
+	if (!term->paste_job)
+		term->paste_job = std::make_shared<PasteJob>(term);
+	term->paste_job->start();
 }
 
 void Sakura::set_name_dialog()
@@ -646,6 +793,7 @@ void Sakura::set_font()
 /* Set the terminal colors for all notebook tabs */
 void Sakura::set_colors()
 {
+	TRACE_SPAN(TRACE_COLORS, "set_colors");
 	int i;
 	int n_pages = main_window->notebook.get_n_pages();
 	Terminal *term;
@@ -662,10 +810,11 @@ void Sakura::set_colors()
 
 			g_clear_object(&term->bg_image);
 			GError *error = nullptr;
+			WatchdogPhase phase("background_image");
 			term->bg_image = gdk_pixbuf_new_from_file(
 					config.get_background_image().c_str(), &error);
 			if (error) {
-				SAY("Failed to load background image %s", error->message);
+				TRACE_MSG("Failed to load background image %s", error->message);
 				g_clear_error(&error);
 			}
 
@@ -688,157 +837,139 @@ gboolean Sakura::on_key_press(GtkWidget *widget, GdkEventKey *event)
 	if (event->type != GDK_KEY_PRESS)
 		return FALSE;
 
-	uint32_t topage = 0;
+	LatencyProbe::get().key_pressed();
+
+	/* While hints are shown every key is used to type a label */
+	if (hints.is_active()) {
+		return hints.on_key_press(event);
+	}
+
+	auto current = main_window->notebook.get_current_tab_term();
+	if (event->keyval == GDK_KEY_Escape && current && current->paste_job &&
+			current->paste_job->is_running()) {
+		current->paste_job->cancel();
+		return TRUE;
+	}
+	if (event->keyval == GDK_KEY_Escape && current && current->exporter &&
+			current->exporter->is_running()) {
+		current->exporter->cancel();
+		return TRUE;
+	}
+
+	/* Links are only matched while the open url accelerator is held */
+	int modifiers = event->state | sakura_modifier_for_keyval(event->keyval);
+	if ((modifiers & config.open_url_accelerator) == config.open_url_accelerator) {
+		enable_matching(main_window->notebook.get_current_tab_term());
+	}
 
 	gint npages = main_window->notebook.get_n_pages();
 
 	/* Use keycodes instead of keyvals. With keyvals, key bindings work only in
 	 * US/ISO8859-1 and similar locales */
-	guint keycode = event->hardware_keycode;
-
-	/* Add/delete tab keybinding pressed */
-	if ((event->state & config.add_tab_accelerator) == config.add_tab_accelerator &&
-			keycode == sakura_tokeycode(config.keymap.add_tab_key)) {
+	int arg = 0;
+	switch (m_key_bindings.resolve(event->hardware_keycode, event->state, arg)) {
+	case KeyAction::ADD_TAB:
 		main_window->notebook.add_tab();
 		return TRUE;
-	} else if ((event->state & sakura->config.del_tab_accelerator) ==
-					config.del_tab_accelerator &&
-			keycode == sakura_tokeycode(config.keymap.del_tab_key)) {
+	case KeyAction::CLOSE_TAB:
 		/* Delete current tab */
 		main_window->notebook.close_tab();
 		return TRUE;
-	}
-
-	/* Switch tab keybinding pressed (numbers or next/prev) */
-	/* In cases when the user configured accelerators like these ones:
-		switch_tab_accelerator=4  for ctrl+next[prev]_tab_key
-		move_tab_accelerator=5  for ctrl+shift+next[prev]_tab_key
-	   move never works, because switch will be processed first, so it needs to be
-	   fixed with the following condition */
-	if (((event->state & config.switch_tab_accelerator) ==
-			    sakura->config.switch_tab_accelerator) &&
-			((event->state & config.move_tab_accelerator) !=
-					config.move_tab_accelerator)) {
-
-		if ((keycode >= sakura_tokeycode(GDK_KEY_1)) &&
-				(keycode <= sakura_tokeycode(GDK_KEY_9))) {
-
-			/* User has explicitly disabled this branch, make sure to
-			 * propagate the event */
-			if (config.disable_numbered_tabswitch)
-				return FALSE;
-
-			if (sakura_tokeycode(GDK_KEY_1) == keycode)
-				topage = 0;
-			else if (sakura_tokeycode(GDK_KEY_2) == keycode)
-				topage = 1;
-			else if (sakura_tokeycode(GDK_KEY_3) == keycode)
-				topage = 2;
-			else if (sakura_tokeycode(GDK_KEY_4) == keycode)
-				topage = 3;
-			else if (sakura_tokeycode(GDK_KEY_5) == keycode)
-				topage = 4;
-			else if (sakura_tokeycode(GDK_KEY_6) == keycode)
-				topage = 5;
-			else if (sakura_tokeycode(GDK_KEY_7) == keycode)
-				topage = 6;
-			else if (sakura_tokeycode(GDK_KEY_8) == keycode)
-				topage = 7;
-			else if (sakura_tokeycode(GDK_KEY_9) == keycode)
-				topage = 8;
-			if (topage <= npages)
-				main_window->notebook.set_current_page(topage);
-			return TRUE;
-		} else if (keycode == sakura_tokeycode(config.keymap.prev_tab_key)) {
-			if (main_window->notebook.get_current_page() == 0) {
-				main_window->notebook.set_current_page(npages - 1);
-			} else {
-				gtk_notebook_prev_page(main_window->notebook.gobj());
-			}
-			return TRUE;
-		} else if (keycode == sakura_tokeycode(config.keymap.next_tab_key)) {
-			if (main_window->notebook.get_current_page() == (npages - 1)) {
-				main_window->notebook.set_current_page(0);
-			} else {
-				main_window->notebook.next_page();
-			}
-			return TRUE;
-		}
-	}
-
-	/* Move tab keybinding pressed */
-	if (((event->state & config.move_tab_accelerator) == config.move_tab_accelerator)) {
-		if (keycode == sakura_tokeycode(config.keymap.prev_tab_key)) {
-			main_window->notebook.move_tab(BACKWARDS);
-			return TRUE;
-		} else if (keycode == sakura_tokeycode(config.keymap.next_tab_key)) {
-			main_window->notebook.move_tab(FORWARD);
-			return TRUE;
-		}
-	}
-
-	/* Copy/paste keybinding pressed */
-	if ((event->state & config.copy_accelerator) == config.copy_accelerator) {
-		if (keycode == sakura_tokeycode(config.keymap.copy_key)) {
-			sakura->copy();
-			return TRUE;
-		} else if (keycode == sakura_tokeycode(config.keymap.paste_key)) {
-			sakura->paste();
-			return TRUE;
-		}
-	}
-
-	/* Show scrollbar keybinding pressed */
-	if ((event->state & config.scrollbar_accelerator) == config.scrollbar_accelerator) {
-		if (keycode == sakura_tokeycode(config.keymap.scrollbar_key)) {
-			main_window->notebook.show_scrollbar();
-			return TRUE;
-		}
-	}
-
-	/* Set tab name keybinding pressed */
-	if ((event->state & config.set_tab_name_accelerator) == config.set_tab_name_accelerator) {
-		if (keycode == sakura_tokeycode(config.keymap.set_tab_name_key)) {
-			set_name_dialog();
-			return TRUE;
-		}
-	}
-
-	/* Search keybinding pressed */
-	if ((event->state & config.search_accelerator) == config.search_accelerator) {
-		if (keycode == sakura_tokeycode(config.keymap.search_key)) {
-			show_search_dialog();
-			return TRUE;
+	case KeyAction::SWITCH_TAB:
+		/* User has explicitly disabled this binding, make sure to propagate the event */
+		if (config.disable_numbered_tabswitch)
+			return FALSE;
+		if (arg <= npages)
+			main_window->notebook.set_current_page(arg);
+		return TRUE;
+	case KeyAction::PREV_TAB:
+		if (main_window->notebook.get_current_page() == 0) {
+			main_window->notebook.set_current_page(npages - 1);
+		} else {
+			gtk_notebook_prev_page(main_window->notebook.gobj());
 		}
-	}
-
-	/* Increase/decrease font size keybinding pressed */
-	if ((event->state & config.font_size_accelerator) == config.font_size_accelerator) {
-		if (keycode == sakura_tokeycode(config.keymap.increase_font_size_key)) {
-			sakura->increase_font(NULL, NULL);
-			return TRUE;
-		} else if (keycode == sakura_tokeycode(config.keymap.decrease_font_size_key)) {
-			sakura->decrease_font(NULL, NULL);
-			return TRUE;
+		return TRUE;
+	case KeyAction::NEXT_TAB:
+		if (main_window->notebook.get_current_page() == (npages - 1)) {
+			main_window->notebook.set_current_page(0);
+		} else {
+			main_window->notebook.next_page();
 		}
-	}
-
-	/* F11 (fullscreen) pressed */
-	if (keycode == sakura_tokeycode(config.keymap.fullscreen_key)) {
+		return TRUE;
+	case KeyAction::MOVE_TAB_BACKWARDS:
+		main_window->notebook.move_tab(BACKWARDS);
+		return TRUE;
+	case KeyAction::MOVE_TAB_FORWARD:
+		main_window->notebook.move_tab(FORWARD);
+		return TRUE;
+	case KeyAction::COPY:
+		sakura->copy();
+		return TRUE;
+	case KeyAction::PASTE:
+		sakura->paste();
+		return TRUE;
+	case KeyAction::SCROLLBAR:
+		main_window->notebook.show_scrollbar();
+		return TRUE;
+	case KeyAction::SET_TAB_NAME:
+		set_name_dialog();
+		return TRUE;
+	case KeyAction::SEARCH:
+		show_search_dialog();
+		return TRUE;
+	case KeyAction::HINTS:
+		show_hints();
+		return TRUE;
+	case KeyAction::PREV_PROMPT:
+		main_window->notebook.get_current_tab_term()->scroll_to_prompt(true);
+		return TRUE;
+	case KeyAction::NEXT_PROMPT:
+		main_window->notebook.get_current_tab_term()->scroll_to_prompt(false);
+		return TRUE;
+	case KeyAction::BROADCAST:
+		Broadcaster::get().toggle(main_window->notebook.get_current_tab_term());
+		return TRUE;
+	case KeyAction::SWITCHER:
+		TabSwitcher::get().show();
+		return TRUE;
+	case KeyAction::INCREASE_FONT:
+		sakura->increase_font(NULL, NULL);
+		return TRUE;
+	case KeyAction::DECREASE_FONT:
+		sakura->decrease_font(NULL, NULL);
+		return TRUE;
+	case KeyAction::ZOOM_IN:
+		zoom_in(NULL, main_window->notebook.get_current_tab_term());
+		return TRUE;
+	case KeyAction::ZOOM_OUT:
+		zoom_out(NULL, main_window->notebook.get_current_tab_term());
+		return TRUE;
+	case KeyAction::ZOOM_RESET:
+		zoom(main_window->notebook.get_current_tab_term(), 0);
+		return TRUE;
+	case KeyAction::FULLSCREEN:
 		main_window->toggle_fullscreen();
 		return TRUE;
+	case KeyAction::SET_COLORSET:
+		set_color_set(arg);
+		return TRUE;
+	default:
+		return FALSE;
 	}
+}
 
-	/* Change in colorset */
-	if ((event->state & config.set_colorset_accelerator) == config.set_colorset_accelerator) {
-		int i;
-		for (i = 0; i < NUM_COLORSETS; i++) {
-			if (keycode == sakura_tokeycode(config.keymap.set_colorset_keys[i])) {
-				set_color_set(i);
-				return TRUE;
-			}
-		}
+void Sakura::update_key_bindings()
+{
+	m_key_bindings.build(config, sakura_tokeycode);
+}
+
+gboolean Sakura::on_key_release(GtkWidget *widget, GdkEventKey *event)
+{
+	int modifiers = event->state & ~sakura_modifier_for_keyval(event->keyval);
+	if ((modifiers & config.open_url_accelerator) != config.open_url_accelerator) {
+		disable_matching();
 	}
+
 	return FALSE;
 }
 
@@ -868,6 +999,27 @@ void Sakura::decrease_font(GtkWidget *widget, void *data)
 	}
 }
 
+void Sakura::zoom_in(GtkWidget *widget, void *data)
+{
+	auto term = (Terminal *)data;
+	sakura->zoom(term, term->zoom + 1);
+}
+
+void Sakura::zoom_out(GtkWidget *widget, void *data)
+{
+	auto term = (Terminal *)data;
+	sakura->zoom(term, term->zoom - 1);
+}
+
+/* Unlike increase_font, only the tab is measured again and neither the window size nor the
+ * config file change. The hints follow the cell size of the current tab */
+void Sakura::zoom(Terminal *term, int level)
+{
+	term->set_zoom(level);
+	if (term == main_window->notebook.get_current_tab_term())
+		set_size();
+}
+
 void Sakura::set_color_set(int cs)
 {
 	if (cs < 0 || cs >= NUM_COLORSETS)
@@ -904,7 +1056,7 @@ void Sakura::fade_in()
 
 		faded = false;
 		GdkRGBA x = sakura->forecolors[term->colorset];
-		// SAY("fade in red %f to %f", x.red, x.red/FADE_PERCENT*100.0);
+		// TRACE_MSG("fade in red %f to %f", x.red, x.red/FADE_PERCENT*100.0);
 		x.red = x.red / FADE_PERCENT * 100.0;
 		x.green = x.green / FADE_PERCENT * 100.0;
 		x.blue = x.blue / FADE_PERCENT * 100.0;
@@ -912,7 +1064,7 @@ void Sakura::fade_in()
 				(x.blue >= 0 && x.blue <= 1.0)) {
 			forecolors[term->colorset] = x;
 		} else {
-			SAY("Forecolor value out of range");
+			TRACE_MSG("Forecolor value out of range");
 		}
 	}
 }
@@ -924,7 +1076,7 @@ void Sakura::fade_out()
 
 		faded = true;
 		GdkRGBA x = forecolors[term->colorset];
-		// SAY("fade out red %f to %f", x.red, x.red/100.0*FADE_PERCENT);
+		// TRACE_MSG("fade out red %f to %f", x.red, x.red/100.0*FADE_PERCENT);
 		x.red = x.red / 100.0 * FADE_PERCENT;
 		x.green = x.green / 100.0 * FADE_PERCENT;
 		x.blue = x.blue / 100.0 * FADE_PERCENT;
@@ -932,71 +1084,105 @@ void Sakura::fade_out()
 				(x.blue >= 0 && x.blue <= 1.0)) {
 			forecolors[term->colorset] = x;
 		} else {
-			SAY("Forecolor value out of range");
+			TRACE_MSG("Forecolor value out of range");
 		}
 	}
 }
 
+/* Callers only mark the geometry as changed, it is worked out once per main loop iteration,
+ * before the layout of the next frame. Until the window is mapped there is no frame to wait
+ * for, the size is set right away so the window shows up with it */
 void Sakura::set_size()
 {
-	auto term = main_window->notebook.get_tab_term(0);
-	int npages = main_window->notebook.get_n_pages();
-
-	/* Mayhaps an user resize happened. Check if row and columns have changed */
-	if (main_window->resized) {
-		columns = vte_terminal_get_column_count(VTE_TERMINAL(term->vte));
-		rows = vte_terminal_get_row_count(VTE_TERMINAL(term->vte));
-		SAY("New columns %ld and rows %ld", columns, rows);
-		main_window->resized = false;
+	if (!gtk_widget_get_mapped(GTK_WIDGET(main_window->gobj()))) {
+		apply_size();
+		return;
 	}
 
+	if (!m_size_source)
+		m_size_source = g_idle_add_full(G_PRIORITY_HIGH_IDLE, Sakura::size_cb, this, NULL);
+}
+
+gboolean Sakura::size_cb(void *data)
+{
+	auto obj = (Sakura *)data;
+
+	obj->m_size_source = 0;
+	obj->apply_size();
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Geometry hints with the cell size as increments and everything around the terminal as base
+ * size, so the window manager resizes by whole cells. The window is only resized when the
+ * columns and rows it should have don't match its size anymore (first tab, tab bar shown or
+ * hidden, font change). A zoomed tab only gets its own hints */
+void Sakura::apply_size()
+{
+	TRACE_SPAN(TRACE_LAYOUT, "set_size");
+	auto term = main_window->notebook.get_current_tab_term();
+	if (!term)
+		return;
+
 	gtk_style_context_get_padding(gtk_widget_get_style_context(term->vte),
 			gtk_widget_get_state_flags(term->vte), &term->padding);
 	gint pad_x = term->padding.left + term->padding.right;
 	gint pad_y = term->padding.top + term->padding.bottom;
-	// SAY("padding x %d y %d", pad_x, pad_y);
 	gint char_width = vte_terminal_get_char_width(VTE_TERMINAL(term->vte));
 	gint char_height = vte_terminal_get_char_height(VTE_TERMINAL(term->vte));
 
-	width = pad_x + (char_width * columns);
-	height = pad_y + (char_height * rows);
-
-	if (npages >= 2 || config.first_tab) {
+	/* The natural size of the window is the one of the terminal plus the tab bar, the
+	 * scrollbar and the borders, whatever is shown. Hidden pages keep out of it, their
+	 * terminals may still have the columns of an older size (see TerminalBox) */
+	GtkRequisition window_size, vte_size;
+	gtk_widget_get_preferred_size(GTK_WIDGET(main_window->gobj()), NULL, &window_size);
+	gtk_widget_get_preferred_size(term->vte, NULL, &vte_size);
+
+	GdkGeometry hints;
+	hints.base_width = window_size.width - vte_size.width + pad_x;
+	hints.base_height = window_size.height - vte_size.height + pad_y;
+	hints.width_inc = char_width;
+	hints.height_inc = char_height;
+	hints.min_width = hints.base_width + char_width * SAKURA_MIN_COLUMNS;
+	hints.min_height = hints.base_height + char_height * SAKURA_MIN_ROWS;
+	gtk_window_set_geometry_hints(GTK_WINDOW(main_window->gobj()), NULL, &hints,
+			(GdkWindowHints)(GDK_HINT_BASE_SIZE | GDK_HINT_RESIZE_INC | GDK_HINT_MIN_SIZE));
+	geometry_zoom = term->zoom;
+
+	/* Columns and rows are those of the configured font, a zoomed tab fits in the window */
+	if (term->zoom)
+		return;
 
-		/* TODO: Yeah i know, this is utter shit. Remove this ugly hack and set geometry
-		 * hints*/
-		if (!config.show_scrollbar)
-			// height += min_height - 10;
-			height += 10;
-		else
-			// height += min_height - 47;
-			height += 47;
+	int current_width, current_height;
+	main_window->get_size(current_width, current_height);
 
-		width += 8;
-		width += /* (hb*2)+*/ (pad_x * 2);
+	/* Mayhaps an user resize happened. Check if row and columns have changed. They come from
+	 * the window, the allocation of a tab that was just shown may be behind */
+	if (main_window->resized) {
+		columns = MAX((current_width - hints.base_width) / char_width, SAKURA_MIN_COLUMNS);
+		rows = MAX((current_height - hints.base_height) / char_height, SAKURA_MIN_ROWS);
+		TRACE_MSG("New columns %ld and rows %ld", columns, rows);
+		main_window->resized = false;
 	}
 
-	term = main_window->notebook.get_current_tab_term();
-
-	gint min_width, natural_width;
-	gtk_widget_get_preferred_width(term->scrollbar, &min_width, &natural_width);
-	// SAY("SCROLLBAR min width %d natural width %d", min_width, natural_width);
-	if (config.show_scrollbar) {
-		width += min_width;
-	}
+	width = hints.base_width + char_width * columns;
+	height = hints.base_height + char_height * rows;
 
 	/* GTK does not ignore resize for maximized windows on some systems,
 	so we do need check if it's maximized or not */
 	GdkWindow *gdk_window = gtk_widget_get_window(GTK_WIDGET(main_window->gobj()));
 	if (gdk_window != NULL) {
-		if (gdk_window_get_state(gdk_window) & GDK_WINDOW_STATE_MAXIMIZED) {
-			SAY("window is maximized, will not resize");
+		if (gdk_window_get_state(gdk_window) &
+				(GDK_WINDOW_STATE_MAXIMIZED | GDK_WINDOW_STATE_FULLSCREEN)) {
+			TRACE_MSG("window is maximized, will not resize");
 			return;
 		}
 	}
 
-	main_window->resize(width, height);
-	SAY("Resized to %d %d", width, height);
+	if (width != current_width || height != current_height) {
+		main_window->resize(width, height);
+		TRACE_MSG("Resized to %d %d", width, height);
+	}
 }
 
 void Sakura::on_child_exited(GtkWidget *widget)
@@ -1011,7 +1197,7 @@ void Sakura::on_child_exited(GtkWidget *widget)
 	}
 
 	if (option_hold == TRUE) {
-		SAY("hold option has been activated");
+		TRACE_MSG("hold option has been activated");
 		return;
 	}
 
@@ -1031,7 +1217,7 @@ void Sakura::on_child_exited(GtkWidget *widget)
 
 void Sakura::on_eof(GtkWidget *widget)
 {
-	SAY("Got EOF signal");
+	TRACE_MSG("Got EOF signal");
 
 	gint npages = main_window->notebook.get_n_pages();
 
@@ -1048,11 +1234,11 @@ void Sakura::on_eof(GtkWidget *widget)
 		auto term = main_window->notebook.get_tab_term(0);
 
 		if (option_hold == TRUE) {
-			SAY("hold option has been activated");
+			TRACE_MSG("hold option has been activated");
 			return;
 		}
 
-		// SAY("waiting for terminal pid (in eof) %d", term->pid);
+		// TRACE_MSG("waiting for terminal pid (in eof) %d", term->pid);
 		// waitpid(term->pid, &status, WNOHANG);
 		/* TODO: check wait return */
 		/* Child should be automatically reaped because we don't use
@@ -1115,6 +1301,81 @@ void Sakura::show_search_dialog()
 	}
 }
 
+void Sakura::save_scrollback_dialog()
+{
+	auto dialog = Gtk::FileChooserDialog(
+			*main_window, _("Save scrollback"), Gtk::FILE_CHOOSER_ACTION_SAVE);
+	dialog.add_button(_("_Cancel"), Gtk::RESPONSE_CANCEL);
+	dialog.add_button(_("_Save"), Gtk::RESPONSE_ACCEPT);
+	dialog.set_default_response(Gtk::RESPONSE_ACCEPT);
+	dialog.set_do_overwrite_confirmation(true);
+	/* A name ending in .html saves it as HTML */
+	dialog.set_current_name("scrollback.txt");
+
+	if (dialog.run() != Gtk::RESPONSE_ACCEPT)
+		return;
+	dialog.hide();
+
+	auto term = main_window->notebook.get_current_tab_term();
+	if (!term->exporter)
+		term->exporter = new ScrollbackExporter(term);
+
+	GError *error = NULL;
+	if (!term->exporter->to_file(dialog.get_filename().c_str(), &error)) {
+		sakura_error("%s", error->message);
+		g_error_free(error);
+	}
+}
+
+void Sakura::pipe_scrollback_dialog()
+{
+	auto command_dialog = Gtk::Dialog(
+			_("Pipe scrollback"), Gtk::DIALOG_MODAL | Gtk::DIALOG_USE_HEADER_BAR);
+	command_dialog.set_parent(*sakura->main_window);
+	command_dialog.add_button(_("_Cancel"), Gtk::RESPONSE_CANCEL);
+	command_dialog.add_button(_("_Apply"), Gtk::RESPONSE_ACCEPT);
+
+	auto command_header = command_dialog.get_header_bar();
+	command_header->set_show_close_button(false);
+	command_dialog.set_default_response(Gtk::RESPONSE_ACCEPT);
+
+	auto context = command_dialog.get_style_context();
+	sakura->provider->load_from_data(HIG_DIALOG_CSS);
+	context->add_provider(sakura->provider, GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+	auto entry = Gtk::Entry();
+	auto label = Gtk::Label(_("Command"));
+	auto command_hbox = Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 0);
+	entry.set_text("less");
+	entry.set_activates_default(true);
+	command_hbox.pack_start(label, true, true, 12);
+	command_hbox.pack_start(entry, true, true, 12);
+	command_dialog.get_content_area()->pack_start(command_hbox, false, false, 12);
+
+	g_signal_connect(entry.gobj(), "changed", G_CALLBACK(sakura_setname_entry_changed),
+			&command_dialog);
+	command_hbox.show_all();
+
+	if (command_dialog.run() != Gtk::RESPONSE_ACCEPT)
+		return;
+
+	auto term = main_window->notebook.get_current_tab_term();
+	if (!term->exporter)
+		term->exporter = new ScrollbackExporter(term);
+
+	GError *error = NULL;
+	if (!term->exporter->to_command(entry.get_text().c_str(), &error)) {
+		sakura_error("%s", error->message);
+		g_error_free(error);
+	}
+}
+
+void Sakura::show_hints()
+{
+	auto term = main_window->notebook.get_current_tab_term();
+	hints.start(term);
+}
+
 void Sakura::beep(GtkWidget *widget)
 {
 	// Remove the urgency hint. This is necessary to signal the window manager
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "config.h"
+#include "core/keybindings.h"
+#include "hints.h"
 #include <gtkmm.h>
 
 class SakuraWindow;
@@ -8,6 +10,9 @@ class Terminal;
 
 #define DEFAULT_COLUMNS 80
 #define DEFAULT_ROWS 24
+/* Geometry hints, the window can't be made smaller */
+#define SAKURA_MIN_COLUMNS 8
+#define SAKURA_MIN_ROWS 2
 
 class Sakura {
 public:
@@ -22,6 +27,15 @@ public:
 	// Some old static callbacks to refactor
 	static void increase_font(GtkWidget *, void *);
 	static void decrease_font(GtkWidget *, void *);
+	/* Font of a single tab, the Terminal is the data */
+	static void zoom_in(GtkWidget *, void *);
+	static void zoom_out(GtkWidget *, void *);
+	void zoom(Terminal *term, int level);
+
+	void enable_matching(Terminal *term);
+	void disable_matching();
+	void update_hover_match(GdkEvent *event);
+	void check_match(Terminal *term, GdkEvent *event);
 
 	void copy_url();
 	void open_url();
@@ -29,6 +43,8 @@ public:
 	void open_title_dialog();
 
 	gboolean on_key_press(GtkWidget *widget, GdkEventKey *event);
+	gboolean on_key_release(GtkWidget *widget, GdkEventKey *event);
+	void update_key_bindings();
 	void on_child_exited(GtkWidget *widget);
 	void on_eof(GtkWidget *widget);
 
@@ -36,11 +52,15 @@ public:
 	void toggle_numbered_tabswitch_option(GtkWidget *widget);
 
 	void show_search_dialog();
+	void save_scrollback_dialog();
+	void pipe_scrollback_dialog();
+	void show_hints();
 
 	void set_colors();
 
 	void fade_in();
 	void fade_out();
+	/* The geometry changed: tabs, scrollbar, font. Resolved once per frame */
 	void set_size();
 
 	void set_name_dialog();
@@ -51,11 +71,13 @@ public:
 	GdkRGBA forecolors[NUM_COLORSETS];
 	GdkRGBA backcolors[NUM_COLORSETS];
 	GdkRGBA curscolors[NUM_COLORSETS];
-	char *current_match;
+	char *current_match = nullptr;
+	bool current_match_is_mail = false;
 	int width;
 	int height;
 	glong columns = DEFAULT_COLUMNS;
 	glong rows = DEFAULT_ROWS;
+	int geometry_zoom = 0; /* Of the tab the window geometry hints are for */
 	gint label_count = 1;
 	bool keep_fc = false;                    /* Global flag to indicate that we don't want changes in the files and columns values */
 	bool config_modified = false;            /* Configuration has been modified */
@@ -68,11 +90,20 @@ public:
 	GKeyFile *cfg;
 	Glib::RefPtr<Gtk::CssProvider> provider;
 	VteRegex *http_vteregexp, *mail_vteregexp;
+	Terminal *match_term = nullptr;          /* Only terminal with match regexes, if any */
+	gint http_match_tag = -1;
+	gint mail_match_tag = -1;
+	bool hover_match_valid = false;          /* current_match is the match under the pointer */
 	char *argv[3];
 	Config config;
+	HintMode hints;
 private:
 	void set_color_set(int cs);
 
 	void show_font_dialog();
+	void apply_size();
+	static gboolean size_cb(void *data);
 
+	KeyBindings m_key_bindings;
+	guint m_size_source = 0;
 };
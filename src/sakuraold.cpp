@@ -45,12 +45,17 @@
 #include <vte/vte.h>
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
-#include "debug.h"
+#include "core/tablabel.h"
+#include "core/trace.h"
 #include "gettext.h"
+#include "metrics.h"
 #include "notebook.h"
 #include "palettes.h"
+#include "proctracker.h"
+#include "resourcemeter.h"
 #include "sakura.h"
 #include "sakuraold.h"
+#include "switcher.h"
 #include "terminal.h"
 #include "window.h"
 
@@ -66,6 +71,33 @@
 
 #define ERROR_BUFFER_LENGTH 256
 
+const char *option_workdir;
+const char *option_font;
+const char *option_execute;
+gboolean option_xterm_execute = FALSE;
+gchar **option_xterm_args;
+gboolean option_version = FALSE;
+gint option_ntabs = 1;
+gint option_login = FALSE;
+const char *option_title;
+const char *option_icon;
+int option_rows, option_columns;
+gboolean option_hold = FALSE;
+char *option_config_file;
+gboolean option_fullscreen;
+gboolean option_maximize;
+gint option_colorset;
+gboolean option_frame_timing = FALSE;
+gboolean option_measure_latency = FALSE;
+char *option_metrics_socket;
+int option_watchdog;
+gboolean option_watchdog_backtrace = FALSE;
+char *option_bench_report;
+char *option_bench_scenario;
+char *option_record;
+char *option_replay;
+gboolean option_replay_fast = FALSE;
+
 GOptionEntry entries[] = {{"version", 'v', 0, G_OPTION_ARG_NONE, &option_version,
 					  N_("Print version number"), NULL},
 		{"font", 'f', 0, G_OPTION_ARG_STRING, &option_font,
@@ -98,6 +130,26 @@ GOptionEntry entries[] = {{"version", 'v', 0, G_OPTION_ARG_NONE, &option_version
 				N_("Use alternate configuration file"), NULL},
 		{"colorset", 0, 0, G_OPTION_ARG_INT, &option_colorset,
 				N_("Select initial colorset"), NULL},
+		{"record", 0, 0, G_OPTION_ARG_FILENAME, &option_record,
+				N_("Record the output of every tab to an asciicast file"), NULL},
+		{"replay", 0, 0, G_OPTION_ARG_FILENAME, &option_replay,
+				N_("Replay an asciicast recording in the first tab"), NULL},
+		{"replay-fast", 0, 0, G_OPTION_ARG_NONE, &option_replay_fast,
+				N_("Replay as fast as possible instead of at the recorded pace"), NULL},
+		{"frame-timing", 0, 0, G_OPTION_ARG_NONE, &option_frame_timing,
+				N_("Show frame timing statistics, print them on SIGUSR1"), NULL},
+		{"measure-latency", 0, 0, G_OPTION_ARG_NONE, &option_measure_latency,
+				N_("Measure the latency from key press to echo on screen"), NULL},
+		{"metrics-socket", 0, 0, G_OPTION_ARG_FILENAME, &option_metrics_socket,
+				N_("Serve Prometheus metrics on a Unix socket"), N_("PATH")},
+		{"watchdog", 0, 0, G_OPTION_ARG_INT, &option_watchdog,
+				N_("Report when the GUI is blocked for longer than MS"), N_("MS")},
+		{"watchdog-backtrace", 0, 0, G_OPTION_ARG_NONE, &option_watchdog_backtrace,
+				N_("Print a backtrace of the blocked GUI"), NULL},
+		{"bench-report", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_FILENAME,
+				&option_bench_report, NULL, NULL},
+		{"bench-scenario", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_STRING,
+				&option_bench_scenario, NULL, NULL},
 		{NULL}};
 
 void search(VteTerminal *vte, const char *pattern, bool reverse)
@@ -131,20 +183,26 @@ gboolean sakura_button_press(GtkWidget *widget, GdkEventButton *button_event, gp
 	if (button_event->type != GDK_BUTTON_PRESS)
 		return FALSE;
 
-	gint tag;
+	bool open_link = button_event->button == 1 &&
+			((button_event->state & sakura->config.open_url_accelerator) ==
+					sakura->config.open_url_accelerator);
+
+	/* Other buttons don't care about links, so don't run any regex for them */
+	if (!open_link && button_event->button != 3)
+		return FALSE;
+
 	auto term = sakura->main_window->notebook.get_current_tab_term();
 
 	/* Find out if cursor it's over a matched expression...*/
-	sakura->current_match = vte_terminal_match_check_event(
-			VTE_TERMINAL(term->vte), (GdkEvent *)button_event, &tag);
+	sakura->check_match(term, (GdkEvent *)button_event);
 
 	/* Left button with accelerator: open the URL if any */
-	if (button_event->button == 1 &&
-			((button_event->state & sakura->config.open_url_accelerator) ==
-					sakura->config.open_url_accelerator) &&
-			sakura->current_match) {
-
-		sakura->open_url();
+	if (open_link && sakura->current_match) {
+		if (sakura->current_match_is_mail) {
+			sakura->open_mail();
+		} else {
+			sakura->open_url();
+		}
 
 		return TRUE;
 	}
@@ -155,12 +213,7 @@ gboolean sakura_button_press(GtkWidget *widget, GdkEventButton *button_event, gp
 
 		if (sakura->current_match) {
 			/* Show the extra options in the menu */
-
-			char *matches;
-			/* Is it a mail address? */
-			if (vte_terminal_event_check_regex_simple(VTE_TERMINAL(term->vte),
-					    (GdkEvent *)button_event, &sakura->mail_vteregexp, 1, 0,
-					    &matches)) {
+			if (sakura->current_match_is_mail) {
 				sakura->item_open_mail->show();
 				sakura->item_open_link->hide();
 			} else {
@@ -169,8 +222,6 @@ gboolean sakura_button_press(GtkWidget *widget, GdkEventButton *button_event, gp
 			}
 			sakura->item_copy_link->show();
 			sakura->open_link_separator->show();
-
-			g_free(matches);
 		} else {
 			/* Hide all the options */
 			sakura->item_open_mail->hide();
@@ -187,6 +238,19 @@ gboolean sakura_button_press(GtkWidget *widget, GdkEventButton *button_event, gp
 	return FALSE;
 }
 
+/* Pointer moved over a terminal. Regexes only run here while the open url accelerator is held
+ * over the focused terminal, otherwise this is a no-op */
+gboolean sakura_motion_notify(GtkWidget *widget, GdkEventMotion *motion_event, gpointer user_data)
+{
+	auto term = (Terminal *)user_data;
+
+	if (sakura->match_term == term) {
+		sakura->update_hover_match((GdkEvent *)motion_event);
+	}
+
+	return FALSE;
+}
+
 void sakura_child_exited(GtkWidget *widget, void *data)
 {
 	// auto obj = (Sakura *)data;
@@ -205,6 +269,7 @@ void sakura_eof(GtkWidget *widget, void *data)
  * titles */
 void sakura_title_changed(GtkWidget *widget, void *data)
 {
+	TRACE_SPAN(TRACE_TITLE, "title_changed");
 	auto vte_term = (VteTerminal *)widget;
 
 	gint modified_page = sakura->main_window->notebook.find_tab(vte_term);
@@ -212,6 +277,7 @@ void sakura_title_changed(GtkWidget *widget, void *data)
 	auto term = sakura->main_window->notebook.get_tab_term(modified_page);
 
 	const char *title = vte_terminal_get_window_title(VTE_TERMINAL(term->vte));
+	TabSwitcher::get().update(term, TabField::TITLE, title ? title : "");
 
 	/* User set values overrides any other one, but title should be changed */
 	if (!term->label_set_byuser)
@@ -464,13 +530,13 @@ void sakura_color_dialog(GtkWidget *widget, void *data)
 void sakura_show_first_tab(GtkWidget *widget, void *data)
 {
 	if (gtk_check_menu_item_get_active(GTK_CHECK_MENU_ITEM(widget))) {
-		sakura->main_window->notebook.set_show_tabs(true);
+		sakura->main_window->notebook.set_tabs_visible(true);
 		sakura_set_config_string("show_always_first_tab", "Yes");
 		sakura->config.first_tab = true;
 	} else {
 		/* Only hide tabs if the notebook has one page */
 		if (sakura->main_window->notebook.get_n_pages() == 1) {
-			sakura->main_window->notebook.set_show_tabs(false);
+			sakura->main_window->notebook.set_tabs_visible(false);
 		}
 		sakura_set_config_string("show_always_first_tab", "No");
 		sakura->config.first_tab = false;
@@ -483,9 +549,11 @@ void sakura_tabs_on_bottom(GtkWidget *widget, void *data)
 
 	if (gtk_check_menu_item_get_active(GTK_CHECK_MENU_ITEM(widget))) {
 		gtk_notebook_set_tab_pos(sakura->main_window->notebook.gobj(), GTK_POS_BOTTOM);
+		sakura->main_window->place_tab_bar(true);
 		sakura_set_config_boolean("tabs_on_bottom", TRUE);
 	} else {
 		gtk_notebook_set_tab_pos(sakura->main_window->notebook.gobj(), GTK_POS_TOP);
+		sakura->main_window->place_tab_bar(false);
 		sakura_set_config_boolean("tabs_on_bottom", FALSE);
 	}
 }
@@ -602,21 +670,8 @@ void sakura_set_palette(GtkWidget *widget, void *data)
 	char *palette = (char *)data;
 
 	if (gtk_check_menu_item_get_active(GTK_CHECK_MENU_ITEM(widget))) {
-		if (strcmp(palette, "linux") == 0) {
-			sakura->config.palette = linux_palette;
-		} else if (strcmp(palette, "gruvbox") == 0) {
-			sakura->config.palette = gruvbox_palette;
-		} else if (strcmp(palette, "xterm") == 0) {
-			sakura->config.palette = xterm_palette;
-		} else if (strcmp(palette, "rxvt") == 0) {
-			sakura->config.palette = rxvt_palette;
-		} else if (strcmp(palette, "tango") == 0) {
-			sakura->config.palette = tango_palette;
-		} else if (strcmp(palette, "solarized_dark") == 0) {
-			sakura->config.palette = solarized_dark_palette;
-		} else {
-			sakura->config.palette = solarized_light_palette;
-		}
+		sakura->config.palette_str = palette;
+		sakura->config.palette = palette_colors(palette_from_name(palette));
 
 		/* Palette changed so we ¿need? to set colors again */
 		sakura->set_colors();
@@ -644,11 +699,8 @@ void sakura_closebutton_clicked(GtkWidget *widget, void *data)
 		sakura_config_done();
 	}
 
-	/* Check if there are running processes for this tab. Use tcgetpgrp to compare to the shell
-	 * PGID */
-	auto pgid = tcgetpgrp(vte_pty_get_fd(vte_terminal_get_pty(VTE_TERMINAL(term->vte))));
-
-	if ((pgid != -1) && (pgid != term->pid) && (!sakura->config.less_questions)) {
+	/* Check if there are running processes for this tab, as seen by the ProcTracker */
+	if (term->foreground.pgid != 0 && !sakura->config.less_questions) {
 		auto dialog = gtk_message_dialog_new(GTK_WINDOW(sakura->main_window->gobj()),
 				GTK_DIALOG_MODAL, GTK_MESSAGE_QUESTION, GTK_BUTTONS_YES_NO,
 				_("There is a running process in this terminal.\n\nDo you really "
@@ -695,20 +747,17 @@ void sakura_use_fading(GtkWidget *widget, void *data)
 void sakura_set_tab_label_text(const gchar *title, gint page)
 {
 	auto term = sakura->main_window->notebook.get_tab_term(page);
-	if ((title != NULL) && (g_strcmp0(title, "") != 0)) {
-		/* Chop to max size. TODO: Should it be configurable by the user? */
-		auto chopped_title = g_strndup(title, TAB_MAX_SIZE);
-		/* Honor the minimum tab label size */
-		while (strlen(chopped_title) < TAB_MIN_SIZE) {
-			char *old_ptr = chopped_title;
-			chopped_title = g_strconcat(chopped_title, " ", NULL);
-			free(old_ptr);
-		}
-		term->label.set_text(chopped_title);
-		free(chopped_title);
+	/* Chop to max size. TODO: Should it be configurable by the user? */
+	auto label = tab_label_text(title, TAB_MAX_SIZE, TAB_MIN_SIZE);
+	if (!label.empty()) {
+		term->label.set_text(label);
+		/* The quick switcher finds tabs by the whole text */
+		TabSwitcher::get().update(term, TabField::LABEL, title);
 	} else { /* Use the default values */
 		term->label.set_text(term->label_text);
+		TabSwitcher::get().update(term, TabField::LABEL, term->label_text);
 	}
+	sakura->main_window->tab_bar.update(term);
 }
 
 /* Callback for vte_terminal_spawn_async */
@@ -717,9 +766,15 @@ void sakura_spawn_callback(VteTerminal *vte, GPid pid, GError *error, gpointer u
 	auto term = (Terminal *)user_data;
 	// term = sakura->get_page_term(page);
 	if (pid == -1) { /* Fork has failed */
-		SAY("Error: %s", error->message);
+		TRACE_MSG("Error: %s", error->message);
 	} else {
 		term->pid = pid;
+		TRACE_INSTANT(TRACE_CHILD, "child_started");
+		ProcTracker::get().add(term);
+		if (sakura->config.resource_meter)
+			ResourceMeter::get().add(term);
+		if (term->metrics)
+			term->metrics->pid = pid;
 	}
 }
 
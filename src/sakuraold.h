@@ -5,23 +5,33 @@
 #include "sakura.h"
 
 class Terminal;
-/* Globals for command line parameters */
-static const char *option_workdir;
-static const char *option_font;
-static const char *option_execute;
-static gboolean option_xterm_execute = FALSE;
-static gchar **option_xterm_args;
-static gboolean option_version = FALSE;
-static gint option_ntabs = 1;
-static gint option_login = FALSE;
-static const char *option_title;
-static const char *option_icon;
-static int option_rows, option_columns;
-static gboolean option_hold = FALSE;
-static char *option_config_file;
-static gboolean option_fullscreen;
-static gboolean option_maximize;
-static gint option_colorset;
+/* Globals for command line parameters, defined next to the option entries that fill them */
+extern const char *option_workdir;
+extern const char *option_font;
+extern const char *option_execute;
+extern gboolean option_xterm_execute;
+extern gchar **option_xterm_args;
+extern gboolean option_version;
+extern gint option_ntabs;
+extern gint option_login;
+extern const char *option_title;
+extern const char *option_icon;
+extern int option_rows, option_columns;
+extern gboolean option_hold;
+extern char *option_config_file;
+extern gboolean option_fullscreen;
+extern gboolean option_maximize;
+extern gint option_colorset;
+extern gboolean option_frame_timing;
+extern gboolean option_measure_latency;
+extern char *option_metrics_socket;
+extern int option_watchdog;
+extern gboolean option_watchdog_backtrace;
+extern char *option_bench_report;
+extern char *option_bench_scenario;
+extern char *option_record;
+extern char *option_replay;
+extern gboolean option_replay_fast;
 
 extern GOptionEntry entries[];
 
@@ -81,6 +91,7 @@ void sakura_error(const char *, ...);
 
 /* Callbacks */
 gboolean sakura_button_press(GtkWidget *, GdkEventButton *, gpointer);
+gboolean sakura_motion_notify(GtkWidget *, GdkEventMotion *, gpointer);
 void sakura_child_exited(GtkWidget *, void *);
 void sakura_eof(GtkWidget *, void *);
 void sakura_title_changed(GtkWidget *, void *);
@@ -0,0 +1,207 @@
+#include "switcher.h"
+#include <libintl.h>
+#include "gettext.h"
+#include "sakura.h"
+#include "sakuraold.h"
+#include "terminal.h"
+#include "window.h"
+
+/* Enough to fill the popup, a keystroke never updates more rows than these */
+#define SWITCHER_ROWS 20
+#define SWITCHER_WIDTH 640
+
+TabSwitcher &TabSwitcher::get()
+{
+	static TabSwitcher switcher;
+	return switcher;
+}
+
+void TabSwitcher::update(Terminal *term, TabField field, const std::string &value)
+{
+	m_index.set(term, field, value);
+}
+
+void TabSwitcher::remove(Terminal *term)
+{
+	m_index.remove(term);
+	if (m_window && gtk_widget_get_visible(m_window))
+		refresh();
+}
+
+void TabSwitcher::show()
+{
+	if (!m_window)
+		create();
+
+	gtk_entry_set_text(GTK_ENTRY(m_entry), "");
+	refresh();
+	gtk_window_present(GTK_WINDOW(m_window));
+	gtk_widget_grab_focus(m_entry);
+}
+
+void TabSwitcher::create()
+{
+	m_window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	gtk_window_set_transient_for(GTK_WINDOW(m_window), GTK_WINDOW(sakura->main_window->gobj()));
+	gtk_window_set_destroy_with_parent(GTK_WINDOW(m_window), TRUE);
+	gtk_window_set_modal(GTK_WINDOW(m_window), TRUE);
+	gtk_window_set_decorated(GTK_WINDOW(m_window), FALSE);
+	gtk_window_set_skip_taskbar_hint(GTK_WINDOW(m_window), TRUE);
+	gtk_window_set_type_hint(GTK_WINDOW(m_window), GDK_WINDOW_TYPE_HINT_DIALOG);
+	gtk_window_set_position(GTK_WINDOW(m_window), GTK_WIN_POS_CENTER_ON_PARENT);
+	gtk_window_set_default_size(GTK_WINDOW(m_window), SWITCHER_WIDTH, -1);
+
+	GtkWidget *box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+	m_entry = gtk_entry_new();
+	gtk_entry_set_placeholder_text(
+			GTK_ENTRY(m_entry), _("Tab title, directory or command"));
+	m_list = gtk_list_box_new();
+	gtk_list_box_set_selection_mode(GTK_LIST_BOX(m_list), GTK_SELECTION_SINGLE);
+
+	for (int i = 0; i < SWITCHER_ROWS; i++) {
+		GtkWidget *label = gtk_label_new(NULL);
+		gtk_label_set_xalign(GTK_LABEL(label), 0);
+		gtk_label_set_ellipsize(GTK_LABEL(label), PANGO_ELLIPSIZE_END);
+		gtk_widget_set_margin_start(label, 6);
+		gtk_widget_set_margin_end(label, 6);
+		GtkWidget *row = gtk_list_box_row_new();
+		gtk_container_add(GTK_CONTAINER(row), label);
+		gtk_container_add(GTK_CONTAINER(m_list), row);
+		m_rows.push_back(row);
+		m_labels.push_back(label);
+	}
+
+	gtk_box_pack_start(GTK_BOX(box), m_entry, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(box), m_list, FALSE, FALSE, 0);
+	gtk_container_add(GTK_CONTAINER(m_window), box);
+	gtk_widget_show_all(box);
+
+	g_signal_connect(G_OBJECT(m_entry), "changed", G_CALLBACK(TabSwitcher::changed_cb), this);
+	g_signal_connect(G_OBJECT(m_entry), "key-press-event",
+			G_CALLBACK(TabSwitcher::key_press_cb), this);
+	g_signal_connect(G_OBJECT(m_list), "row-activated",
+			G_CALLBACK(TabSwitcher::row_activated_cb), this);
+	g_signal_connect(G_OBJECT(m_window), "focus-out-event",
+			G_CALLBACK(TabSwitcher::focus_out_cb), this);
+	g_signal_connect(G_OBJECT(m_window), "destroy", G_CALLBACK(TabSwitcher::destroy_cb), this);
+}
+
+void TabSwitcher::hide()
+{
+	gtk_widget_hide(m_window);
+}
+
+void TabSwitcher::refresh()
+{
+	auto &notebook = sakura->main_window->notebook;
+	const char *pattern = gtk_entry_get_text(GTK_ENTRY(m_entry));
+
+	/* With nothing typed yet, the tabs in their order */
+	m_shown.clear();
+	if (*pattern == '\0') {
+		int pages = notebook.get_n_pages();
+		for (int page = 0; page < pages && m_shown.size() < SWITCHER_ROWS; page++)
+			m_shown.push_back(notebook.get_tab_term(page));
+	} else {
+		m_index.match(pattern, SWITCHER_ROWS, m_matches);
+		for (const auto &match : m_matches)
+			m_shown.push_back((Terminal *)match.tab);
+	}
+
+	for (size_t row = 0; row < m_rows.size(); row++) {
+		if (row >= m_shown.size()) {
+			gtk_widget_hide(m_rows[row]);
+			continue;
+		}
+
+		Terminal *term = m_shown[row];
+		gchar *markup = g_markup_printf_escaped(
+				"<b>%d</b>  %s  <span alpha=\"60%%\">%s  %s</span>",
+				notebook.page_num(term->hbox) + 1,
+				m_index.get(term, TabField::LABEL).c_str(),
+				m_index.get(term, TabField::CWD).c_str(),
+				m_index.get(term, TabField::COMMAND).c_str());
+		gtk_label_set_markup(GTK_LABEL(m_labels[row]), markup);
+		g_free(markup);
+		gtk_widget_show(m_rows[row]);
+	}
+
+	select(0);
+}
+
+void TabSwitcher::select(int row)
+{
+	if (row >= 0 && row < (int)m_shown.size())
+		gtk_list_box_select_row(GTK_LIST_BOX(m_list), GTK_LIST_BOX_ROW(m_rows[row]));
+	else
+		gtk_list_box_unselect_all(GTK_LIST_BOX(m_list));
+}
+
+void TabSwitcher::activate(int row)
+{
+	if (row < 0 || row >= (int)m_shown.size())
+		return;
+
+	Terminal *term = m_shown[row];
+	hide();
+	sakura->main_window->notebook.set_current_page(
+			sakura->main_window->notebook.page_num(term->hbox));
+	gtk_widget_grab_focus(term->vte);
+}
+
+void TabSwitcher::changed_cb(GtkEditable *editable, void *data)
+{
+	auto obj = (TabSwitcher *)data;
+	obj->refresh();
+}
+
+/* The entry keeps the focus, the selection is moved from it */
+gboolean TabSwitcher::key_press_cb(GtkWidget *widget, GdkEventKey *event, void *data)
+{
+	auto obj = (TabSwitcher *)data;
+	GtkListBoxRow *selected = gtk_list_box_get_selected_row(GTK_LIST_BOX(obj->m_list));
+	int row = selected ? gtk_list_box_row_get_index(selected) : -1;
+	int last = (int)obj->m_shown.size() - 1;
+
+	switch (event->keyval) {
+	case GDK_KEY_Up:
+		obj->select(row > 0 ? row - 1 : last);
+		return TRUE;
+	case GDK_KEY_Down:
+		obj->select(row < last ? row + 1 : 0);
+		return TRUE;
+	case GDK_KEY_Return:
+	case GDK_KEY_KP_Enter:
+		obj->activate(row);
+		return TRUE;
+	case GDK_KEY_Escape:
+		obj->hide();
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+void TabSwitcher::row_activated_cb(GtkListBox *list, GtkListBoxRow *row, void *data)
+{
+	auto obj = (TabSwitcher *)data;
+	obj->activate(gtk_list_box_row_get_index(row));
+}
+
+gboolean TabSwitcher::focus_out_cb(GtkWidget *widget, GdkEvent *event, void *data)
+{
+	auto obj = (TabSwitcher *)data;
+	obj->hide();
+	return FALSE;
+}
+
+void TabSwitcher::destroy_cb(GtkWidget *widget, void *data)
+{
+	auto obj = (TabSwitcher *)data;
+	obj->m_window = nullptr;
+	obj->m_entry = nullptr;
+	obj->m_list = nullptr;
+	obj->m_rows.clear();
+	obj->m_labels.clear();
+	obj->m_shown.clear();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <gtk/gtk.h>
+#include "core/tabindex.h"
+
+class Terminal;
+
+/**
+ * Quick switcher (Ctrl+Shift+P): a popup listing the tabs that match what is typed in it, by
+ * label, title, working directory or foreground command. The tabs update the TabIndex as those
+ * change, so a keystroke costs a match over the index and a refresh of SWITCHER_ROWS rows,
+ * which are made once and reused.
+ */
+class TabSwitcher
+{
+public:
+	static TabSwitcher &get();
+
+	void update(Terminal *term, TabField field, const std::string &value);
+	void remove(Terminal *term);
+	void show();
+
+private:
+	TabSwitcher() = default;
+	void create();
+	void hide();
+	void refresh();
+	void select(int row);
+	void activate(int row);
+	static void changed_cb(GtkEditable *editable, void *data);
+	static gboolean key_press_cb(GtkWidget *widget, GdkEventKey *event, void *data);
+	static void row_activated_cb(GtkListBox *list, GtkListBoxRow *row, void *data);
+	static gboolean focus_out_cb(GtkWidget *widget, GdkEvent *event, void *data);
+	static void destroy_cb(GtkWidget *widget, void *data);
+
+	TabIndex m_index;
+	std::vector<TabMatch> m_matches;
+	std::vector<Terminal *> m_shown; /* Tab of every visible row */
+	GtkWidget *m_window = nullptr; /* Destroyed along with the main window */
+	GtkWidget *m_entry = nullptr;
+	GtkWidget *m_list = nullptr;
+	std::vector<GtkWidget *> m_rows;
+	std::vector<GtkWidget *> m_labels;
+};
@@ -0,0 +1,230 @@
+#include "tabbar.h"
+#include <algorithm>
+#include <string>
+#include "notebook.h"
+#include "sakura.h"
+#include "sakuraold.h"
+#include "terminal.h"
+
+/* The strip has as many slots of this width as fit */
+#define TABBAR_SLOT_WIDTH 160
+
+struct TabSlot {
+	Gtk::ToggleButton button;
+	Gtk::Box box{Gtk::ORIENTATION_HORIZONTAL, 2};
+	Gtk::Image icon; /* Broadcast group */
+	Gtk::Label label;
+	Gtk::Button close;
+	Terminal *term = nullptr; /* nullptr when the slot is past the last tab */
+	int page = -1;
+};
+
+TabBar::TabBar(SakuraNotebook &notebook) :
+		m_notebook(notebook), m_box(Gtk::ORIENTATION_HORIZONTAL, 0),
+		m_slot_box(Gtk::ORIENTATION_HORIZONTAL, 0)
+{
+	/* Scroll events over the buttons come to this window */
+	set_visible_window(false);
+	add_events(Gdk::SCROLL_MASK | Gdk::SMOOTH_SCROLL_MASK);
+	/* Shown and hidden by the notebook, as it does with its own tabs */
+	set_no_show_all(true);
+
+	m_slot_box.set_homogeneous(true);
+	m_slot_box.set_hexpand(true);
+	m_prev.set_relief(Gtk::RELIEF_NONE);
+	m_next.set_relief(Gtk::RELIEF_NONE);
+	m_box.pack_start(m_prev, Gtk::PACK_SHRINK);
+	m_box.pack_start(m_slot_box, Gtk::PACK_EXPAND_WIDGET);
+	m_box.pack_start(m_next, Gtk::PACK_SHRINK);
+	m_box.show_all();
+	add(m_box);
+
+	m_slot_box.signal_size_allocate().connect(sigc::mem_fun(*this, &TabBar::on_slots_allocate));
+	signal_scroll_event().connect(sigc::mem_fun(*this, &TabBar::on_scroll));
+	m_prev.signal_clicked().connect([this]() { scroll(-(int)m_slots.size()); });
+	m_next.signal_clicked().connect([this]() { scroll(m_slots.size()); });
+
+	auto changed = sigc::mem_fun(*this, &TabBar::on_pages_changed);
+	notebook.signal_switch_page().connect(changed);
+	notebook.signal_page_added().connect(changed);
+	notebook.signal_page_removed().connect(changed);
+	notebook.signal_page_reordered().connect(changed);
+}
+
+TabBar::~TabBar()
+{
+	if (m_refresh_source)
+		g_source_remove(m_refresh_source);
+	if (m_resize_source)
+		g_source_remove(m_resize_source);
+}
+
+void TabBar::update(Terminal *term)
+{
+	for (auto &slot : m_slots) {
+		if (slot->term == term)
+			show_slot(*slot);
+	}
+}
+
+/* Opening or closing many tabs at once costs a single refresh. It also waits for the Terminal
+ * of a new page, which is attached after the page is added */
+void TabBar::queue_refresh(bool show_current)
+{
+	m_show_current |= show_current;
+	if (!m_refresh_source)
+		m_refresh_source = g_idle_add_full(
+				G_PRIORITY_HIGH_IDLE, TabBar::refresh_cb, this, NULL);
+}
+
+gboolean TabBar::refresh_cb(void *data)
+{
+	auto obj = (TabBar *)data;
+
+	obj->m_refresh_source = 0;
+	obj->refresh(obj->m_show_current);
+	obj->m_show_current = false;
+
+	return G_SOURCE_REMOVE;
+}
+
+void TabBar::refresh(bool show_current)
+{
+	int pages = m_notebook.get_n_pages();
+	int count = m_slots.size();
+	int current = m_notebook.get_current_page();
+
+	if (show_current && current >= 0) {
+		if (current < m_first)
+			m_first = current;
+		else if (current >= m_first + count)
+			m_first = current - count + 1;
+	}
+	m_first = std::max(0, std::min(m_first, pages - count));
+
+	m_refreshing = true;
+	for (int i = 0; i < count; i++) {
+		TabSlot &slot = *m_slots[i];
+		int page = m_first + i;
+		slot.term = page < pages ? m_notebook.get_tab_term(page) : nullptr;
+		slot.page = slot.term ? page : -1;
+		/* Empty slots keep their place, so the others don't grow */
+		slot.button.set_child_visible(slot.term != nullptr);
+		if (!slot.term)
+			continue;
+
+		show_slot(slot);
+		slot.button.set_active(page == current);
+	}
+	m_refreshing = false;
+
+	int after = std::max(0, pages - m_first - count);
+	m_prev.set_label("‹ " + std::to_string(m_first));
+	m_prev.set_sensitive(m_first > 0);
+	m_next.set_label(std::to_string(after) + " ›");
+	m_next.set_sensitive(after > 0);
+}
+
+void TabBar::show_slot(TabSlot &slot)
+{
+	Terminal *term = slot.term;
+
+	slot.label.set_text(term->label.get_text());
+	slot.icon.set_visible(term->broadcast);
+	if (term->label.get_has_tooltip())
+		slot.button.set_tooltip_text(term->label.get_tooltip_text());
+	else
+		slot.button.set_has_tooltip(false);
+}
+
+void TabBar::scroll(int pages)
+{
+	m_first += pages;
+	refresh(false);
+}
+
+void TabBar::on_pages_changed(Gtk::Widget *page, guint page_num)
+{
+	queue_refresh(true);
+}
+
+/* Slots are added or removed out of the size allocation, which can't change the children */
+void TabBar::on_slots_allocate(Gtk::Allocation &allocation)
+{
+	m_wanted = std::max(1, allocation.get_width() / TABBAR_SLOT_WIDTH);
+	if (m_wanted != m_slots.size() && !m_resize_source)
+		m_resize_source = g_idle_add(TabBar::resize_slots_cb, this);
+}
+
+gboolean TabBar::resize_slots_cb(void *data)
+{
+	auto obj = (TabBar *)data;
+
+	obj->m_resize_source = 0;
+	while (obj->m_slots.size() > obj->m_wanted)
+		obj->m_slots.pop_back();
+
+	while (obj->m_slots.size() < obj->m_wanted) {
+		auto slot = std::make_unique<TabSlot>();
+		auto clicked = sigc::bind(sigc::mem_fun(*obj, &TabBar::on_slot_clicked),
+				slot.get());
+		auto closed = sigc::bind(sigc::mem_fun(*obj, &TabBar::on_close_clicked),
+				slot.get());
+		slot->button.set_relief(Gtk::RELIEF_NONE);
+		slot->icon.set_from_icon_name("network-transmit-receive", Gtk::ICON_SIZE_MENU);
+		slot->icon.set_no_show_all(true);
+		slot->label.set_ellipsize(Pango::ELLIPSIZE_END);
+		slot->box.pack_start(slot->icon, Gtk::PACK_SHRINK);
+		slot->box.pack_start(slot->label, true, true, 0);
+		if (sakura->config.show_closebutton) {
+			slot->close.set_relief(Gtk::RELIEF_NONE);
+			slot->close.set_image_from_icon_name("window-close", Gtk::ICON_SIZE_MENU);
+			slot->close.signal_clicked().connect(closed);
+			slot->box.pack_start(slot->close, Gtk::PACK_SHRINK);
+		}
+		slot->button.add(slot->box);
+		slot->button.signal_clicked().connect(clicked);
+		slot->button.show_all();
+		obj->m_slot_box.pack_start(slot->button);
+		obj->m_slots.push_back(std::move(slot));
+	}
+
+	obj->refresh(true);
+	return G_SOURCE_REMOVE;
+}
+
+bool TabBar::on_scroll(GdkEventScroll *event)
+{
+	switch (event->direction) {
+	case GDK_SCROLL_UP:
+	case GDK_SCROLL_LEFT:
+		scroll(-1);
+		break;
+	case GDK_SCROLL_DOWN:
+	case GDK_SCROLL_RIGHT:
+		scroll(1);
+		break;
+	case GDK_SCROLL_SMOOTH:
+		if (event->delta_x + event->delta_y != 0)
+			scroll(event->delta_x + event->delta_y < 0 ? -1 : 1);
+		break;
+	}
+	return true;
+}
+
+void TabBar::on_slot_clicked(TabSlot *slot)
+{
+	if (m_refreshing)
+		return;
+
+	if (slot->page >= 0)
+		m_notebook.set_current_page(slot->page);
+	/* A click toggles the button, the refresh puts it back if the page did not change */
+	queue_refresh(false);
+}
+
+void TabBar::on_close_clicked(TabSlot *slot)
+{
+	if (slot->term)
+		sakura_closebutton_clicked(nullptr, GTK_WIDGET(slot->term->hbox.gobj()));
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <gtkmm.h>
+
+class SakuraNotebook;
+class Terminal;
+struct TabSlot;
+
+/**
+ * Tab strip used instead of the tabs of the notebook with virtual_tab_bar. It only has slots
+ * for the tabs that fit in its width, which show the tabs from m_first on and are reused for
+ * other tabs as the strip scrolls, and buttons with the number of tabs hidden on each side.
+ * Its layout and updates cost the same with 10 tabs or 1000.
+ */
+class TabBar : public Gtk::EventBox
+{
+public:
+	TabBar(SakuraNotebook &notebook);
+	~TabBar();
+
+	/* Shows again what changed in a tab (label, tooltip, broadcast group), if it is in view */
+	void update(Terminal *term);
+
+private:
+	void queue_refresh(bool show_current);
+	void refresh(bool show_current);
+	void show_slot(TabSlot &slot);
+	void scroll(int pages);
+	void on_pages_changed(Gtk::Widget *page, guint page_num);
+	void on_slots_allocate(Gtk::Allocation &allocation);
+	bool on_scroll(GdkEventScroll *event);
+	void on_slot_clicked(TabSlot *slot);
+	void on_close_clicked(TabSlot *slot);
+	static gboolean refresh_cb(void *data);
+	static gboolean resize_slots_cb(void *data);
+
+	SakuraNotebook &m_notebook;
+	Gtk::Box m_box;
+	Gtk::Box m_slot_box;
+	Gtk::Button m_prev;
+	Gtk::Button m_next;
+	std::vector<std::unique_ptr<TabSlot>> m_slots;
+	int m_first = 0;        /* Page shown in the first slot */
+	size_t m_wanted = 0;    /* Slots that fit in the last allocation */
+	guint m_refresh_source = 0;
+	bool m_show_current = false; /* For the queued refresh */
+	guint m_resize_source = 0;
+	bool m_refreshing = false;
+};
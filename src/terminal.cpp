@@ -1,14 +1,126 @@
 #include "terminal.h"
+#include "broadcast.h"
+#include "exporter.h"
+#include "frametimer.h"
+#include "isolation.h"
+#include "paste.h"
+#include "recorder.h"
 #include "sakuraold.h"
+#include "switcher.h"
+#include "window.h"
+#include <cmath>
 #include <iostream>
 #include <libintl.h>
 #include <glib.h>
-#include <glib/gstdio.h>
 
 gchar *Terminal::tab_default_title = nullptr;
 
-Terminal::Terminal():
-	hbox(Gtk::ORIENTATION_HORIZONTAL, 0)
+/* Resizes closer to each other than this are a drag of the window edge */
+#define TERMINAL_RESIZE_SETTLE_MS 100
+/* Tab zoom: each step scales the font by 10%, from 42% to 314% */
+#define TERMINAL_ZOOM_STEP 1.1
+#define TERMINAL_ZOOM_MIN -9
+#define TERMINAL_ZOOM_MAX 12
+
+TerminalBox::TerminalBox() : Gtk::Box(Gtk::ORIENTATION_HORIZONTAL, 0)
+{
+}
+
+TerminalBox::~TerminalBox()
+{
+	if (m_settle_source)
+		g_source_remove(m_settle_source);
+}
+
+void TerminalBox::get_preferred_width_vfunc(int &minimum, int &natural) const
+{
+	Gtk::Box::get_preferred_width_vfunc(minimum, natural);
+	if (!get_child_visible())
+		natural = minimum;
+}
+
+void TerminalBox::get_preferred_height_vfunc(int &minimum, int &natural) const
+{
+	Gtk::Box::get_preferred_height_vfunc(minimum, natural);
+	if (!get_child_visible())
+		natural = minimum;
+}
+
+void TerminalBox::get_preferred_width_for_height_vfunc(
+		int height, int &minimum, int &natural) const
+{
+	Gtk::Box::get_preferred_width_for_height_vfunc(height, minimum, natural);
+	if (!get_child_visible())
+		natural = minimum;
+}
+
+void TerminalBox::get_preferred_height_for_width_vfunc(
+		int width, int &minimum, int &natural) const
+{
+	Gtk::Box::get_preferred_height_for_width_vfunc(width, minimum, natural);
+	if (!get_child_visible())
+		natural = minimum;
+}
+
+void TerminalBox::on_size_allocate(Gtk::Allocation &allocation)
+{
+	bool shown = get_child_visible();
+	bool resized = allocation.get_width() != m_applied.get_width() ||
+		       allocation.get_height() != m_applied.get_height();
+	bool settling = false;
+
+	if (resized && shown) {
+		gint64 now = g_get_monotonic_time();
+		gint64 settle_us = TERMINAL_RESIZE_SETTLE_MS * 1000;
+		/* The first resize of a drag is applied, the next ones wait for the last one */
+		settling = m_settle_source || now - m_last_resize < settle_us;
+		m_last_resize = now;
+		if (settling) {
+			if (m_settle_source)
+				g_source_remove(m_settle_source);
+			m_settle_source = g_timeout_add(
+					TERMINAL_RESIZE_SETTLE_MS, TerminalBox::settle_cb, this);
+		}
+	}
+
+	/* The notebook allocates hidden pages too */
+	if (resized && (!shown || settling)) {
+		set_allocation(allocation);
+		m_deferred = true;
+		return;
+	}
+
+	m_deferred = false;
+	m_applied = allocation;
+	Gtk::Box::on_size_allocate(allocation);
+}
+
+/* The notebook maps a page as it switches to it, before the layout of the frame that shows it,
+ * so the terminal gets its size in that frame. The size request changes with the visibility */
+void TerminalBox::on_map()
+{
+	Gtk::Box::on_map();
+	queue_resize();
+}
+
+void TerminalBox::on_unmap()
+{
+	Gtk::Box::on_unmap();
+	queue_resize();
+}
+
+gboolean TerminalBox::settle_cb(void *data)
+{
+	auto obj = (TerminalBox *)data;
+
+	obj->m_settle_source = 0;
+	if (obj->m_deferred)
+		obj->queue_allocate();
+
+	return G_SOURCE_REMOVE;
+}
+
+Terminal::Terminal()
 {
 	gchar *_label_text = _("Terminal %d");
 	/* appling tab title pattern from config
@@ -32,10 +144,22 @@ Terminal::Terminal():
 	colorset = sakura->config.last_colorset - 1;
 
 	label.set_ellipsize(Pango::ELLIPSIZE_END);
+	broadcast_icon.set_from_icon_name("network-transmit-receive", Gtk::ICON_SIZE_MENU);
+	broadcast_icon.set_no_show_all(true);
 }
 
 Terminal::~Terminal()
 {
+	ProcTracker::get().remove(this);
+	Broadcaster::get().remove(this);
+	TabSwitcher::get().remove(this);
+	ResourceMeter::get().remove(this);
+	TabIsolation::get().release(this);
+	delete exporter;
+	delete proxy;
+	delete replay;
+	delete frame_stats;
+
 	if (bg_image) {
 		g_clear_object(&bg_image);
 	}
@@ -54,42 +178,136 @@ void Terminal::free(Terminal *term)
 	delete term;
 }
 
-/* Retrieve the cwd of the specified term page.
- * Original function was from terminal-screen.c of gnome-terminal, copyright (C) 2001 Havoc
- * Pennington Adapted by Hong Jen Yee, non-linux shit removed by David Gómez */
+/* Retrieve the cwd of the specified term page: the one the shell reports with OSC 7, which VTE
+ * keeps for us, if it is on this host, or the one of the child otherwise */
 char *Terminal::get_cwd()
 {
-	char *cwd = NULL;
+	const char *uri = vte_terminal_get_current_directory_uri(VTE_TERMINAL(vte));
+	if (uri) {
+		gchar *hostname = NULL;
+		gchar *cwd = g_filename_from_uri(uri, &hostname, NULL);
+		bool local = !hostname || !g_strcmp0(hostname, "localhost") ||
+			     !g_strcmp0(hostname, g_get_host_name());
+		g_free(hostname);
+		if (cwd && local)
+			return cwd;
+		g_free(cwd);
+	}
 
-	if (pid >= 0) {
-		char *file, *buf;
-		struct stat sb;
-		int len;
+	if (pid <= 0)
+		return NULL;
 
-		file = g_strdup_printf("/proc/%d/cwd", pid);
+	/* The link reports a size of 0, g_file_read_link does not rely on it */
+	gchar *file = g_strdup_printf("/proc/%d/cwd", pid);
+	gchar *cwd = g_file_read_link(file, NULL);
+	g_free(file);
 
-		if (g_stat(file, &sb) == -1) {
-			g_free(file);
-			return cwd;
-		}
+	if (cwd && cwd[0] != '/')
+		g_clear_pointer(&cwd, g_free);
+	return cwd;
+}
 
-		buf = (char *)malloc(sb.st_size + 1);
+int Terminal::get_pty_fd()
+{
+	VtePty *pty = proxy ? proxy->get_pty() : vte_terminal_get_pty(VTE_TERMINAL(vte));
 
-		if (buf == NULL) {
-			g_free(file);
-			return cwd;
-		}
+	return pty ? vte_pty_get_fd(pty) : -1;
+}
 
-		len = readlink(file, buf, sb.st_size + 1);
+void Terminal::update_tooltip()
+{
+	GString *tooltip = g_string_new(NULL);
 
-		if (len > 0 && buf[0] == '/') {
-			buf[len] = '\0';
-			cwd = g_strdup(buf);
-		}
+	if (foreground.pgid != 0) {
+		g_string_append_printf(tooltip, _("Running %s (PID %d)"),
+				foreground.name.empty() ? "?" : foreground.name.c_str(),
+				foreground.pgid);
+	}
 
-		g_free(buf);
-		g_free(file);
+	if (meter) {
+		gchar *rss = g_format_size(usage.rss_bytes);
+		if (tooltip->len)
+			g_string_append_c(tooltip, '\n');
+		g_string_append_printf(tooltip, _("CPU %.0f%%, memory %s in %d processes"),
+				usage.cpu_percent, rss, usage.processes);
+		g_free(rss);
 	}
 
-	return cwd;
-}
\ No newline at end of file
+	const ShellCommand *command = shell_index.last_finished();
+	if (command) {
+		if (tooltip->len)
+			g_string_append_c(tooltip, '\n');
+		double seconds = (command->end_us - command->start_us) / (double)G_USEC_PER_SEC;
+		if (command->exit_code >= 0)
+			g_string_append_printf(tooltip,
+					_("Last command exited with %d after %.1f s"),
+					command->exit_code, seconds);
+		else
+			g_string_append_printf(tooltip, _("Last command took %.1f s"), seconds);
+	}
+
+	if (zoom) {
+		if (tooltip->len)
+			g_string_append_c(tooltip, '\n');
+		g_string_append_printf(tooltip, _("Zoom %.0f%%"),
+				vte_terminal_get_font_scale(VTE_TERMINAL(vte)) * 100);
+	}
+
+	if (tooltip->len)
+		label.set_tooltip_text(tooltip->str);
+	else
+		label.set_has_tooltip(false);
+	g_string_free(tooltip, TRUE);
+	sakura->main_window->tab_bar.update(this);
+}
+
+/* Scales the font of this tab only. VTE measures its cells again and fits as many as its
+ * allocation has room for, the other tabs and the window size are left alone */
+void Terminal::set_zoom(int zoom)
+{
+	zoom = CLAMP(zoom, TERMINAL_ZOOM_MIN, TERMINAL_ZOOM_MAX);
+	if (zoom == this->zoom)
+		return;
+
+	this->zoom = zoom;
+	vte_terminal_set_font_scale(VTE_TERMINAL(vte), pow(TERMINAL_ZOOM_STEP, zoom));
+	update_tooltip();
+}
+
+/* Scrolls the prompt above or below the top row to the top, with shell_integration */
+void Terminal::scroll_to_prompt(bool previous)
+{
+	GtkAdjustment *adjustment = gtk_scrollable_get_vadjustment(GTK_SCROLLABLE(vte));
+	long top = (long)gtk_adjustment_get_value(adjustment);
+	long row = previous ? shell_index.previous_prompt(top) : shell_index.next_prompt(top);
+
+	/* Past the last prompt is the bottom, before the first one there is nothing */
+	if (row < 0 && !previous)
+		row = (long)gtk_adjustment_get_upper(adjustment);
+	if (row < (long)gtk_adjustment_get_lower(adjustment))
+		return;
+
+	gtk_adjustment_set_value(adjustment, row);
+}
+
+void Terminal::draw_progress(cairo_t *cr, double fraction, const char *text)
+{
+	int width = gtk_widget_get_allocated_width(vte);
+	int height = gtk_widget_get_allocated_height(vte);
+	glong char_height = vte_terminal_get_char_height(VTE_TERMINAL(vte));
+
+	cairo_set_source_rgba(cr, 0.0, 0.0, 0.0, 0.8);
+	cairo_rectangle(cr, 0, height - char_height, width, char_height);
+	cairo_fill(cr);
+	cairo_set_source_rgba(cr, 1.0, 0.84, 0.0, 0.8);
+	cairo_rectangle(cr, 0, height - char_height, width * fraction, char_height);
+	cairo_fill(cr);
+
+	PangoLayout *layout = pango_cairo_create_layout(cr);
+	pango_layout_set_font_description(layout, vte_terminal_get_font(VTE_TERMINAL(vte)));
+	pango_layout_set_text(layout, text, -1);
+	cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+	cairo_move_to(cr, vte_terminal_get_char_width(VTE_TERMINAL(vte)), height - char_height);
+	pango_cairo_show_layout(cr, layout);
+	g_object_unref(layout);
+}
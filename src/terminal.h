@@ -1,8 +1,57 @@
 #pragma once
 
+#include <memory>
 #include <gtk/gtk.h>
+#include <gtkmm/image.h>
 #include <gtkmm/label.h>
 #include <gtkmm/box.h>
+#include "core/shellmarks.h"
+#include "proctracker.h"
+#include "resourcemeter.h"
+
+class PasteJob;
+class ScrollbackExporter;
+class PtyProxy;
+class Replayer;
+struct FrameStats;
+struct TabMetrics;
+struct TrackedProcess;
+struct MeteredTab;
+
+/**
+ * The page of a tab. VTE rewraps its whole scrollback when its width changes, so new sizes are
+ * not passed on to the terminal while its page is hidden, only once it is shown, and while the
+ * window is being resized continuously, only once the size has settled.
+ *
+ * A hidden page asks for its minimum size only. Its terminal keeps the columns it had, and the
+ * notebook asks for the natural size of its largest page, so the natural size of the window is
+ * the one of the terminal shown plus what is around it, like Sakura::apply_size expects.
+ */
+class TerminalBox : public Gtk::Box
+{
+public:
+	TerminalBox();
+	~TerminalBox();
+
+protected:
+	void get_preferred_width_vfunc(int &minimum, int &natural) const override;
+	void get_preferred_height_vfunc(int &minimum, int &natural) const override;
+	void get_preferred_width_for_height_vfunc(
+			int height, int &minimum, int &natural) const override;
+	void get_preferred_height_for_width_vfunc(
+			int width, int &minimum, int &natural) const override;
+	void on_size_allocate(Gtk::Allocation &allocation) override;
+	void on_map() override;
+	void on_unmap() override;
+
+private:
+	static gboolean settle_cb(void *data);
+
+	Gtk::Allocation m_applied; /* Last allocation given to the children */
+	bool m_deferred = false;   /* The box has a newer one */
+	gint64 m_last_resize = 0;  /* Of the terminal while shown */
+	guint m_settle_source = 0;
+};
 
 class Terminal
 {
@@ -16,8 +65,19 @@ public:
 	static void free(Terminal *term);
 
 	char *get_cwd();
+	/* Master side of the pty the child runs on, -1 if there is none */
+	int get_pty_fd();
+	/* Shows the foreground job, the resource usage and the last command in the tooltip of the
+	 * tab label */
+	void update_tooltip();
+	void scroll_to_prompt(bool previous);
+	void set_zoom(int zoom);
+	/* A bar along the bottom of the terminal, for the draw handlers of long tasks. The objects
+	 * connecting handlers to vte (PtyProxy, PasteJob, ScrollbackExporter) hold a reference on
+	 * it until their destructors disconnect them */
+	void draw_progress(cairo_t *cr, double fraction, const char *text);
 
-	Gtk::Box hbox;
+	TerminalBox hbox;
 	GtkWidget *vte;     /* Reference to VTE terminal */
 	GPid pid = 0;          /* pid of the forked process */
 	GtkWidget *scrollbar;
@@ -28,6 +88,21 @@ public:
 	int colorset;
 	gulong bg_image_callback_id = 0;
 	GdkPixbuf *bg_image = nullptr;
+	PtyProxy *proxy = nullptr;   /* Set when the output is recorded */
+	Replayer *replay = nullptr;  /* Set when the tab replays a recording instead of a child */
+	FrameStats *frame_stats = nullptr; /* Frames drawn while shown, with --frame-timing */
+	std::shared_ptr<TabMetrics> metrics; /* With --metrics-socket */
+	ForegroundJob foreground; /* Kept up to date by the ProcTracker */
+	std::shared_ptr<TrackedProcess> tracked;
+	TabUsage usage; /* Kept up to date by the ResourceMeter, with resource_meter */
+	std::shared_ptr<MeteredTab> meter;
+	std::string cgroup; /* Of the child, with isolate_tabs */
+	ShellIndex shell_index; /* Filled by the PtyProxy, with shell_integration */
+	std::shared_ptr<PasteJob> paste_job; /* Created by the first paste */
+	ScrollbackExporter *exporter = nullptr;
+	bool broadcast = false; /* In the broadcast group */
+	int zoom = 0; /* Font scale steps of this tab alone, 0 for the configured font */
+	Gtk::Image broadcast_icon; /* In the tab label, shown while in the broadcast group */
 
 	static gchar *tab_default_title;
 private:
@@ -0,0 +1,152 @@
+#include "watchdog.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <execinfo.h>
+#include <unistd.h>
+
+#define WATCHDOG_MIN_PERIOD_US 5000
+#define WATCHDOG_BACKTRACE_FRAMES 64
+/* How long the watchdog waits for the GUI thread to take its backtrace */
+#define WATCHDOG_BACKTRACE_WAIT_MS 100
+
+std::atomic<const char *> Watchdog::m_phase{nullptr};
+
+/* Written by the signal handler in the GUI thread, read by the watchdog thread */
+static void *backtrace_frames[WATCHDOG_BACKTRACE_FRAMES];
+static std::atomic<int> backtrace_size{0};
+
+Watchdog &Watchdog::get()
+{
+	static Watchdog watchdog;
+	return watchdog;
+}
+
+void Watchdog::start(int threshold_ms, bool backtraces)
+{
+	static GSourceFuncs funcs = {Watchdog::prepare_cb, Watchdog::check_cb,
+			Watchdog::dispatch_cb, NULL};
+
+	m_threshold_us = threshold_ms * 1000L;
+	m_backtraces = backtraces;
+	m_gui_thread = pthread_self();
+
+	if (m_backtraces) {
+		/* The first call loads libgcc, which can't be done from the signal handler */
+		backtrace(backtrace_frames, 1);
+
+		struct sigaction action = {};
+		action.sa_handler = Watchdog::backtrace_signal_cb;
+		action.sa_flags = SA_RESTART;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGRTMIN, &action, NULL);
+	}
+
+	m_source = g_source_new(&funcs, sizeof(GSource));
+	g_source_attach(m_source, NULL);
+
+	/* Busy until the main loop first polls, the config load and the first tab come before */
+	m_busy_since.store(g_get_monotonic_time(), std::memory_order_release);
+	m_running = true;
+	m_thread = std::thread(&Watchdog::watch, this);
+}
+
+void Watchdog::stop()
+{
+	if (!m_running)
+		return;
+
+	m_running = false;
+	m_thread.join();
+	g_source_destroy(m_source);
+	g_source_unref(m_source);
+	m_source = nullptr;
+}
+
+std::map<std::string, StallStats> Watchdog::stats()
+{
+	std::lock_guard<std::mutex> lock(m_stats_mutex);
+	return m_stats;
+}
+
+/* Called before every poll() of the main loop */
+gboolean Watchdog::prepare_cb(GSource *source, gint *timeout)
+{
+	auto &obj = Watchdog::get();
+	obj.m_idle_since.store(g_get_monotonic_time(), std::memory_order_relaxed);
+	obj.m_busy_since.store(0, std::memory_order_release);
+
+	*timeout = -1;
+	return FALSE;
+}
+
+/* Called after every poll() of the main loop */
+gboolean Watchdog::check_cb(GSource *source)
+{
+	Watchdog::get().m_busy_since.store(g_get_monotonic_time(), std::memory_order_release);
+	return FALSE;
+}
+
+gboolean Watchdog::dispatch_cb(GSource *source, GSourceFunc callback, gpointer data)
+{
+	return G_SOURCE_CONTINUE;
+}
+
+void Watchdog::backtrace_signal_cb(int signal)
+{
+	backtrace_size.store(backtrace(backtrace_frames, WATCHDOG_BACKTRACE_FRAMES));
+}
+
+void Watchdog::watch()
+{
+	auto period = std::chrono::microseconds(
+			std::max<gint64>(m_threshold_us / 4, WATCHDOG_MIN_PERIOD_US));
+	gint64 stall_start = 0;
+	const char *stall_phase = nullptr;
+
+	while (m_running) {
+		std::this_thread::sleep_for(period);
+		gint64 busy_since = m_busy_since.load(std::memory_order_acquire);
+
+		if (stall_start) {
+			/* Back to poll(), maybe already busy with the next iteration */
+			if (busy_since != stall_start) {
+				report(stall_phase, stall_start,
+						m_idle_since.load(std::memory_order_relaxed));
+				stall_start = 0;
+			}
+			continue;
+		}
+
+		if (busy_since == 0 || g_get_monotonic_time() - busy_since <= m_threshold_us)
+			continue;
+
+		stall_start = busy_since;
+		stall_phase = phase();
+		if (!m_backtraces)
+			continue;
+
+		backtrace_size.store(0);
+		pthread_kill(m_gui_thread, SIGRTMIN);
+		for (int i = 0; i < WATCHDOG_BACKTRACE_WAIT_MS && backtrace_size.load() == 0; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		fprintf(stderr, "GUI thread busy for more than %" G_GINT64_FORMAT " ms in %s:\n",
+				m_threshold_us / 1000, stall_phase ? stall_phase : "main loop");
+		backtrace_symbols_fd(backtrace_frames, backtrace_size.load(), STDERR_FILENO);
+	}
+}
+
+void Watchdog::report(const char *phase, gint64 start, gint64 end)
+{
+	gint64 duration = std::max<gint64>(end - start, 0);
+	fprintf(stderr, "GUI thread stalled for %.1f ms in %s\n", duration / 1000.0,
+			phase ? phase : "main loop");
+
+	std::lock_guard<std::mutex> lock(m_stats_mutex);
+	auto &stats = m_stats[phase ? phase : "main_loop"];
+	stats.count++;
+	stats.total_us += duration;
+	stats.max_us = std::max(stats.max_us, duration);
+}
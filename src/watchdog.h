@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <pthread.h>
+#include <glib.h>
+
+/* Stalls charged to one phase */
+struct StallStats {
+	guint64 count = 0;
+	gint64 total_us = 0;
+	gint64 max_us = 0;
+};
+
+/**
+ * GUI thread watchdog, enabled with --watchdog=MS. A GSource of the default main context marks
+ * when the main loop leaves poll() and when it gets back to it. A thread checks those marks,
+ * and when the GUI thread has been busy for longer than MS it reports the stall, with the
+ * phase (see WatchdogPhase) active when it was detected and, with --watchdog-backtrace, a
+ * backtrace of the GUI thread taken at that moment.
+ *
+ * Stalls are printed to stderr when they end and exported by the metrics socket. Nested main
+ * loops (gtk_dialog_run) keep the source running, so modal dialogs are not stalls.
+ */
+class Watchdog
+{
+public:
+	static Watchdog &get();
+
+	/* Must be called from the GUI thread */
+	void start(int threshold_ms, bool backtraces);
+	void stop();
+	bool is_enabled() const { return m_threshold_us > 0; }
+
+	static void set_phase(const char *phase)
+	{
+		m_phase.store(phase, std::memory_order_relaxed);
+	}
+	static const char *phase() { return m_phase.load(std::memory_order_relaxed); }
+
+	std::map<std::string, StallStats> stats();
+
+private:
+	Watchdog() = default;
+	static gboolean prepare_cb(GSource *source, gint *timeout);
+	static gboolean check_cb(GSource *source);
+	static gboolean dispatch_cb(GSource *source, GSourceFunc callback, gpointer data);
+	static void backtrace_signal_cb(int signal);
+	void watch();
+	void report(const char *phase, gint64 start, gint64 end);
+
+	static std::atomic<const char *> m_phase;
+	gint64 m_threshold_us = 0;
+	bool m_backtraces = false;
+	pthread_t m_gui_thread;
+	GSource *m_source = nullptr;
+	std::thread m_thread;
+	std::atomic<bool> m_running{false};
+	/* Set by the GUI thread: when it left poll(), 0 while it polls, and when it got back */
+	std::atomic<gint64> m_busy_since{0};
+	std::atomic<gint64> m_idle_since{0};
+	std::mutex m_stats_mutex;
+	std::map<std::string, StallStats> m_stats;
+};
+
+/* Names what the GUI thread does for the rest of the scope, for the stalls reported meanwhile */
+class WatchdogPhase
+{
+public:
+	explicit WatchdogPhase(const char *phase) : m_previous(Watchdog::phase())
+	{
+		Watchdog::set_phase(phase);
+	}
+	~WatchdogPhase() { Watchdog::set_phase(m_previous); }
+
+	WatchdogPhase(const WatchdogPhase &) = delete;
+	WatchdogPhase &operator=(const WatchdogPhase &) = delete;
+
+private:
+	const char *m_previous;
+};
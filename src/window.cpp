@@ -8,12 +8,16 @@
 #include <gtk/gtk.h>
 #include <gdk/gdkx.h>
 #include "window.h"
+#include "benchreport.h"
+#include "frametimer.h"
+#include "latency.h"
 #include "sakuraold.h"
 #include "notebook.h"
+#include "resourcemeter.h"
 #include "terminal.h"
 
 SakuraWindow::SakuraWindow(Gtk::WindowType type, const Config *cfg) :
-		Gtk::Window(type), notebook(cfg), m_config(cfg)
+		Gtk::Window(type), notebook(cfg), tab_bar(notebook), m_config(cfg)
 {
 	set_title("sakura++");
 
@@ -34,7 +38,16 @@ SakuraWindow::SakuraWindow(Gtk::WindowType type, const Config *cfg) :
 	set_icon_from_file(std::string(icon_path));
 
 	m_box = Gtk::Box(Gtk::ORIENTATION_VERTICAL, 0);
-	m_box.pack_start(notebook, Gtk::PACK_EXPAND_WIDGET);
+	m_overlay.add(notebook);
+	if (FrameTimer::get().is_enabled()) {
+		m_overlay.add_overlay(*FrameTimer::get().overlay());
+		m_overlay.set_overlay_pass_through(*FrameTimer::get().overlay(), true);
+	}
+	m_box.pack_start(m_overlay, Gtk::PACK_EXPAND_WIDGET);
+	if (cfg->virtual_tab_bar) {
+		m_box.pack_start(tab_bar, Gtk::PACK_SHRINK);
+		place_tab_bar(cfg->tabs_on_bottom);
+	}
 	m_box.set_hexpand(true);
 	m_box.show_all();
 	add(m_box);
@@ -44,26 +57,31 @@ SakuraWindow::SakuraWindow(Gtk::WindowType type, const Config *cfg) :
 	signal_check_resize().connect(sigc::mem_fun(*this, &SakuraWindow::on_resize));
 	signal_delete_event().connect(sigc::mem_fun(*this, &SakuraWindow::on_delete));
 	signal_show().connect(sigc::mem_fun(*sakura, &Sakura::set_size));
+	signal_realize().connect(sigc::mem_fun(*this, &SakuraWindow::on_realized));
+	signal_map_event().connect(sigc::mem_fun(*this, &SakuraWindow::on_mapped));
 }
 
 SakuraWindow::~SakuraWindow()
 {
 }
 
+void SakuraWindow::place_tab_bar(bool bottom)
+{
+	if (m_config->virtual_tab_bar)
+		m_box.reorder_child(tab_bar, bottom ? 1 : 0);
+}
+
 bool SakuraWindow::on_delete(GdkEventAny *event)
 {
 	if (!sakura->config.less_questions) {
 		gint npages = notebook.get_n_pages();
 
-		/* Check for each tab if there are running processes. Use tcgetpgrp to compare to
-		 * the shell PGID */
+		/* Check for each tab if there are running processes, as seen by the ProcTracker */
 		for (gint i = 0; i < npages; i++) {
 			Terminal *term = sakura->main_window->notebook.get_tab_term(i);
-			pid_t pgid = tcgetpgrp(vte_pty_get_fd(
-					vte_terminal_get_pty(VTE_TERMINAL(term->vte))));
 
 			/* If running processes are found, we ask one time and exit */
-			if ((pgid != -1) && (pgid != term->pid)) {
+			if (term->foreground.pgid != 0) {
 				std::unique_ptr<Gtk::MessageDialog> dialog(new Gtk::MessageDialog(
 						*this,
 						_("There are running processes.\n\nDo you really "
@@ -87,11 +105,28 @@ bool SakuraWindow::on_delete(GdkEventAny *event)
 	return false;
 }
 
+/* The frame clock only exists once the window is realized, so everything hooking into it is
+ * attached here */
+void SakuraWindow::on_realized()
+{
+	BenchReport::get().count_frames(GTK_WIDGET(gobj()));
+	FrameTimer::get().attach(GTK_WIDGET(gobj()));
+	LatencyProbe::get().attach(GTK_WIDGET(gobj()));
+}
+
+bool SakuraWindow::on_mapped(GdkEventAny *event)
+{
+	BenchReport::get().mark("window_mapped");
+	return false;
+}
+
 bool SakuraWindow::on_focus_in(GdkEventFocus *event)
 {
 	if (event->type != GDK_FOCUS_CHANGE)
 		return false;
 
+	ResourceMeter::get().set_focused(true);
+
 	/* Ignore first focus event */
 	if (m_first_focus) {
 		m_first_focus = false;
@@ -117,6 +152,11 @@ bool SakuraWindow::on_focus_out(GdkEventFocus *event)
 	if (event->type != GDK_FOCUS_CHANGE)
 		return false;
 
+	ResourceMeter::get().set_focused(false);
+
+	/* Modifier releases are not seen once the focus is gone */
+	sakura->disable_matching();
+
 	if (m_focused) {
 		m_focused = false;
 
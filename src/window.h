@@ -2,6 +2,7 @@
 
 #include <gtkmm.h>
 #include "notebook.h"
+#include "tabbar.h"
 
 class Config;
 
@@ -14,14 +15,20 @@ public:
 	bool on_focus_in(GdkEventFocus *event);
 	bool on_focus_out(GdkEventFocus *event);
 	bool on_delete(GdkEventAny *event);
+	void on_realized();
+	bool on_mapped(GdkEventAny *event);
 	void on_resize();
 	void toggle_fullscreen();
+	/* Above or below the terminals, with virtual_tab_bar */
+	void place_tab_bar(bool bottom);
 
 	SakuraNotebook notebook;
+	TabBar tab_bar; /* After the notebook, it connects to its signals */
 	bool resized = false;
 
 private:
 	Gtk::Box m_box;
+	Gtk::Overlay m_overlay;
 	const Config *m_config;
 	bool m_focused = true;	   /* For fading feature */
 	bool m_first_focus = true; /* First time gtkwindow recieve focus when is created */